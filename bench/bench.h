@@ -0,0 +1,98 @@
+// bench.h
+//
+// Minimal steady-state microbenchmark harness for `make bench`.
+//
+// Each benchmark is a callable run for a warmup phase and then for a
+// measured phase sized to a wall-clock budget, reporting ns/op and
+// heap allocations/op.  Allocation counting works by overriding the
+// global operator new/delete in bench_main.cpp and bumping the
+// counters declared here, so the numbers cover every allocation made
+// on the benchmarked path (including inside the standard library).
+//
+// Results are emitted as one JSON object per line on stdout and
+// appended to the file named by BENCH_OUT (default
+// logs/bench_results.jsonl), so runs can be diffed release over
+// release.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+
+// Bumped by the operator new/delete overrides in bench_main.cpp.
+extern std::atomic<uint64_t> g_alloc_count;
+extern std::atomic<uint64_t> g_alloc_bytes;
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0.0;
+    double allocs_per_op = 0.0;
+    double alloc_bytes_per_op = 0.0;
+};
+
+// Run `fn` in steady state: `warmup` untimed iterations, then batches
+// of timed iterations until `budget_ms` of measured time has
+// accumulated (at least `min_iters` iterations).
+template <typename Fn>
+Result run(const std::string& name, Fn&& fn,
+           size_t warmup = 10, double budget_ms = 300.0,
+           uint64_t min_iters = 10) {
+    using clk = std::chrono::steady_clock;
+
+    for (size_t i = 0; i < warmup; ++i) {
+        fn();
+    }
+
+    Result res;
+    res.name = name;
+    uint64_t allocs0 = g_alloc_count.load(std::memory_order_relaxed);
+    uint64_t bytes0 = g_alloc_bytes.load(std::memory_order_relaxed);
+    double elapsed_ns = 0.0;
+    while (elapsed_ns < budget_ms * 1e6 || res.iterations < min_iters) {
+        auto t0 = clk::now();
+        fn();
+        elapsed_ns += std::chrono::duration<double, std::nano>(
+            clk::now() - t0).count();
+        res.iterations++;
+    }
+    uint64_t allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs0;
+    uint64_t bytes = g_alloc_bytes.load(std::memory_order_relaxed) - bytes0;
+
+    res.ns_per_op = elapsed_ns / static_cast<double>(res.iterations);
+    res.allocs_per_op = static_cast<double>(allocs) /
+                        static_cast<double>(res.iterations);
+    res.alloc_bytes_per_op = static_cast<double>(bytes) /
+                             static_cast<double>(res.iterations);
+    return res;
+}
+
+// Emit one result as a JSON line on stdout (and, when `json_out` is
+// non-null, appended to the results file) plus a human-readable
+// summary on stderr.
+inline void report(const Result& r, FILE* json_out) {
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,"
+                  "\"allocs_per_op\":%.2f,\"alloc_bytes_per_op\":%.1f}",
+                  r.name.c_str(),
+                  static_cast<unsigned long long>(r.iterations),
+                  r.ns_per_op, r.allocs_per_op, r.alloc_bytes_per_op);
+    std::fprintf(stdout, "%s\n", line);
+    if (json_out) {
+        std::fprintf(json_out, "%s\n", line);
+    }
+    std::fprintf(stderr, "  %-44s %12.1f ns/op  %10.2f allocs/op  (%llu iters)\n",
+                 r.name.c_str(), r.ns_per_op, r.allocs_per_op,
+                 static_cast<unsigned long long>(r.iterations));
+}
+
+} // namespace bench
+
+#endif // BENCH_H
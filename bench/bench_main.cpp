@@ -0,0 +1,336 @@
+// bench_main.cpp
+//
+// Steady-state microbenchmarks for Cockpit's hot kernels, run via
+// `make bench`.
+//
+// Covered paths:
+// - EpisodicMemory::retrieve at several store sizes (ANN search)
+// - CollapseLoop::process_cycle at base and max dimensionality
+// - Chunker::encode over a token stream with a trained chunk library
+// - change_audit::build_report (diff + hashes) on 1 KB / 100 KB / 5 MB
+// - self_writer::apply_change end to end against a scratch tree
+//
+// Each benchmark reports ns/op and heap allocations/op (counted via
+// the global operator new/delete overrides below).  Results go to
+// stdout as JSON lines and are appended to $BENCH_OUT (default
+// logs/bench_results.jsonl) so successive releases can be compared.
+//
+// Numbers are wall-clock and include whatever background work the
+// measured path triggers (consolidation threads, report persistence),
+// since that is the cost the serving path actually pays.
+
+#include "bench.h"
+#include "change_audit.h"
+#include "chunking.h"
+#include "collapse.h"
+#include "episodic_memory.h"
+#include "fdqc_params.h"
+#include "imagination_engine.h"
+#include "self_writer.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+//===========================================================================
+// ALLOCATION COUNTING
+//===========================================================================
+
+namespace bench {
+std::atomic<uint64_t> g_alloc_count{0};
+std::atomic<uint64_t> g_alloc_bytes{0};
+} // namespace bench
+
+// noinline keeps GCC from pairing the malloc inside the replaced
+// operator new with the free inside operator delete at inlined call
+// sites, which would trip -Wmismatched-new-delete.
+__attribute__((noinline)) void* operator new(std::size_t n) {
+    bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    bench::g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    void* p = std::malloc(n);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void* operator new[](std::size_t n) {
+    return ::operator new(n);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept {
+    ::operator delete[](p);
+}
+
+//===========================================================================
+// HELPERS
+//===========================================================================
+
+// Sink for benchmark results so the compiler cannot elide the
+// measured work.
+static volatile size_t g_sink = 0;
+
+// Deterministic random embedding (unit-ish scale, fixed dimension).
+static fdqc::Vec random_embedding(std::mt19937& rng, size_t dim) {
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    fdqc::Vec v(dim);
+    for (size_t i = 0; i < dim; ++i) {
+        v[i] = static_cast<fdqc::Scalar>(dist(rng));
+    }
+    return v;
+}
+
+// Synthetic source-like content of roughly `bytes` bytes, built from
+// numbered 64-character lines so diffs have realistic line structure.
+static std::string synthetic_content(size_t bytes, const std::string& tag) {
+    std::ostringstream oss;
+    size_t line_no = 0;
+    while (oss.tellp() >= 0 && static_cast<size_t>(oss.tellp()) < bytes) {
+        oss << "void handler_" << tag << "_" << line_no
+            << "() { dispatch(" << line_no << "); } // padding padding\n";
+        line_no++;
+    }
+    return oss.str();
+}
+
+// Copy of `content` with a handful of lines edited around the middle,
+// mimicking a typical focused change to a large file.
+static std::string edit_middle_lines(const std::string& content) {
+    std::vector<std::string> lines;
+    std::istringstream iss(content);
+    std::string line;
+    while (std::getline(iss, line)) {
+        lines.push_back(line);
+    }
+    size_t mid = lines.size() / 2;
+    for (size_t i = mid; i < mid + 4 && i < lines.size(); ++i) {
+        lines[i] = "    return cached_result;  // edited line " +
+                   std::to_string(i);
+    }
+    std::ostringstream oss;
+    for (const std::string& l : lines) {
+        oss << l << "\n";
+    }
+    return oss.str();
+}
+
+//===========================================================================
+// BENCHMARKS
+//===========================================================================
+
+static void bench_episodic_retrieve(FILE* json_out) {
+    for (size_t store_size : {size_t(1000), size_t(10000)}) {
+        episodic_memory::EpisodicMemory memory;
+        std::mt19937 rng(42);
+        for (size_t i = 0; i < store_size; ++i) {
+            memory.record(random_embedding(rng, 64),
+                          "episode " + std::to_string(i),
+                          0.5, 0.0);
+        }
+        // Rotate through a pool of queries so successive iterations do
+        // not hit an artificially warm single search path.
+        std::vector<fdqc::Vec> queries;
+        for (size_t i = 0; i < 64; ++i) {
+            queries.push_back(random_embedding(rng, 64));
+        }
+        size_t qi = 0;
+        auto r = bench::run(
+            "episodic_memory/retrieve/n=" + std::to_string(store_size),
+            [&] {
+                auto results = memory.retrieve(queries[qi++ % queries.size()],
+                                               fdqc_params::KNN_NEIGHBORS);
+                g_sink += results.size();
+            });
+        bench::report(r, json_out);
+    }
+}
+
+static void bench_collapse_cycle(FILE* json_out) {
+    for (int n : {fdqc_params::N_WM_BASE, fdqc_params::N_WM_MAX}) {
+        collapse::CollapseLoop loop(n);
+        std::vector<double> probs(n);
+        for (int i = 0; i < n; ++i) {
+            probs[i] = 1.0 + 0.1 * i;
+        }
+        auto r = bench::run(
+            "collapse/process_cycle/n=" + std::to_string(n),
+            [&] {
+                auto state = loop.process_cycle(probs, true);
+                g_sink += state.selected_index;
+            },
+            100, 300.0, 1000);
+        bench::report(r, json_out);
+    }
+}
+
+static void bench_chunker_encode(FILE* json_out) {
+    chunking::Chunker chunker;
+    // A 256-token stream with recurring bigrams/trigrams, so encode()
+    // exercises both trie matching and chunk substitution.  The warmup
+    // phase populates the chunk library.
+    std::vector<std::string> tokens;
+    const std::vector<std::string> motifs = {
+        "open", "file", "read", "parse", "json", "emit",
+        "lock", "mutex", "write", "flush"};
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> pick(0, motifs.size() - 1);
+    while (tokens.size() < 256) {
+        size_t m = pick(rng);
+        tokens.push_back(motifs[m]);
+        tokens.push_back(motifs[(m + 1) % motifs.size()]);
+        tokens.push_back(motifs[(m + 2) % motifs.size()]);
+    }
+    auto r = bench::run(
+        "chunking/encode/tokens=" + std::to_string(tokens.size()),
+        [&] {
+            auto encoded = chunker.encode(tokens);
+            g_sink += encoded.size();
+        },
+        50);
+    bench::report(r, json_out);
+}
+
+static void bench_plan(FILE* json_out) {
+    // The production shape: many rollouts over a short horizon.  The
+    // concrete default models keep the simulation statically
+    // dispatched, so this measures the planning machinery (arena,
+    // workers, ranking) rather than std::function overhead.
+    imagination_engine::ImaginationEngine engine;
+    fdqc::Vec initial(8, 1.0);
+    fdqc::Vec goal(8, 0.0);
+    auto r = bench::run(
+        "imagination/plan/rollouts=1000",
+        [&] {
+            auto plan = engine.plan(
+                initial, goal, imagination_engine::DefaultWorldModel{},
+                imagination_engine::DefaultPolicy{},
+                imagination_engine::DefaultValueFunction{}, 5, 1000);
+            g_sink += plan.best_trajectory.states.size();
+        },
+        5, 300.0, 5);
+    bench::report(r, json_out);
+}
+
+static void bench_build_report(FILE* json_out) {
+    struct Case { const char* label; size_t bytes; };
+    for (const Case& c : {Case{"1KB", 1024},
+                          Case{"100KB", 100 * 1024},
+                          Case{"5MB", 5 * 1024 * 1024}}) {
+        std::string old_content = synthetic_content(c.bytes, "v1");
+        std::string new_content = edit_middle_lines(old_content);
+        auto r = bench::run(
+            std::string("change_audit/build_report/") + c.label,
+            [&] {
+                auto report = change_audit::build_report(
+                    "src/bench_target.cpp", old_content, new_content,
+                    "bench", "microbenchmark diff+hash");
+                g_sink += report.diff_sha256.size();
+            },
+            5, 300.0, 5);
+        bench::report(r, json_out);
+    }
+}
+
+static void bench_apply_change(FILE* json_out, const std::string& scratch) {
+    // Paths are resolved relative to ALLOWED_ROOT (the scratch tree).
+    // Seed the target so every measured call is a small edit to an
+    // existing file — the steady-state shape — rather than a
+    // high-risk file creation the FDQC evaluation would block.
+    std::string target = "bench_target.cpp";
+    std::string base = synthetic_content(1024, "apply");
+    {
+        std::ofstream seed(scratch + "/" + target);
+        seed << base;
+    }
+    // AUTO_EXPLAIN=on makes the explainer produce the schema-valid
+    // explanation the change gate checks in strict mode, while the
+    // caller-supplied explanation below feeds the FDQC
+    // explanation-quality check — together they keep every iteration
+    // on the allow path, as a well-behaved caller would be.
+    setenv("AUTO_EXPLAIN", "on", 1);
+    nlohmann::json explanation = {
+        {"what", "append a revision marker comment to the benchmark target"},
+        {"why", "because the microbenchmark needs a distinct change each "
+                "iteration; the purpose is to measure the steady-state cost "
+                "of the full apply pipeline"},
+        {"risk", "low for the reason that the change only appends one "
+                 "comment line and is reverted by removing the scratch tree"}};
+    size_t revision = 0;
+    auto r = bench::run(
+        "self_writer/apply_change/1KB",
+        [&] {
+            // Alternate the content each iteration so every call is a
+            // real change (snapshot, report, FDQC evaluation, write).
+            std::string content = base + "// revision " +
+                                  std::to_string(revision++) + "\n";
+            auto result = self_writer::apply_change(
+                target, content, "bench", "microbenchmark write",
+                &explanation);
+            g_sink += result.report_id.size();
+        },
+        3, 300.0, 5);
+    bench::report(r, json_out);
+}
+
+//===========================================================================
+// MAIN
+//===========================================================================
+
+int main() {
+    // Sandbox apply_change in a scratch tree: writes, snapshots and
+    // reports all land under it, and persistence/signing/strict-gate
+    // features stay off so the benchmark measures the default path.
+    std::string scratch = "/tmp/cockpit_bench_" + std::to_string(getpid());
+    std::filesystem::create_directories(scratch);
+    setenv("ALLOWED_ROOT", scratch.c_str(), 1);
+    setenv("CHANGE_LOG_DIR", (scratch + "/changes").c_str(), 1);
+    setenv("KILL_SWITCH_PATH", (scratch + "/KILL_SWITCH").c_str(), 1);
+    unsetenv("AUTO_EXPLAIN");
+    unsetenv("REQUIRE_EXPLANATION");
+    unsetenv("CHANGE_USE_SQLITE");
+    unsetenv("EPISODIC_MEMORY_PATH");
+    unsetenv("VCCA_QTABLE_PATH");
+    unsetenv("MORAL_POLICY_PATH");
+    unsetenv("ED25519_PRIV_HEX");
+    unsetenv("SNAPSHOT_KEY_HEX");
+
+    const char* out_env = std::getenv("BENCH_OUT");
+    std::string out_path = (out_env && *out_env) ? out_env
+                                                 : "logs/bench_results.jsonl";
+    std::filesystem::create_directories(
+        std::filesystem::path(out_path).parent_path());
+    FILE* json_out = std::fopen(out_path.c_str(), "a");
+
+    std::fprintf(stderr, "=== Cockpit Microbenchmarks ===\n");
+    bench_episodic_retrieve(json_out);
+    bench_collapse_cycle(json_out);
+    bench_chunker_encode(json_out);
+    bench_plan(json_out);
+    bench_build_report(json_out);
+    // self_writer resolves relative change paths against the current
+    // directory (the server runs with cwd at the allowed root), so
+    // enter the scratch tree for the apply_change benchmark.
+    if (chdir(scratch.c_str()) != 0) {
+        std::fprintf(stderr, "cannot chdir to %s\n", scratch.c_str());
+        return 1;
+    }
+    bench_apply_change(json_out, scratch);
+
+    if (json_out) {
+        std::fclose(json_out);
+    }
+    std::filesystem::remove_all(scratch);
+    std::fprintf(stderr, "=== Results appended to %s ===\n", out_path.c_str());
+    return 0;
+}
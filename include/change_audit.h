@@ -8,6 +8,9 @@
 #ifndef CHANGE_AUDIT_H
 #define CHANGE_AUDIT_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -91,6 +94,44 @@ Report build_report(const std::string &path,
 // change_audit.cpp for the naming scheme.
 std::string save_report(const Report &report, const std::string &out_dir);
 
+// Record that `path` now holds content whose SHA-256 is `sha256`.
+// The self_writer calls this after its atomic write so the next
+// change to the same file can serve its old-content hash from the
+// cache instead of re-hashing, as long as the file's mtime and size
+// still match (i.e. it was not modified outside Cockpit).
+void note_file_written(const std::string &path, const std::string &sha256);
+
+// Outcome of an incremental prev_hash chain verification run.
+struct ChainVerifyResult {
+    bool ok = true;          // chain intact up to the last row checked
+    uint64_t verified = 0;   // rows verified by this run
+    uint64_t total = 0;      // cumulative rows verified (checkpoint)
+    std::string first_bad;   // report ID of the first broken link
+};
+
+// Verify the tamper-evident prev_hash chain of the SQLite report
+// database under `out_dir`, resuming from the durable checkpoint left
+// by the previous run so only rows added since then are re-hashed.
+// Per-row hashes are computed in parallel; on a broken link the
+// checkpoint is not advanced past it, so the failure is reported
+// again on the next run.
+ChainVerifyResult verify_chain(const std::string &out_dir);
+
+// Sequentially visit every record in the binary report log under
+// `out_dir` (written when CHANGE_LOG_FORMAT=binary) in append order.
+// Segments are mmap'd whole, so a scan touches no per-report files;
+// this is the fast path for audit tooling such as chain verification.
+// The callback receives the report ID and parsed report JSON and
+// returns false to stop early.  Returns the number of records visited.
+size_t scan_report_log(
+    const std::string &out_dir,
+    const std::function<bool(const std::string &, const nlohmann::json &)> &fn);
+
+// Look up a single report by ID in the binary report log using the
+// sidecar index.  Returns false if the report is not in the log.
+bool load_logged_report(const std::string &out_dir, const std::string &report_id,
+                        nlohmann::json &out);
+
 } // namespace change_audit
 
 #endif // CHANGE_AUDIT_H
\ No newline at end of file
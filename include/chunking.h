@@ -11,6 +11,13 @@
 // - Replaces recognized patterns with single chunk tokens
 // - Effective capacity: C = n_WM × (1 + γ·N_chunks/100), max 1.75×
 //
+// Concurrency: the chunk library is published copy-on-write.  Readers
+// (encode, decode, find_matching_chunk) take a snapshot pointer to an
+// immutable library version and never block; learn_chunk() and
+// clear() build the next version and atomically swap it in.  Encodes
+// vastly outnumber learns, so the read path pays only one atomic
+// shared_ptr load per call.
+//
 // References:
 // - Miller (1956): Magical number seven, plus or minus two
 // - Cowan (2001): Working memory capacity of ~4 chunks
@@ -23,22 +30,45 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <cmath>
+#include <cstdint>
 
 namespace chunking {
 
 // Chunk representation
 struct Chunk {
-    std::vector<double> pattern;  // Pattern embedding (vector representation)
+    fdqc::Vec pattern;            // Pattern embedding (vector representation)
     std::vector<std::string> tokens;  // Original token sequence
-    size_t frequency;             // Usage count
+    // Usage count.  Mutable + atomic so encode() can bump it on the
+    // shared immutable library version without cloning it; an
+    // increment racing with a copy-on-write clone may be lost, which
+    // is acceptable for a pruning heuristic.
+    mutable std::atomic<size_t> frequency;
     double salience;              // Importance weight
-    
+
     Chunk() : frequency(0), salience(0.0) {}
-    
-    Chunk(const std::vector<double>& pat, const std::vector<std::string>& toks)
+
+    Chunk(const fdqc::Vec& pat, const std::vector<std::string>& toks)
         : pattern(pat), tokens(toks), frequency(1), salience(0.0) {}
+
+    // Copyable despite the atomic member (the library clone copies
+    // chunks by value).
+    Chunk(const Chunk& other)
+        : pattern(other.pattern), tokens(other.tokens),
+          frequency(other.frequency.load(std::memory_order_relaxed)),
+          salience(other.salience) {}
+
+    Chunk& operator=(const Chunk& other) {
+        pattern = other.pattern;
+        tokens = other.tokens;
+        frequency.store(other.frequency.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+        salience = other.salience;
+        return *this;
+    }
 };
 
 // Chunker statistics
@@ -47,116 +77,208 @@ struct ChunkingStats {
     size_t sequences_processed;  // Total sequences encoded
     double average_compression;  // Average compression ratio
     double capacity_multiplier;  // Current capacity boost
-    
-    ChunkingStats() 
+
+    ChunkingStats()
         : total_chunks(0), sequences_processed(0),
           average_compression(1.0), capacity_multiplier(1.0) {}
 };
 
+// Pattern embedding dimensionality (shared by the embedding function
+// and the LSH hyperplanes)
+constexpr size_t CHUNK_EMBEDDING_DIM = 64;
+
+// Random-hyperplane LSH signature width.  12 bits with multi-probe
+// lookup (all signatures within Hamming distance 2) keeps candidate
+// sets small while recalling most pairs above the 0.9 similarity
+// threshold; a missed match only means a near-duplicate chunk is
+// learned, which pruning later reclaims.
+constexpr size_t LSH_SIGNATURE_BITS = 12;
+
 class Chunker {
 public:
     // Constructor
     Chunker();
-    
+
     // Encode sequence into chunked representation
     // Returns compressed sequence (some tokens may be chunk IDs)
     std::vector<std::string> encode(const std::vector<std::string>& tokens);
-    
+
     // Decode chunked representation back to original tokens
     std::vector<std::string> decode(const std::vector<std::string>& codes) const;
-    
-    // Learn chunk from pattern (update library)
-    void learn_chunk(const std::vector<double>& pattern_embedding,
+
+    // Learn chunk from pattern (publish a new library version)
+    void learn_chunk(const fdqc::Vec& pattern_embedding,
                     const std::vector<std::string>& tokens);
-    
+
     // Check if pattern matches existing chunk (similarity threshold)
-    int find_matching_chunk(const std::vector<double>& pattern_embedding) const;
-    
+    int find_matching_chunk(const fdqc::Vec& pattern_embedding) const;
+
     // Get effective capacity multiplier (1.0 to 1.75)
     double effective_capacity_multiplier() const;
-    
+
     // Calculate effective capacity for base dimensionality n
     double calculate_effective_capacity(int base_n) const;
-    
-    // Get statistics
-    const ChunkingStats& stats() const { return stats_; }
-    size_t chunk_count() const { return chunk_library_.size(); }
-    
+
+    // Get statistics (snapshot by value; the fields move together
+    // under the stats lock)
+    ChunkingStats stats() const;
+    size_t chunk_count() const { return snapshot()->chunks.size(); }
+
     // Clear chunk library (for retraining)
     void clear();
 
 private:
-    // Chunk library (ID → Chunk)
-    std::unordered_map<int, Chunk> chunk_library_;
-    
-    // Next chunk ID
-    int next_chunk_id_;
-    
-    // Statistics
+    // Trie over token sequences for exact-match lookup in encode().
+    // Nodes are owned by their parent; chunk_id < 0 marks an interior
+    // node with no chunk ending there.
+    struct TrieNode {
+        std::unordered_map<std::string, std::unique_ptr<TrieNode>> children;
+        int chunk_id = -1;
+    };
+
+    // One version of the chunk library and its indexes.  Versions are
+    // published through `library_` below and never mutated afterwards
+    // (except the advisory atomic frequency counters inside Chunk);
+    // writers clone the current version, mutate the clone, then swap
+    // it in.
+    struct Library {
+        // Chunk library (ID → Chunk)
+        std::unordered_map<int, Chunk> chunks;
+
+        // LSH index: signature → chunk IDs whose pattern hashes there.
+        std::unordered_map<uint32_t, std::vector<int>> lsh_buckets;
+
+        // Exact-match index over chunk token sequences
+        TrieNode trie_root;
+
+        // Next chunk ID
+        int next_chunk_id = 1000;
+    };
+
+    // Current published version.  Accessed via std::atomic_load /
+    // std::atomic_store so readers need no lock.
+    std::shared_ptr<const Library> library_;
+
+    // Serializes writers (learn_chunk, clear); readers never take it.
+    mutable std::mutex writer_mutex_;
+
+    // Statistics, guarded by their own narrow lock since encode()
+    // (a reader of the library) still updates them.
+    mutable std::mutex stats_mutex_;
     ChunkingStats stats_;
-    
+
+    // LSH hyperplanes, stored flat (LSH_SIGNATURE_BITS rows of
+    // CHUNK_EMBEDDING_DIM) and generated deterministically so
+    // signatures are stable across runs.  Immutable after the
+    // constructor, hence shared by every library version.
+    fdqc::Vec lsh_planes_;
+
+    // Helper: current published library version
+    std::shared_ptr<const Library> snapshot() const {
+        return std::atomic_load(&library_);
+    }
+
+    // Helper: atomically publish the next version
+    void publish(std::shared_ptr<const Library> next) {
+        std::atomic_store(&library_, std::move(next));
+    }
+
+    // Helper: deep-copy a library version (chunks, buckets, trie)
+    static std::shared_ptr<Library> clone_library(const Library& lib);
+    static void clone_trie(const TrieNode& src, TrieNode& dst);
+
     // Helper: compute cosine similarity between two vectors
-    static double cosine_similarity(const std::vector<double>& a,
-                                   const std::vector<double>& b);
-    
+    static double cosine_similarity(const fdqc::Vec& a,
+                                   const fdqc::Vec& b);
+
     // Helper: compute embedding for token sequence (simplified)
-    std::vector<double> compute_embedding(const std::vector<std::string>& tokens) const;
-    
+    fdqc::Vec compute_embedding(const std::vector<std::string>& tokens) const;
+
+    // Helper: generate the LSH hyperplanes (called once from ctor)
+    void init_lsh_planes();
+
+    // Helper: sign pattern of the embedding against each hyperplane
+    uint32_t lsh_signature(const fdqc::Vec& embedding) const;
+
+    // Helper: find_matching_chunk against a specific version
+    int find_matching_chunk_in(const Library& lib,
+                               const fdqc::Vec& pattern_embedding) const;
+
+    // Helper: add/remove a chunk in both indexes of a writer's clone
+    void index_chunk(Library& lib, int chunk_id, const Chunk& chunk);
+    void unindex_chunk(Library& lib, int chunk_id, const Chunk& chunk);
+
+    // Helper: longest chunk whose tokens match starting at tokens[start]
+    // (length 2..4); returns chunk ID or -1, sets match_len on success
+    int trie_longest_match(const Library& lib,
+                           const std::vector<std::string>& tokens,
+                           size_t start, size_t& match_len) const;
+
     // Helper: update statistics
     void update_stats(size_t original_length, size_t compressed_length);
-    
-    // Helper: decay less-used chunks (LRU-style pruning)
-    void prune_library_if_needed();
+
+    // Helper: decay less-used chunks on a writer's clone (LRU-style
+    // pruning; runs at learn time, the only point the library grows)
+    void prune_library_if_needed(Library& lib);
 };
 
 //===========================================================================
 // INLINE IMPLEMENTATIONS
 //===========================================================================
 
-inline Chunker::Chunker() : next_chunk_id_(1000) {
-    // Start chunk IDs at 1000 to distinguish from regular tokens
+inline Chunker::Chunker() : library_(std::make_shared<Library>()) {
+    // Chunk IDs start at 1000 (Library's next_chunk_id default) to
+    // distinguish them from regular tokens
+    init_lsh_planes();
 }
 
 inline double Chunker::effective_capacity_multiplier() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     return stats_.capacity_multiplier;
 }
 
 inline double Chunker::calculate_effective_capacity(int base_n) const {
     // C_effective = n_WM × (1 + γ·N_chunks/100)
     // Capped at 1.75× base capacity (to match Miller's 7±2)
-    double boost = 1.0 + fdqc_params::CHUNK_GAMMA * 
-                   chunk_library_.size() / 100.0;
+    double boost = 1.0 + fdqc_params::CHUNK_GAMMA *
+                   snapshot()->chunks.size() / 100.0;
     double multiplier = std::min(boost, fdqc_params::CHUNK_BOOST_MAX);
-    
+
     return base_n * multiplier;
 }
 
+inline ChunkingStats Chunker::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
 inline void Chunker::clear() {
-    chunk_library_.clear();
-    next_chunk_id_ = 1000;
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    publish(std::make_shared<const Library>());
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     stats_ = ChunkingStats();
 }
 
-inline double Chunker::cosine_similarity(const std::vector<double>& a,
-                                        const std::vector<double>& b) {
+inline double Chunker::cosine_similarity(const fdqc::Vec& a,
+                                        const fdqc::Vec& b) {
     if (a.size() != b.size() || a.empty()) {
         return 0.0;
     }
-    
+
     double dot = 0.0, norm_a = 0.0, norm_b = 0.0;
     for (size_t i = 0; i < a.size(); ++i) {
         dot += a[i] * b[i];
         norm_a += a[i] * a[i];
         norm_b += b[i] * b[i];
     }
-    
+
     if (norm_a < fdqc_params::EPSILON || norm_b < fdqc_params::EPSILON) {
         return 0.0;
     }
-    
+
     return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
 }
 
 } // namespace chunking
 
-#endif // CHUNKING_H
\ No newline at end of file
+#endif // CHUNKING_H
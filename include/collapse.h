@@ -88,6 +88,16 @@ public:
     CollapsedState process_cycle(
         const std::vector<double>& probabilities,
         bool force_collapse = false);
+
+    // Batch collapse: `rows` is a row-major matrix of probability
+    // vectors (rows.size() / row_dim rows of row_dim each).  Each row
+    // gets the same entropy-threshold treatment as process_cycle(),
+    // computed in one pass and split across threads for large
+    // batches.  Statistics are folded in once for the whole batch
+    // (mean entropy, aggregate collapse count) rather than per row.
+    std::vector<CollapsedState> process_cycle_batch(
+        const std::vector<double>& rows, size_t row_dim,
+        bool force_collapse = false);
     
     // Get statistics
     const CollapseStats& stats() const { return stats_; }
@@ -103,16 +113,22 @@ private:
     double entropy_threshold_;      // Collapse trigger threshold
     double base_threshold_;         // Base threshold (before neuromodulation)
     CollapseStats stats_;           // Monitoring statistics
-    
+    std::vector<double> scratch_;   // Reused per-cycle buffer (no
+                                    // allocation inside the hot loop)
+
     // Helper: sample from Gumbel distribution
     static double sample_gumbel();
-    
-    // Helper: compute softmax with temperature
-    static std::vector<double> softmax(const std::vector<double>& logits, 
-                                       double temperature);
+
+    // Helper: compute softmax with temperature into out (stable
+    // max-subtraction fused into the vectorized exp pass)
+    static void softmax_into(const std::vector<double>& logits,
+                             double temperature, std::vector<double>& out);
     
     // Helper: update running statistics
     void update_stats(double entropy, bool collapsed);
+
+    // Helper: fold a whole batch into the statistics at once
+    void update_stats_batch(double mean_entropy, size_t rows, size_t collapsed);
 };
 
 //===========================================================================
@@ -20,13 +20,17 @@
 #include <utility>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <mutex>
+#include <queue>
+#include <random>
+#include <unordered_map>
 
 namespace episodic_memory {
 
 // Episodic memory entry
 struct Episode {
-    std::vector<double> embedding;      // Global workspace encoding
+    fdqc::Vec embedding;                // Global workspace encoding
     std::string metadata;               // Textual description
     double importance;                  // Consolidation importance
     double affective_valence;           // Emotional valence at encoding
@@ -37,7 +41,7 @@ struct Episode {
         timestamp = std::chrono::steady_clock::now();
     }
     
-    Episode(const std::vector<double>& emb, const std::string& meta,
+    Episode(const fdqc::Vec& emb, const std::string& meta,
             double imp, double valence)
         : embedding(emb), metadata(meta), importance(imp), 
           affective_valence(valence), retrieval_count(0) {
@@ -45,7 +49,9 @@ struct Episode {
     }
 };
 
-// Retrieval result with similarity score
+// Retrieval result with similarity score.  `index` is the episode's
+// stable id, assigned at encoding and never reused, so results remain
+// meaningful across pruning and compaction.
 struct RetrievalResult {
     Episode episode;
     double similarity;
@@ -74,13 +80,86 @@ struct MemoryStats {
           average_importance(0.0), pruning_events(0) {}
 };
 
+// Hierarchical navigable small-world (HNSW) graph over normalized
+// embeddings.  Provides approximate k-NN retrieval in roughly
+// logarithmic time instead of a linear scan over every episode.
+// The index stores its own float32 normalized copies of the vectors
+// (cosine similarity reduces to a dot product) and maps internal
+// nodes back to episode indices via ids_.  Maintained incrementally
+// by record(); rebuilt from scratch after pruning compacts the store.
+class HnswIndex {
+public:
+    explicit HnswIndex(size_t M = 16, size_t ef_construction = 100);
+
+    // Insert an embedding under the given external id.  Returns false
+    // if the vector dimension does not match the index (the caller
+    // falls back to linear scan).
+    bool add(const fdqc::Vec& embedding, size_t id);
+
+    // Approximate k-NN: returns external ids of the closest stored
+    // vectors, best first.  ef controls search breadth (>= k).
+    std::vector<size_t> search(const fdqc::Vec& query,
+                               size_t k, size_t ef) const;
+
+    void clear();
+    size_t size() const { return ids_.size(); }
+    size_t dim() const { return dim_; }
+
+private:
+    // Per-node adjacency, one neighbor list per layer.
+    struct Node {
+        int level;
+        std::vector<std::vector<uint32_t>> neighbors;
+    };
+
+    // Distance between a normalized query and a stored vector:
+    // 1 - dot product (equivalent ordering to cosine distance).
+    float distance(const float* query, uint32_t node) const;
+
+    // Normalize into float32; returns empty vector on zero norm.
+    std::vector<float> normalize(const fdqc::Vec& v) const;
+
+    // Greedy best-first search within one layer.
+    std::vector<std::pair<float, uint32_t>> search_layer(
+        const float* query, uint32_t entry, size_t ef, int layer) const;
+
+    size_t M_;                    // max neighbors per layer (2*M_ at layer 0)
+    size_t ef_construction_;      // search breadth during insertion
+    double level_mult_;           // 1 / ln(M): expected layer decay
+    size_t dim_ = 0;
+    std::vector<float> data_;     // n * dim_ normalized vectors
+    std::vector<size_t> ids_;     // internal node -> external id
+    std::vector<Node> nodes_;
+    int max_level_ = -1;
+    uint32_t entry_point_ = 0;
+    std::mt19937 rng_{12345};
+};
+
+// On-disk format constants for the memory-mapped episode store.
+// Records are fixed-size so the file can be mapped and appended to in
+// place; metadata longer than EPISODE_META_BYTES is truncated.
+constexpr size_t EPISODE_META_BYTES = 224;
+
 class EpisodicMemory {
 public:
     // Constructor
     EpisodicMemory();
+    ~EpisodicMemory();
+
+    EpisodicMemory(const EpisodicMemory&) = delete;
+    EpisodicMemory& operator=(const EpisodicMemory&) = delete;
+
+    // Attach a memory-mapped on-disk store.  If the file exists its
+    // episodes are bulk-loaded (one pass over the mapping) so learned
+    // importance/novelty state survives restarts; otherwise the file
+    // is created lazily once the embedding dimension is known.
+    // Subsequent record() calls append to the mapping in place.
+    // Returns false if the file exists but cannot be mapped or has an
+    // incompatible header (persistence is then disabled).
+    bool set_persistence(const std::string& path);
     
     // Record episode with full metadata
-    void record(const std::vector<double>& embedding,
+    void record(const fdqc::Vec& embedding,
                const std::string& metadata,
                double importance,
                double affective_valence = 0.0);
@@ -89,12 +168,16 @@ public:
     void record(const std::vector<float>& embedding, const std::string& metadata);
     
     // Retrieve k most similar episodes
-    std::vector<RetrievalResult> retrieve(const std::vector<double>& query_embedding,
+    std::vector<RetrievalResult> retrieve(const fdqc::Vec& query_embedding,
                                          size_t k = fdqc_params::KNN_NEIGHBORS) const;
     
-    // Simplified retrieve (backward compatibility)
+#ifndef FDQC_SCALAR_FLOAT
+    // Simplified retrieve (backward compatibility).  In float builds
+    // the scalar overload above already takes float vectors, so this
+    // signature would collide and is compiled out.
     std::vector<std::pair<std::vector<float>, std::string>> retrieve(
         const std::vector<float>& embedding, size_t k) const;
+#endif
     
     // Retrieve episodes above importance threshold
     std::vector<Episode> get_important_episodes(double threshold) const;
@@ -102,44 +185,134 @@ public:
     // Retrieve recent episodes (last N)
     std::vector<Episode> get_recent_episodes(size_t n) const;
     
-    // Apply memory decay (importance fades over time)
+    // Apply memory decay (importance fades over time).  O(1): bumps a
+    // decay epoch counter instead of sweeping the store; effective
+    // importance is derived lazily from each episode's encoding epoch.
     void apply_decay();
     
-    // Prune least important memories if over capacity
+    // Prune least important memories if over capacity.  Victims are
+    // popped from a lazy min-heap (O(log N) each) and tombstoned in
+    // place; compaction runs only once enough garbage accumulates.
     void prune_if_needed();
-    
-    // Get memory size
-    size_t size() const { return episodes_.size(); }
-    
+
+    // Get memory size (live episodes only)
+    size_t size() const { return live_count_; }
+
     // Check if empty
-    bool empty() const { return episodes_.empty(); }
-    
+    bool empty() const { return live_count_ == 0; }
+
+    // Get embedding dimension (0 until the first episode is recorded)
+    size_t dim() const { return dim_; }
+
     // Get statistics
     const MemoryStats& stats() const { return stats_; }
-    
+
     // Clear all memories
     void clear();
 
 private:
-    std::vector<Episode> episodes_;
+    // Per-episode bookkeeping without the embedding.  Embeddings live
+    // in the flat float32 matrix below (structure-of-arrays layout):
+    // one contiguous row per episode instead of a heap allocation per
+    // Episode, halving memory and turning scans into sequential reads.
+    struct EpisodeMeta {
+        std::string metadata;
+        double importance;          // As recorded; decay applied lazily
+        double affective_valence;
+        std::chrono::steady_clock::time_point timestamp;
+        size_t retrieval_count;
+        uint64_t decay_epoch;       // Value of decay_epochs_ at encoding
+        uint64_t id;                // Stable id (never reused)
+        bool alive;                 // False once tombstoned by pruning
+    };
+
+    size_t dim_ = 0;                // Embedding dimension (fixed at first record)
+    std::vector<float> matrix_;     // meta_.size() x dim_ row-major embeddings
+    std::vector<float> norms_;      // Per-row L2 norm (for cosine)
+    std::vector<EpisodeMeta> meta_;
+    HnswIndex index_;               // Approximate k-NN over episode embeddings
     MemoryStats stats_;
-    mutable std::mutex mutex_;  // Thread safety
-    
-    // Helper: compute cosine similarity
-    static double cosine_similarity(const std::vector<double>& a,
-                                   const std::vector<double>& b);
-    
-    // Helper: convert float vector to double vector
-    static std::vector<double> float_to_double(const std::vector<float>& vec);
-    
-    // Helper: convert double vector to float vector
-    static std::vector<float> double_to_float(const std::vector<double>& vec);
-    
+    uint64_t decay_epochs_ = 0;     // Total apply_decay() calls so far
+    uint64_t persisted_epoch_ = 0;  // decay_epochs_ folded into the store
+    mutable std::mutex mutex_;      // Thread safety
+
+    // Tombstoned eviction state.  Slots of pruned episodes stay in the
+    // SoA arrays (marked !alive) and are reused by record() via the
+    // free list; id_to_slot_ resolves stable ids to current slots and
+    // drops entries on tombstoning, which also soft-deletes the
+    // episode from the ANN index (dead candidates are skipped).
+    uint64_t next_id_ = 0;
+    size_t live_count_ = 0;
+    size_t dead_in_index_ = 0;      // Tombstoned nodes still in the index
+    std::vector<size_t> free_slots_;
+    std::unordered_map<uint64_t, size_t> id_to_slot_;
+
+    // Lazy eviction min-heap of (pruning score at push, id).  Scores
+    // drift as episodes age, decay and get retrieved, so popped
+    // entries are revalidated against the current score and re-pushed
+    // when stale; tombstoned ids are simply skipped.
+    using HeapEntry = std::pair<double, uint64_t>;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>,
+                        std::greater<HeapEntry>> evict_heap_;
+
+    // Memory-mapped persistence (inactive unless set_persistence()
+    // succeeds).  The mapping covers header + embedding matrix +
+    // fixed-size records; appends write directly into it.
+    std::string persist_path_;
+    int persist_fd_ = -1;
+    void* persist_base_ = nullptr;
+    size_t persist_size_ = 0;
+
+    // Create and map the store file (requires dim_ > 0).
+    bool create_store();
+    // Map an existing store and load its episodes.
+    bool load_store();
+    // Rewrite the mapped store from the in-memory arrays (after
+    // pruning compacts the store).
+    void rewrite_store();
+    // Append episode `index` to the mapped store.
+    void append_to_store(size_t index);
+    // Unmap and close the store file.
+    void close_store();
+
+    // Rebuild the ANN index from the current episode store (after
+    // pruning has compacted indices).
+    void rebuild_index();
+
+    // Pruning score of a live slot: effective importance plus a
+    // retrieval bonus minus a logarithmic age penalty.
+    double prune_score(size_t slot,
+                       std::chrono::steady_clock::time_point now) const;
+
+    // Mark a live slot dead: free-list it, drop its id mapping and
+    // update the live/dead accounting.
+    void tombstone(size_t slot);
+
+    // Drop dead slots from the SoA arrays, rebuild the ANN index over
+    // the survivors and rewrite the persisted store to match.
+    void compact();
+
+    // Coerce an embedding into a float32 row of dim_ (pad or truncate).
+    std::vector<float> to_row(const fdqc::Vec& vec) const;
+
+    // Materialize a full Episode (with embedding) for the public API.
+    Episode materialize(size_t index) const;
+
+    // Importance of episode `index` with decay folded in: the base
+    // importance shrinks by MEMORY_DECAY_RATE for every decay epoch
+    // elapsed since the episode was encoded.
+    double effective_importance(size_t index) const;
+
+    // Cosine similarity between a query row and stored row `index`,
+    // computed with the vectorized dot-product kernel.
+    double row_similarity(const float* query, float query_norm,
+                          size_t index) const;
+
     // Helper: update running statistics
     void update_stats(double importance);
-    
-    // Helper: mark episode as retrieved
-    void mark_retrieved(size_t index) const;
+
+    // Helper: mark episode as retrieved (by stable id)
+    void mark_retrieved(size_t id) const;
 };
 
 //===========================================================================
@@ -147,50 +320,14 @@ private:
 //===========================================================================
 
 inline EpisodicMemory::EpisodicMemory() {
-    episodes_.reserve(fdqc_params::MAX_EPISODIC_MEMORIES);
-}
-
-inline void EpisodicMemory::clear() {
-    episodes_.clear();
-    stats_ = MemoryStats();
-}
-
-inline std::vector<double> EpisodicMemory::float_to_double(
-    const std::vector<float>& vec) {
-    return std::vector<double>(vec.begin(), vec.end());
-}
-
-inline std::vector<float> EpisodicMemory::double_to_float(
-    const std::vector<double>& vec) {
-    return std::vector<float>(vec.begin(), vec.end());
-}
-
-inline double EpisodicMemory::cosine_similarity(
-    const std::vector<double>& a,
-    const std::vector<double>& b) {
-    
-    if (a.size() != b.size() || a.empty()) {
-        return 0.0;
-    }
-    
-    double dot = 0.0, norm_a = 0.0, norm_b = 0.0;
-    for (size_t i = 0; i < a.size(); ++i) {
-        dot += a[i] * b[i];
-        norm_a += a[i] * a[i];
-        norm_b += b[i] * b[i];
-    }
-    
-    if (norm_a < fdqc_params::EPSILON || norm_b < fdqc_params::EPSILON) {
-        return 0.0;
-    }
-    
-    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+    meta_.reserve(fdqc_params::MAX_EPISODIC_MEMORIES);
 }
 
-inline void EpisodicMemory::mark_retrieved(size_t index) const {
-    if (index < episodes_.size()) {
+inline void EpisodicMemory::mark_retrieved(size_t id) const {
+    auto it = id_to_slot_.find(id);
+    if (it != id_to_slot_.end()) {
         // Const cast to allow retrieval count update
-        const_cast<Episode&>(episodes_[index]).retrieval_count++;
+        const_cast<EpisodeMeta&>(meta_[it->second]).retrieval_count++;
     }
 }
 
@@ -18,6 +18,7 @@
 #define EPISTEMIC_DRIVE_H
 
 #include "fdqc_params.h"
+#include <algorithm>
 #include <cmath>
 #include <deque>
 #include <vector>
@@ -68,8 +69,10 @@ struct EpistemicStats {
 
 class EpistemicDrive {
 public:
-    // Constructor
-    explicit EpistemicDrive(double sigma_threshold = fdqc_params::CRISIS_Z_SCORE_THRESHOLD);
+    // Constructor.  `window` sets the effective averaging window of
+    // the exponentially weighted error statistics (alpha = 2/(W+1)).
+    explicit EpistemicDrive(double sigma_threshold = fdqc_params::CRISIS_Z_SCORE_THRESHOLD,
+                            size_t window = fdqc_params::ERROR_HISTORY_WINDOW);
     
     // Update with new prediction error
     bool update(double prediction_error);
@@ -90,6 +93,13 @@ public:
     // Get threshold
     double threshold() const { return sigma_threshold_; }
     void set_threshold(double sigma) { sigma_threshold_ = sigma; }
+
+    // Effective averaging window of the error statistics.  Smaller
+    // windows track regime changes faster; crisis sensitivity stays
+    // constant over uptime because old errors are aged out by the
+    // exponential weighting rather than accumulated forever.
+    size_t window() const { return window_; }
+    void set_window(size_t w);
     
     // Get recent crises
     std::vector<CrisisEvent> get_recent_crises(size_t n) const;
@@ -106,11 +116,16 @@ public:
 private:
     double sigma_threshold_;        // 5-sigma default
     bool in_crisis_;                // Currently in crisis mode
-    
-    // Error tracking
-    std::deque<double> error_history_;
-    double mean_;                   // Running mean
-    double std_dev_;                // Running std dev
+
+    // Streaming error statistics: exponentially weighted mean and
+    // variance, updated in O(1) per observation with no stored
+    // history.  alpha_ is derived from window_ (alpha = 2/(W+1)).
+    size_t window_;
+    double alpha_;
+    double mean_;                   // EW mean
+    double var_;                    // EW variance
+    double std_dev_;                // sqrt(var_), cached for readers
+    size_t samples_;                // Observations since clear()
     
     // Crisis tracking
     std::deque<CrisisEvent> crisis_history_;
@@ -132,10 +147,15 @@ private:
 // INLINE IMPLEMENTATIONS
 //===========================================================================
 
-inline EpistemicDrive::EpistemicDrive(double sigma_threshold)
+inline EpistemicDrive::EpistemicDrive(double sigma_threshold, size_t window)
     : sigma_threshold_(sigma_threshold), in_crisis_(false),
-      mean_(0.0), std_dev_(0.0) {
-    // Note: deque doesn't have reserve(), but that's okay
+      mean_(0.0), var_(0.0), std_dev_(0.0), samples_(0) {
+    set_window(window);
+}
+
+inline void EpistemicDrive::set_window(size_t w) {
+    window_ = std::max<size_t>(w, 2);
+    alpha_ = 2.0 / (static_cast<double>(window_) + 1.0);
 }
 
 inline void EpistemicDrive::reset_crisis() {
@@ -143,10 +163,11 @@ inline void EpistemicDrive::reset_crisis() {
 }
 
 inline void EpistemicDrive::clear() {
-    error_history_.clear();
     crisis_history_.clear();
     mean_ = 0.0;
+    var_ = 0.0;
     std_dev_ = 0.0;
+    samples_ = 0;
     in_crisis_ = false;
     stats_ = EpistemicStats();
 }
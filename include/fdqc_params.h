@@ -18,6 +18,27 @@
 
 #include <cstddef>
 #include <array>
+#include <vector>
+
+// Embedding scalar precision.  The embedding pipeline (episodic
+// memory, preconscious buffer, imagination rollouts, theory of mind,
+// chunking) carries state in fdqc::Vec end to end; compile with
+// -DFDQC_SCALAR_FLOAT to run it in float32, halving the memory
+// bandwidth of every similarity and rollout kernel with no conversion
+// copies at module boundaries.  The collapse loop keeps double
+// precision regardless: its vectors are tiny (n ≤ 15) and its SIMD
+// exp/log2 kernels are double-only.
+namespace fdqc {
+
+#ifdef FDQC_SCALAR_FLOAT
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+using Vec = std::vector<Scalar>;
+
+} // namespace fdqc
 
 namespace fdqc_params {
 
@@ -134,6 +155,9 @@ constexpr size_t MAX_EPISODIC_MEMORIES = 10000;
 // Similarity search k-nearest neighbors
 constexpr size_t KNN_NEIGHBORS = 5;
 
+// HNSW index search breadth (candidates examined at layer 0)
+constexpr size_t HNSW_EF_SEARCH = 64;
+
 //===========================================================================
 // 8. AFFECTIVE CORE PARAMETERS
 //===========================================================================
@@ -30,9 +30,16 @@
 #include "imagination_engine.h"
 #include "meta_monitor.h"
 #include "epistemic_drive.h"
-#include "reward.h"
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -102,14 +109,32 @@ struct SystemSnapshot {
 // Main FDQC system class
 class FDQCSystem {
 public:
-    // Constructor
-    FDQCSystem();
-    
+    // Constructor.  attach_persistence controls whether this instance
+    // binds the memory-mapped episodic store named by
+    // EPISODIC_MEMORY_PATH; when several instances coexist (the
+    // evaluation pool in self_writer), exactly one may attach, since
+    // the store is a single shared mapping.
+    explicit FDQCSystem(bool attach_persistence = true);
+    ~FDQCSystem();
+
+    FDQCSystem(const FDQCSystem&) = delete;
+    FDQCSystem& operator=(const FDQCSystem&) = delete;
+
+
     // Evaluate a proposed code change
     EvaluationResult evaluate_change(const ChangeContext& context);
+
+    // Evaluate a queue of changes in one pass.  The pipeline is
+    // staged — all embeddings, then all novelty checks, then all
+    // quality/risk scores, then the stateful cognitive stages in
+    // input order — so each stage runs with warm caches and the
+    // consolidation queue is locked once per batch instead of once
+    // per change.  Results are returned in input order.
+    std::vector<EvaluationResult> evaluate_changes(
+        const std::vector<ChangeContext>& contexts);
     
     // Process one cognitive cycle (for testing/simulation)
-    void process_cycle(const std::vector<double>& stimulus);
+    void process_cycle(const fdqc::Vec& stimulus);
     
     // Get current system state
     SystemSnapshot get_snapshot() const;
@@ -151,9 +176,47 @@ private:
     
     // Episode counter
     size_t episode_count_;
-    
-    // Helper: compute change embedding
-    std::vector<double> compute_change_embedding(const ChangeContext& context);
+
+    // Background consolidation: evaluate_change() only enqueues
+    // candidate episodes; this stage drains them in batches, dedups
+    // and records into episodic memory off the request path.
+    struct PendingEpisode {
+        fdqc::Vec embedding;
+        std::string metadata;
+        double importance;
+        double valence;
+    };
+
+    std::vector<PendingEpisode> pending_episodes_;          // guarded by consolidation_mutex_
+    std::vector<fdqc::Vec> recent_consolidated_;            // dedup window, same guard
+    std::mutex consolidation_mutex_;
+    std::condition_variable consolidation_cv_;
+    std::atomic<bool> consolidation_running_{false};
+    std::thread consolidation_thread_;
+
+    // Consolidation thread body: wait, drain, repeat
+    void consolidation_loop();
+
+    // Drain the pending queue once (also called on shutdown)
+    void consolidate_pending();
+
+
+    // Per-evaluation arena: evaluate_change() builds its short-lived
+    // vector data in a monotonic resource over this buffer and
+    // releases it wholesale at the end of the call, so the request
+    // path performs no general-purpose heap allocation for vectors.
+    std::array<std::byte, 4096> eval_arena_buffer_;
+
+    // Helper: compute change embedding (into arena-backed storage)
+    void compute_change_embedding(const ChangeContext& context,
+                                  std::pmr::vector<fdqc::Scalar>& out);
+
+    // Helper: the stateful cognitive stages shared by the single and
+    // batch paths (affect, crisis/VCCA, meta-monitor, recommendation,
+    // reasoning, phenomenal report).  Expects explanation_quality and
+    // epistemic_risk to be filled in already.
+    void run_cognitive_stages(const ChangeContext& context, bool is_novel,
+                              EvaluationResult& result);
     
     // Helper: assess explanation quality
     double assess_explanation_quality(const ChangeContext& context);
@@ -170,14 +233,42 @@ private:
 // INLINE IMPLEMENTATIONS
 //===========================================================================
 
-inline FDQCSystem::FDQCSystem()
+inline FDQCSystem::FDQCSystem(bool attach_persistence)
     : vcca_(fdqc_params::N_WM_BASE),
       collapse_(fdqc_params::N_WM_BASE),
       episode_count_(0) {
-    // All modules use default constructors
+    // Attach the memory-mapped episodic store when configured, so a
+    // restarted server warm-starts with its learned episodic state.
+    if (attach_persistence) {
+        const char* mem_path = std::getenv("EPISODIC_MEMORY_PATH");
+        if (mem_path && *mem_path) {
+            memory_.set_persistence(mem_path);
+        }
+        const char* q_path = std::getenv("VCCA_QTABLE_PATH");
+        if (q_path && *q_path) {
+            vcca_.set_persistence(q_path);
+        }
+    }
+    consolidation_running_ = true;
+    consolidation_thread_ = std::thread(&FDQCSystem::consolidation_loop, this);
+}
+
+inline FDQCSystem::~FDQCSystem() {
+    consolidation_running_ = false;
+    consolidation_cv_.notify_all();
+    if (consolidation_thread_.joinable()) {
+        consolidation_thread_.join();
+    }
+    // Flush anything enqueued after the final loop pass
+    consolidate_pending();
 }
 
 inline void FDQCSystem::reset() {
+    {
+        std::lock_guard<std::mutex> lock(consolidation_mutex_);
+        pending_episodes_.clear();
+        recent_consolidated_.clear();
+    }
     vcca_ = vcca_controller::VCCAController(fdqc_params::N_WM_BASE);
     collapse_ = collapse::CollapseLoop(fdqc_params::N_WM_BASE);
     affective_.reset();
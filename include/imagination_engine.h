@@ -18,16 +18,21 @@
 #include "fdqc_params.h"
 #include <vector>
 #include <functional>
+#include <random>
 #include <string>
 #include <memory>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
 
 namespace imagination_engine {
 
 // Simulation trajectory (sequence of states and actions)
 struct Trajectory {
-    std::vector<std::vector<double>> states;
-    std::vector<std::vector<double>> actions;
+    std::vector<fdqc::Vec> states;
+    std::vector<fdqc::Vec> actions;
     std::vector<double> rewards;
     double total_return;            // Discounted cumulative reward
     double value_estimate;          // Expected future value
@@ -47,18 +52,58 @@ struct PlanResult {
 
 // Dream sample (creative exploration result)
 struct DreamSample {
-    std::vector<double> state;
+    fdqc::Vec state;
     std::string description;
     double novelty;                 // How unexpected/creative
     double coherence;               // How plausible
     
     DreamSample() : novelty(0.0), coherence(0.5) {}
     
-    DreamSample(const std::vector<double>& s, const std::string& desc,
+    DreamSample(const fdqc::Vec& s, const std::string& desc,
                 double nov, double coh)
         : state(s), description(desc), novelty(nov), coherence(coh) {}
 };
 
+// Built-in models as concrete types.  Rollouts instantiated against
+// these (or any other concrete model types) dispatch statically, so
+// every simulation step inlines instead of paying three std::function
+// indirections; the std::function setters below remain the flexible
+// fallback.
+
+// Default world model: simple linear dynamics
+struct DefaultWorldModel {
+    fdqc::Vec operator()(const fdqc::Vec& state,
+                         const fdqc::Vec& action) const {
+        // next_state = state + scaled action effect
+        fdqc::Vec next_state(state.size());
+        for (size_t i = 0; i < state.size(); ++i) {
+            double action_val = (i < action.size()) ? action[i] : 0.0;
+            next_state[i] = static_cast<fdqc::Scalar>(state[i] + action_val * 0.1);
+        }
+        return next_state;
+    }
+};
+
+// Default value function: reward for being close to origin
+struct DefaultValueFunction {
+    double operator()(const fdqc::Vec& state) const {
+        double distance = std::sqrt(std::inner_product(
+            state.begin(), state.end(), state.begin(), 0.0));
+        return -distance;
+    }
+};
+
+// Default policy: proportional control toward origin
+struct DefaultPolicy {
+    fdqc::Vec operator()(const fdqc::Vec& state) const {
+        fdqc::Vec action(state.size());
+        for (size_t i = 0; i < state.size(); ++i) {
+            action[i] = static_cast<fdqc::Scalar>(-state[i] * 0.5);
+        }
+        return action;
+    }
+};
+
 // Imagination statistics
 struct ImaginationStats {
     size_t planning_episodes;
@@ -77,11 +122,29 @@ public:
     // Constructor
     ImaginationEngine();
     
-    // Planning: Goal-directed forward simulation
-    PlanResult plan(const std::vector<double>& initial_state,
-                   const std::vector<double>& goal_state,
+    // Planning: Goal-directed forward simulation (dispatches through
+    // the std::function models)
+    PlanResult plan(const fdqc::Vec& initial_state,
+                   const fdqc::Vec& goal_state,
                    size_t horizon = fdqc_params::PLANNING_HORIZON,
                    size_t num_rollouts = 10);
+
+    // Planning against concrete model types: same algorithm and
+    // PlanResult, but simulation steps are statically dispatched and
+    // inlinable.  Example:
+    //   engine.plan(s, g, DefaultWorldModel{}, DefaultPolicy{},
+    //               DefaultValueFunction{}, horizon, rollouts);
+    template <typename WorldModel, typename Policy, typename Value>
+    PlanResult plan(const fdqc::Vec& initial_state,
+                   const fdqc::Vec& goal_state,
+                   const WorldModel& world_model,
+                   const Policy& policy,
+                   const Value& value_fn,
+                   size_t horizon = fdqc_params::PLANNING_HORIZON,
+                   size_t num_rollouts = 10) {
+        return plan_impl(world_model, policy, value_fn,
+                         initial_state, goal_state, horizon, num_rollouts);
+    }
     
     // Backward compatibility with functional policy
     void plan(const std::vector<float>& state,
@@ -97,8 +160,8 @@ public:
     
     // Counterfactual reasoning: "What if I had done X instead?"
     Trajectory simulate_counterfactual(
-        const std::vector<double>& state,
-        const std::vector<double>& alternative_action,
+        const fdqc::Vec& state,
+        const fdqc::Vec& alternative_action,
         size_t horizon = 5);
     
     // Evaluate action sequence value
@@ -107,16 +170,16 @@ public:
     
     // Set world model (forward dynamics function)
     void set_world_model(
-        std::function<std::vector<double>(const std::vector<double>&, 
-                                         const std::vector<double>&)> model);
+        std::function<fdqc::Vec(const fdqc::Vec&,
+                                const fdqc::Vec&)> model);
     
     // Set value function (state evaluation)
     void set_value_function(
-        std::function<double(const std::vector<double>&)> value_fn);
+        std::function<double(const fdqc::Vec&)> value_fn);
     
     // Set policy function (state → action)
     void set_policy_function(
-        std::function<std::vector<double>(const std::vector<double>&)> policy_fn);
+        std::function<fdqc::Vec(const fdqc::Vec&)> policy_fn);
     
     // Get statistics
     const ImaginationStats& stats() const { return stats_; }
@@ -126,44 +189,145 @@ public:
 
 private:
     // World model: (state, action) → next_state
-    std::function<std::vector<double>(const std::vector<double>&,
-                                     const std::vector<double>&)> world_model_;
+    std::function<fdqc::Vec(const fdqc::Vec&,
+                            const fdqc::Vec&)> world_model_;
     
     // Value function: state → expected return
-    std::function<double(const std::vector<double>&)> value_function_;
+    std::function<double(const fdqc::Vec&)> value_function_;
     
     // Policy function: state → action
-    std::function<std::vector<double>(const std::vector<double>&)> policy_function_;
+    std::function<fdqc::Vec(const fdqc::Vec&)> policy_function_;
     
     ImaginationStats stats_;
-    
-    // Helper: simulate one rollout
-    Trajectory simulate_rollout(const std::vector<double>& start_state,
+
+    // Reusable rollout arena.  plan_impl() writes every rollout's
+    // states, actions and rewards into flat matrices indexed by
+    // (rollout, step) instead of one vector-of-vectors Trajectory per
+    // rollout.  The buffers grow to the high-water mark once and are
+    // recycled between plan() calls, so steady-state planning does
+    // not touch the allocator for trajectory storage; only the best
+    // trajectory and top alternatives are materialized as Trajectory
+    // values at the end.  plan() is not reentrant per engine (the
+    // FDQC pool serializes each instance behind its slot mutex);
+    // worker threads within one plan() write disjoint rows.
+    struct TrajectoryArena {
+        std::vector<fdqc::Scalar> states;    // (horizon+1) × state_dim per rollout
+        std::vector<fdqc::Scalar> actions;   // horizon × action_dim per rollout
+        std::vector<double> rewards;         // horizon per rollout
+        std::vector<double> returns;         // discounted return per rollout
+        std::vector<double> value_estimates; // ranking key per rollout
+        std::vector<size_t> order;           // index-sort scratch
+        size_t horizon = 0;
+        size_t state_dim = 0;
+        size_t action_dim = 0;
+
+        void reset(size_t num_rollouts, size_t horizon_in,
+                   size_t state_dim_in, size_t action_dim_in) {
+            horizon = horizon_in;
+            state_dim = state_dim_in;
+            action_dim = action_dim_in;
+            // resize() never shrinks capacity, so after the first
+            // call at a given shape these are pure size updates.
+            states.resize(num_rollouts * (horizon + 1) * state_dim);
+            actions.resize(num_rollouts * horizon * action_dim);
+            rewards.resize(num_rollouts * horizon);
+            returns.resize(num_rollouts);
+            value_estimates.resize(num_rollouts);
+            order.resize(num_rollouts);
+        }
+
+        fdqc::Scalar* state_row(size_t rollout, size_t step) {
+            return states.data() + (rollout * (horizon + 1) + step) * state_dim;
+        }
+        const fdqc::Scalar* state_row(size_t rollout, size_t step) const {
+            return states.data() + (rollout * (horizon + 1) + step) * state_dim;
+        }
+        fdqc::Scalar* action_row(size_t rollout, size_t step) {
+            return actions.data() + (rollout * horizon + step) * action_dim;
+        }
+        const fdqc::Scalar* action_row(size_t rollout, size_t step) const {
+            return actions.data() + (rollout * horizon + step) * action_dim;
+        }
+        double* reward_row(size_t rollout) {
+            return rewards.data() + rollout * horizon;
+        }
+        const double* reward_row(size_t rollout) const {
+            return rewards.data() + rollout * horizon;
+        }
+    };
+    TrajectoryArena arena_;
+
+    // Core planning algorithm, parameterized over the model types so
+    // concrete models dispatch statically (defined below)
+    template <typename WorldModel, typename Policy, typename Value>
+    PlanResult plan_impl(const WorldModel& world_model,
+                        const Policy& policy,
+                        const Value& value_fn,
+                        const fdqc::Vec& initial_state,
+                        const fdqc::Vec& goal_state,
+                        size_t horizon,
+                        size_t num_rollouts);
+
+    // Core rollout, same parameterization.  Takes the caller's RNG so
+    // rollouts can run on worker threads without sharing generator
+    // state.
+    template <typename WorldModel, typename Policy, typename Value>
+    Trajectory simulate_rollout_impl(const WorldModel& world_model,
+                                    const Policy& policy,
+                                    const Value& value_fn,
+                                    const fdqc::Vec& start_state,
+                                    size_t horizon,
+                                    double temperature,
+                                    std::mt19937& rng);
+
+    // Core rollout writing into the arena: same stepping as
+    // simulate_rollout_impl, but states/actions/rewards land in the
+    // rollout's flat rows, so the trajectory itself allocates nothing
+    template <typename WorldModel, typename Policy, typename Value>
+    void simulate_rollout_into(const WorldModel& world_model,
+                              const Policy& policy,
+                              const Value& value_fn,
+                              const fdqc::Vec& start_state,
+                              double temperature,
+                              std::mt19937& rng,
+                              size_t rollout);
+
+    // Helper: copy a vector into a fixed-width arena row (truncating
+    // or zero-padding a model that changes dimensionality mid-plan)
+    static void fill_row(const fdqc::Vec& src, fdqc::Scalar* row,
+                         size_t width) {
+        size_t n = std::min(src.size(), width);
+        std::copy(src.begin(), src.begin() + n, row);
+        std::fill(row + n, row + width, fdqc::Scalar(0));
+    }
+
+    // Helper: materialize one arena rollout as a Trajectory value
+    Trajectory arena_trajectory(size_t rollout) const;
+
+    // Helper: simulate one rollout through the std::function models
+    Trajectory simulate_rollout(const fdqc::Vec& start_state,
                                size_t horizon,
-                               double temperature = 1.0);
-    
-    // Helper: default world model (simple linear dynamics)
-    std::vector<double> default_world_model(const std::vector<double>& state,
-                                           const std::vector<double>& action);
-    
-    // Helper: default value function (distance to origin)
-    double default_value_function(const std::vector<double>& state);
-    
-    // Helper: default policy (move toward origin)
-    std::vector<double> default_policy(const std::vector<double>& state);
-    
+                               double temperature,
+                               std::mt19937& rng);
+
     // Helper: sample random action for exploration
-    std::vector<double> sample_random_action(size_t action_dim);
+    static fdqc::Vec sample_random_action(size_t action_dim,
+                                            std::mt19937& rng);
     
     // Helper: compute state distance
-    static double state_distance(const std::vector<double>& a,
-                                const std::vector<double>& b);
-    
-    // Helper: convert float to double
-    static std::vector<double> float_to_double(const std::vector<float>& vec);
+    static double state_distance(const fdqc::Vec& a,
+                                const fdqc::Vec& b);
+
+    // Helper: state distance against a flat arena row
+    static double state_distance(const fdqc::Scalar* a, size_t a_len,
+                                const fdqc::Vec& b);
     
-    // Helper: convert double to float
-    static std::vector<float> double_to_float(const std::vector<double>& vec);
+    // Helper: convert float input to the embedding scalar type (a
+    // straight copy when fdqc::Scalar is float)
+    static fdqc::Vec to_scalar(const std::vector<float>& vec);
+
+    // Helper: convert back for the float compatibility API
+    static std::vector<float> to_float(const fdqc::Vec& vec);
 };
 
 //===========================================================================
@@ -171,18 +335,11 @@ private:
 //===========================================================================
 
 inline ImaginationEngine::ImaginationEngine() {
-    // Set default models
-    world_model_ = [this](const std::vector<double>& s, const std::vector<double>& a) {
-        return this->default_world_model(s, a);
-    };
-    
-    value_function_ = [this](const std::vector<double>& s) {
-        return this->default_value_function(s);
-    };
-    
-    policy_function_ = [this](const std::vector<double>& s) {
-        return this->default_policy(s);
-    };
+    // Set default models (the concrete types, usable directly with
+    // the templated plan() for static dispatch)
+    world_model_ = DefaultWorldModel{};
+    value_function_ = DefaultValueFunction{};
+    policy_function_ = DefaultPolicy{};
 }
 
 inline void ImaginationEngine::reset_stats() {
@@ -190,34 +347,32 @@ inline void ImaginationEngine::reset_stats() {
 }
 
 inline void ImaginationEngine::set_world_model(
-    std::function<std::vector<double>(const std::vector<double>&,
-                                     const std::vector<double>&)> model) {
+    std::function<fdqc::Vec(const fdqc::Vec&,
+                            const fdqc::Vec&)> model) {
     world_model_ = model;
 }
 
 inline void ImaginationEngine::set_value_function(
-    std::function<double(const std::vector<double>&)> value_fn) {
+    std::function<double(const fdqc::Vec&)> value_fn) {
     value_function_ = value_fn;
 }
 
 inline void ImaginationEngine::set_policy_function(
-    std::function<std::vector<double>(const std::vector<double>&)> policy_fn) {
+    std::function<fdqc::Vec(const fdqc::Vec&)> policy_fn) {
     policy_function_ = policy_fn;
 }
 
-inline std::vector<double> ImaginationEngine::float_to_double(
-    const std::vector<float>& vec) {
-    return std::vector<double>(vec.begin(), vec.end());
+inline fdqc::Vec ImaginationEngine::to_scalar(const std::vector<float>& vec) {
+    return fdqc::Vec(vec.begin(), vec.end());
 }
 
-inline std::vector<float> ImaginationEngine::double_to_float(
-    const std::vector<double>& vec) {
+inline std::vector<float> ImaginationEngine::to_float(const fdqc::Vec& vec) {
     return std::vector<float>(vec.begin(), vec.end());
 }
 
 inline double ImaginationEngine::state_distance(
-    const std::vector<double>& a,
-    const std::vector<double>& b) {
+    const fdqc::Vec& a,
+    const fdqc::Vec& b) {
     
     if (a.size() != b.size()) return 1e9;
     
@@ -230,6 +385,261 @@ inline double ImaginationEngine::state_distance(
     return std::sqrt(sum_sq);
 }
 
+inline double ImaginationEngine::state_distance(
+    const fdqc::Scalar* a, size_t a_len,
+    const fdqc::Vec& b) {
+
+    if (a_len != b.size()) return 1e9;
+
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < a_len; ++i) {
+        double diff = a[i] - b[i];
+        sum_sq += diff * diff;
+    }
+
+    return std::sqrt(sum_sq);
+}
+
+inline Trajectory ImaginationEngine::arena_trajectory(size_t rollout) const {
+    Trajectory traj;
+    traj.states.reserve(arena_.horizon + 1);
+    traj.actions.reserve(arena_.horizon);
+    traj.rewards.reserve(arena_.horizon);
+    for (size_t step = 0; step <= arena_.horizon; ++step) {
+        const fdqc::Scalar* row = arena_.state_row(rollout, step);
+        traj.states.emplace_back(row, row + arena_.state_dim);
+    }
+    for (size_t step = 0; step < arena_.horizon; ++step) {
+        const fdqc::Scalar* row = arena_.action_row(rollout, step);
+        traj.actions.emplace_back(row, row + arena_.action_dim);
+    }
+    const double* rewards = arena_.reward_row(rollout);
+    traj.rewards.assign(rewards, rewards + arena_.horizon);
+    traj.total_return = arena_.returns[rollout];
+    traj.value_estimate = arena_.value_estimates[rollout];
+    return traj;
+}
+
+//===========================================================================
+// TEMPLATED PLANNING CORE
+//===========================================================================
+
+template <typename WorldModel, typename Policy, typename Value>
+Trajectory ImaginationEngine::simulate_rollout_impl(
+    const WorldModel& world_model,
+    const Policy& policy,
+    const Value& value_fn,
+    const fdqc::Vec& start_state,
+    size_t horizon,
+    double temperature,
+    std::mt19937& rng) {
+
+    Trajectory traj;
+    traj.states.push_back(start_state);
+
+    fdqc::Vec current_state = start_state;
+
+    for (size_t step = 0; step < horizon; ++step) {
+        // Select action (with temperature for exploration)
+        fdqc::Vec action;
+
+        if (temperature > 1.5) {
+            // High temperature: more random exploration
+            action = sample_random_action(4, rng);  // 4D action space
+        } else {
+            // Normal temperature: use policy with noise
+            action = policy(current_state);
+
+            // Add exploration noise
+            if (temperature > 0.1) {
+                std::normal_distribution<> noise(0.0, temperature * 0.5);
+
+                for (fdqc::Scalar& a : action) {
+                    a += static_cast<fdqc::Scalar>(noise(rng));
+                }
+            }
+        }
+
+        traj.actions.push_back(action);
+
+        // Apply world model
+        current_state = world_model(current_state, action);
+        traj.states.push_back(current_state);
+
+        // Compute reward
+        double reward = value_fn(current_state);
+        traj.rewards.push_back(reward);
+    }
+
+    // Compute total return (discounted sum of rewards)
+    traj.total_return = evaluate_trajectory(traj);
+    traj.value_estimate = traj.total_return;
+
+    return traj;
+}
+
+template <typename WorldModel, typename Policy, typename Value>
+void ImaginationEngine::simulate_rollout_into(
+    const WorldModel& world_model,
+    const Policy& policy,
+    const Value& value_fn,
+    const fdqc::Vec& start_state,
+    double temperature,
+    std::mt19937& rng,
+    size_t rollout) {
+
+    fill_row(start_state, arena_.state_row(rollout, 0), arena_.state_dim);
+
+    fdqc::Vec current_state = start_state;
+    double* rewards = arena_.reward_row(rollout);
+
+    for (size_t step = 0; step < arena_.horizon; ++step) {
+        // Select action (with temperature for exploration)
+        fdqc::Vec action;
+
+        if (temperature > 1.5) {
+            // High temperature: more random exploration
+            action = sample_random_action(4, rng);  // 4D action space
+        } else {
+            // Normal temperature: use policy with noise
+            action = policy(current_state);
+
+            // Add exploration noise
+            if (temperature > 0.1) {
+                std::normal_distribution<> noise(0.0, temperature * 0.5);
+
+                for (fdqc::Scalar& a : action) {
+                    a += static_cast<fdqc::Scalar>(noise(rng));
+                }
+            }
+        }
+
+        fill_row(action, arena_.action_row(rollout, step), arena_.action_dim);
+
+        // Apply world model
+        current_state = world_model(current_state, action);
+        fill_row(current_state, arena_.state_row(rollout, step + 1),
+                 arena_.state_dim);
+
+        // Compute reward
+        rewards[step] = value_fn(current_state);
+    }
+
+    // Compute total return (discounted sum of rewards)
+    double total_return = 0.0;
+    double discount_factor = 1.0;
+    for (size_t step = 0; step < arena_.horizon; ++step) {
+        total_return += discount_factor * rewards[step];
+        discount_factor *= fdqc_params::PLAN_DISCOUNT_GAMMA;
+    }
+    arena_.returns[rollout] = total_return;
+    arena_.value_estimates[rollout] = total_return;
+}
+
+template <typename WorldModel, typename Policy, typename Value>
+PlanResult ImaginationEngine::plan_impl(
+    const WorldModel& world_model,
+    const Policy& policy,
+    const Value& value_fn,
+    const fdqc::Vec& initial_state,
+    const fdqc::Vec& goal_state,
+    size_t horizon,
+    size_t num_rollouts) {
+
+    PlanResult result;
+    result.rollouts_performed = num_rollouts;
+
+    // Size the arena for this plan.  One probe call sizes the action
+    // rows: the planning temperature is 1.0, so every action comes
+    // from the policy and shares its dimensionality.
+    size_t action_dim = policy(initial_state).size();
+    arena_.reset(num_rollouts, horizon, initial_state.size(), action_dim);
+
+    // Rollouts are independent, so they are dispatched across worker
+    // threads.  Workers pull indices from a shared atomic counter, so
+    // a thread that finishes its rollout early immediately takes the
+    // next one — load balancing without per-thread queues.  Each
+    // worker owns its RNG; results land in the rollout's arena rows,
+    // so no synchronization is needed on the output side.
+    std::atomic<size_t> next_rollout{0};
+
+    auto run_rollouts = [&](uint32_t seed) {
+        std::mt19937 rng(seed);
+        for (;;) {
+            size_t i = next_rollout.fetch_add(1, std::memory_order_relaxed);
+            if (i >= num_rollouts) {
+                break;
+            }
+            simulate_rollout_into(world_model, policy, value_fn,
+                                  initial_state, 1.0, rng, i);
+
+            // Evaluate trajectory based on reaching goal
+            double goal_distance = state_distance(
+                arena_.state_row(i, horizon), arena_.state_dim, goal_state);
+            arena_.value_estimates[i] = -goal_distance;  // Negative distance as reward
+        }
+    };
+
+    std::random_device rd;
+    size_t hw = std::thread::hardware_concurrency();
+    size_t num_threads = std::min(hw ? hw : 1, num_rollouts / 8);
+
+    if (num_threads >= 2) {
+        std::vector<std::thread> workers;
+        workers.reserve(num_threads);
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back(run_rollouts, rd());
+        }
+        for (std::thread& w : workers) {
+            w.join();
+        }
+    } else {
+        run_rollouts(rd());
+    }
+    stats_.total_rollouts += num_rollouts;
+
+    // Reduction: rank rollouts by value through an index sort over
+    // the arena's value column; trajectory data never moves
+    std::vector<size_t>& order = arena_.order;
+    std::iota(order.begin(), order.end(), size_t(0));
+    size_t top_n = std::min(size_t(4), num_rollouts);
+    std::partial_sort(order.begin(), order.begin() + top_n, order.end(),
+                      [&](size_t a, size_t b) {
+                          return arena_.value_estimates[a] >
+                                 arena_.value_estimates[b];
+                      });
+
+    // Confidence based on value gap
+    if (num_rollouts > 1) {
+        double best_value = arena_.value_estimates[order[0]];
+        double second_value = arena_.value_estimates[order[1]];
+        double gap = std::abs(best_value - second_value);
+        // Confidence approaches 1 as the gap grows, and is 0 for no gap.
+        result.confidence = 1.0 - std::exp(-gap);
+    } else {
+        // High confidence if there's only one possible plan.
+        result.confidence = 1.0;
+    }
+
+    // Materialize only the winners: the best trajectory plus the top
+    // alternatives.  Everything else stays in the arena and is
+    // overwritten by the next plan().
+    result.best_trajectory = arena_trajectory(order[0]);
+    result.alternatives.reserve(top_n - 1);
+    for (size_t i = 1; i < top_n; ++i) {
+        result.alternatives.push_back(arena_trajectory(order[i]));
+    }
+
+    // Update statistics
+    stats_.planning_episodes++;
+    stats_.average_plan_length = (stats_.average_plan_length *
+                                 (stats_.planning_episodes - 1) +
+                                 result.best_trajectory.states.size()) /
+                                 stats_.planning_episodes;
+
+    return result;
+}
+
 } // namespace imagination_engine
 
 #endif // IMAGINATION_ENGINE_H
\ No newline at end of file
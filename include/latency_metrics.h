@@ -0,0 +1,77 @@
+// latency_metrics.h
+//
+// Low-overhead latency instrumentation for the apply_change pipeline.
+// A ScopedTimer reads the cycle counter on entry and exit and folds
+// the delta into a per-thread, per-stage histogram; /api/metrics
+// aggregates every thread's buckets on scrape and renders them in
+// Prometheus histogram exposition format.  The hot path is two TSC
+// reads and one relaxed counter increment (no locks, no clock
+// syscalls), so the instrumentation can stay enabled in production.
+//
+// Buckets are powers of two in cycles; boundaries are converted to
+// seconds at scrape time using a once-calibrated TSC frequency, so
+// the record path never multiplies or divides.  On targets without a
+// cycle counter the timer falls back to steady_clock nanoseconds.
+
+#ifndef LATENCY_METRICS_H
+#define LATENCY_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace latency_metrics {
+
+// Instrumented stages of self_writer::apply_change, in pipeline
+// order.  STAGE_COUNT must stay last.
+enum class Stage {
+    VALIDATE_PATH = 0,
+    MORAL_CORE,
+    BUILD_REPORT,
+    FDQC_EVALUATE,
+    SNAPSHOT_WRITE,
+    DB_INSERT,
+    STAGE_COUNT
+};
+
+constexpr size_t N_STAGES = static_cast<size_t>(Stage::STAGE_COUNT);
+
+// Power-of-two histogram buckets over cycle deltas: bucket k counts
+// durations in [2^k, 2^(k+1)) cycles, with the last bucket open-ended.
+// 40 buckets cover sub-microsecond through multi-second on any
+// plausible TSC frequency.
+constexpr size_t N_BUCKETS = 40;
+
+// Read the cycle counter (TSC on x86, generic counter on aarch64,
+// steady_clock nanoseconds elsewhere).
+uint64_t read_cycles();
+
+// Fold one duration (in cycles) into the calling thread's histogram
+// for `stage`.  Lock-free; counters are relaxed atomics read by the
+// scrape path.
+void record(Stage stage, uint64_t cycles);
+
+// RAII stage timer for use at the instrumentation sites.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Stage stage)
+        : stage_(stage), start_(read_cycles()) {}
+    ~ScopedTimer() { record(stage_, read_cycles() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Stage stage_;
+    uint64_t start_;
+};
+
+// Aggregate all threads' histograms (live and retired) and render
+// them as Prometheus histograms named cockpit_apply_stage_seconds
+// with a `stage` label.  Calibrates the TSC frequency on first call.
+std::string render_prometheus();
+
+} // namespace latency_metrics
+
+#endif // LATENCY_METRICS_H
@@ -21,10 +21,11 @@
 #define META_MONITOR_H
 
 #include "fdqc_params.h"
+#include <algorithm>
 #include <vector>
 #include <string>
-#include <deque>
 #include <cmath>
+#include <cstdint>
 
 namespace meta_monitor {
 
@@ -126,12 +127,26 @@ public:
     void clear();
 
 private:
-    std::deque<ProcessObservation> observations_;
+    // Fixed-size ring of the last MAX_HISTORY observations; head_ is
+    // the next write slot.  Rolling entropy sums are maintained on
+    // insert/evict so the aggregate statistics behind
+    // evaluate_self_awareness() are O(1) regardless of uptime.
+    std::vector<ProcessObservation> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint64_t total_observed_ = 0;
+    double entropy_sum_ = 0.0;
+    double entropy_sumsq_ = 0.0;
     MetaStats stats_;
-    
+
     // Maximum observation history
     static constexpr size_t MAX_HISTORY = 100;
-    
+
+    // Most recent observation (count_ must be > 0)
+    const ProcessObservation& latest() const {
+        return ring_[(head_ + MAX_HISTORY - 1) % MAX_HISTORY];
+    }
+
     // Helper: map intensity (compression)
     double compute_intensity() const;
     
@@ -155,19 +170,22 @@ private:
 // INLINE IMPLEMENTATIONS
 //===========================================================================
 
-inline MetaMonitor::MetaMonitor() {
-    observations_.clear();
-}
+inline MetaMonitor::MetaMonitor() = default;
 
 inline void MetaMonitor::clear() {
-    observations_.clear();
+    ring_.clear();
+    head_ = 0;
+    count_ = 0;
+    total_observed_ = 0;
+    entropy_sum_ = 0.0;
+    entropy_sumsq_ = 0.0;
     stats_ = MetaStats();
 }
 
 inline void MetaMonitor::record_entropy(double value) {
     ProcessObservation obs;
-    if (!observations_.empty()) {
-        obs = observations_.back();
+    if (count_ > 0) {
+        obs = latest();
     }
     obs.entropy = value;
     observe(obs);
@@ -175,8 +193,8 @@ inline void MetaMonitor::record_entropy(double value) {
 
 inline void MetaMonitor::record_collapse(double frequency) {
     ProcessObservation obs;
-    if (!observations_.empty()) {
-        obs = observations_.back();
+    if (count_ > 0) {
+        obs = latest();
     }
     obs.collapse_frequency = frequency;
     observe(obs);
@@ -184,33 +202,36 @@ inline void MetaMonitor::record_collapse(double frequency) {
 
 inline void MetaMonitor::record_dimension(int n) {
     ProcessObservation obs;
-    if (!observations_.empty()) {
-        obs = observations_.back();
+    if (count_ > 0) {
+        obs = latest();
     }
     obs.working_memory_dimension = n;
     observe(obs);
 }
 
 inline double MetaMonitor::last_entropy() const {
-    return observations_.empty() ? 0.0 : observations_.back().entropy;
+    return count_ == 0 ? 0.0 : latest().entropy;
 }
 
 inline double MetaMonitor::last_collapse() const {
-    return observations_.empty() ? 10.0 : observations_.back().collapse_frequency;
+    return count_ == 0 ? 10.0 : latest().collapse_frequency;
 }
 
 inline int MetaMonitor::last_dimension() const {
-    return observations_.empty() ? 4 : observations_.back().working_memory_dimension;
+    return count_ == 0 ? 4 : latest().working_memory_dimension;
 }
 
 inline std::vector<ProcessObservation> MetaMonitor::get_recent_observations(
     size_t n) const {
-    
-    size_t start = (observations_.size() > n) ? observations_.size() - n : 0;
-    return std::vector<ProcessObservation>(
-        observations_.begin() + start,
-        observations_.end()
-    );
+    size_t take = std::min(n, count_);
+    std::vector<ProcessObservation> result;
+    result.reserve(take);
+    // Oldest-first, same as the old deque slice.
+    size_t start = (head_ + MAX_HISTORY - take) % MAX_HISTORY;
+    for (size_t i = 0; i < take; ++i) {
+        result.push_back(ring_[(start + i) % MAX_HISTORY]);
+    }
+    return result;
 }
 
 } // namespace meta_monitor
@@ -1,11 +1,21 @@
 // moral_core.h
 //
-// A placeholder moral core implementation for C++.  In the Python
-// version a "moral core" decides whether a plan of action should be
-// blocked based on ethical and policy rules.  For the C++ port we
-// provide a stub that always allows the action to proceed.  In a
-// production deployment this header would declare an interface into a
-// real policy engine.
+// Policy engine deciding whether a plan of action should be blocked.
+// Rules are loaded from the JSON file named by MORAL_POLICY_PATH and
+// compiled once at startup into fast matchers (a trie for path globs,
+// a combined Aho-Corasick automaton for content patterns), so the
+// screen sits cheaply in the mandatory apply_change path even with
+// thousands of rules.  Policy file format:
+//
+//   {
+//     "deny_paths":    ["secrets/*", "config/prod/*"],
+//     "allow_authors": ["alice", "bob"],
+//     "deny_content":  ["BEGIN RSA PRIVATE KEY"],
+//     "deny_symbols":  ["unsafe_exec"]
+//   }
+//
+// All keys are optional; an absent MORAL_POLICY_PATH means no rules
+// and every plan is allowed.
 
 #ifndef MORAL_CORE_H
 #define MORAL_CORE_H
@@ -24,10 +34,10 @@ struct Decision {
 };
 
 // Evaluate a plan of action and decide whether it should be allowed.
-// The `plan` JSON may contain any fields relevant to the policy engine
-// such as the intent, file name and a diff hash.  This stub always
-// returns `block=false`.  Replace or wrap this function with a real
-// policy engine to enforce your own alignment rules.
+// The `plan` JSON is screened against the compiled policy: "author"
+// against the allowlist, "file" against the path trie, and "content"
+// in a single automaton pass over the denied content and symbol
+// patterns.  Absent fields simply skip their checks.
 Decision choose(const nlohmann::json &plan);
 
 } // namespace moral_core
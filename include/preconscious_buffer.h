@@ -4,41 +4,50 @@
 //
 // Implements iconic/echoic memory: a 2-second rolling buffer of sensory
 // inputs before conscious access. Provides:
-// - Circular buffer with timestamp tracking
+// - Lock-free fixed-capacity ring with preallocated slots
 // - Similarity-based retrieval (avoid redundant encoding)
 // - Importance-gated consolidation to episodic memory
 // - Automatic time-based expiration
 //
 // Corresponds to sensory memory in Atkinson-Shiffrin model (1968).
 // Duration matches iconic/echoic memory (~2 seconds).
+//
+// Concurrency model: writers claim a logical position with a single
+// fetch_add and publish into a fixed POD slot guarded by a per-slot
+// sequence number (odd = write in progress, 2*pos+2 = generation pos
+// committed).  Readers copy a slot and validate the sequence around
+// the copy, so contents() never blocks push() and vice versa.
+// Expiration is epoch-based: a tail counter advances past expired
+// positions instead of erasing anything.
 
 #ifndef PRECONSCIOUS_BUFFER_H
 #define PRECONSCIOUS_BUFFER_H
 
 #include "fdqc_params.h"
-#include <deque>
+#include <array>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <cmath>
-#include <mutex>
 
 namespace preconscious_buffer {
 
 // Buffer entry with metadata
 struct BufferEntry {
-    std::vector<double> embedding;  // Vector representation
+    fdqc::Vec embedding;            // Vector representation
     std::string content;            // Raw content (optional)
     std::chrono::steady_clock::time_point timestamp;
     double salience;                // Importance score
     double similarity_to_previous;  // Similarity to last entry
-    
+
     BufferEntry() : salience(0.0), similarity_to_previous(0.0) {
         timestamp = std::chrono::steady_clock::now();
     }
-    
-    BufferEntry(const std::vector<double>& emb, const std::string& cont, double sal)
+
+    BufferEntry(const fdqc::Vec& emb, const std::string& cont, double sal)
         : embedding(emb), content(cont), salience(sal), similarity_to_previous(0.0) {
         timestamp = std::chrono::steady_clock::now();
     }
@@ -50,75 +59,140 @@ struct BufferStats {
     size_t consolidations;          // Entries promoted to episodic memory
     double average_salience;
     size_t duplicates_filtered;     // High-similarity entries skipped
-    
-    BufferStats() 
+
+    BufferStats()
         : total_entries_processed(0), consolidations(0),
           average_salience(0.0), duplicates_filtered(0) {}
 };
 
+// Fixed per-slot bounds.  Slots are plain-old-data so a torn read can
+// never chase a dangling pointer; embeddings and content beyond the
+// caps are truncated on entry (current producers stay well below).
+constexpr size_t SLOT_EMBEDDING_MAX = 256;
+constexpr size_t SLOT_CONTENT_MAX = 192;
+
 class PreConsciousBuffer {
 public:
     // Constructor
     PreConsciousBuffer();
-    
+
+    PreConsciousBuffer(const PreConsciousBuffer&) = delete;
+    PreConsciousBuffer& operator=(const PreConsciousBuffer&) = delete;
+
     // Add entry with vector embedding
-    void push(const std::vector<double>& embedding, 
+    void push(const fdqc::Vec& embedding,
+             const std::string& content = "",
+             double salience = 0.5);
+
+    // Raw-pointer variant: slots copy into fixed POD arrays anyway,
+    // so callers holding arena- or stack-backed embeddings can push
+    // without materializing a std::vector
+    void push(const fdqc::Scalar* embedding, size_t embedding_len,
              const std::string& content = "",
              double salience = 0.5);
-    
+
     // Simplified push (backward compatibility)
     void push(const std::string& entry);
-    
-    // Get all current entries (non-expired)
+
+    // Get all current entries (non-expired), oldest first
     std::vector<BufferEntry> contents() const;
-    
+
     // Get entries above salience threshold
     std::vector<BufferEntry> get_salient_entries(double threshold) const;
-    
-    // Find similar entries (cosine similarity)
-    std::vector<size_t> find_similar(const std::vector<double>& query_embedding,
+
+    // Find similar entries (cosine similarity).  Indices refer to the
+    // non-expired snapshot in the same order as contents().
+    std::vector<size_t> find_similar(const fdqc::Vec& query_embedding,
                                      double threshold = fdqc_params::BUFFER_SIMILARITY_THRESHOLD) const;
-    
+
     // Check if similar entry exists (deduplication)
-    bool contains_similar(const std::vector<double>& embedding,
+    bool contains_similar(const fdqc::Vec& embedding,
                          double threshold = fdqc_params::BUFFER_SIMILARITY_THRESHOLD) const;
-    
+
+    // Raw-pointer variant; compares against slot storage in place, so
+    // the check performs no heap allocation at all
+    bool contains_similar(const fdqc::Scalar* embedding, size_t embedding_len,
+                         double threshold = fdqc_params::BUFFER_SIMILARITY_THRESHOLD) const;
+
     // Get most recent N entries
     std::vector<BufferEntry> get_recent(size_t n) const;
-    
-    // Clear expired entries (older than 2 seconds)
+
+    // Advance the tail epoch past entries older than 2 seconds
     void expire_old_entries();
-    
+
     // Clear all entries
     void clear();
-    
-    // Get buffer size
-    size_t size() const { return buffer_.size(); }
-    
+
+    // Get buffer size (entries between tail epoch and head)
+    size_t size() const;
+
     // Check if buffer is empty
-    bool empty() const { return buffer_.empty(); }
-    
-    // Get statistics
-    const BufferStats& stats() const { return stats_; }
-    
+    bool empty() const { return size() == 0; }
+
+    // Get statistics (assembled from the lock-free counters)
+    BufferStats stats() const;
+
     // Mark entry as consolidated to episodic memory
     void mark_consolidated(size_t index);
 
 private:
-    std::deque<BufferEntry> buffer_;
-    BufferStats stats_;
-    mutable std::mutex mutex_;  // Thread safety
-    
+    static constexpr size_t CAPACITY = fdqc_params::BUFFER_SIZE;
+
+    // Fixed-size POD slot.  seq is even when stable: 2*pos+2 marks
+    // generation pos committed; an odd value marks a write in
+    // progress.
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        fdqc::Scalar embedding[SLOT_EMBEDDING_MAX];
+        uint32_t embedding_len = 0;
+        char content[SLOT_CONTENT_MAX];
+        uint32_t content_len = 0;
+        int64_t timestamp_ns = 0;   // steady_clock time since epoch
+        double salience = 0.0;
+        double similarity_to_previous = 0.0;
+    };
+
+    std::array<Slot, CAPACITY> slots_;
+    std::atomic<uint64_t> head_{0};   // next logical position
+    std::atomic<uint64_t> tail_{0};   // oldest live position (epoch)
+
+    // Lock-free statistics counters
+    std::atomic<size_t> total_entries_{0};
+    std::atomic<size_t> consolidations_{0};
+    std::atomic<size_t> duplicates_filtered_{0};
+    std::atomic<double> average_salience_{0.0};
+
+    // Copy logical position pos out of the ring; false if the slot
+    // has been overwritten or a write is still in progress.
+    bool try_read_slot(uint64_t pos, BufferEntry& out) const;
+
+    // Seq-validated copy of just a slot's embedding (into a caller
+    // buffer of at least SLOT_EMBEDDING_MAX) and timestamp; avoids
+    // the BufferEntry heap allocations on similarity-only paths.
+    bool try_read_embedding(uint64_t pos, fdqc::Scalar* out, uint32_t& len,
+                            int64_t& timestamp_ns) const;
+
+    // Consistent copies of all live, non-expired entries, oldest first.
+    std::vector<BufferEntry> snapshot() const;
+
+    // Oldest logical position still backed by a slot.
+    uint64_t ring_begin(uint64_t head, uint64_t tail) const {
+        uint64_t oldest = (head > CAPACITY) ? head - CAPACITY : 0;
+        return (tail > oldest) ? tail : oldest;
+    }
+
     // Helper: compute cosine similarity
-    static double cosine_similarity(const std::vector<double>& a,
-                                   const std::vector<double>& b);
-    
+    static double cosine_similarity(const fdqc::Vec& a,
+                                   const fdqc::Vec& b);
+    static double cosine_similarity(const fdqc::Scalar* a, size_t a_len,
+                                   const fdqc::Scalar* b, size_t b_len);
+
     // Helper: check if entry is expired
-    bool is_expired(const BufferEntry& entry) const;
-    
+    static bool is_expired(const BufferEntry& entry);
+
     // Helper: compute embedding from string (simplified)
-    std::vector<double> string_to_embedding(const std::string& str) const;
-    
+    fdqc::Vec string_to_embedding(const std::string& str) const;
+
     // Helper: update running statistics
     void update_stats(double salience, bool is_duplicate);
 };
@@ -128,65 +202,75 @@ private:
 //===========================================================================
 
 inline PreConsciousBuffer::PreConsciousBuffer() {
-    // Note: std::deque doesn't have reserve(), but that's okay
-    // It manages memory automatically
+    // Slots are preallocated in place; nothing to set up
 }
 
 inline void PreConsciousBuffer::clear() {
-    buffer_.clear();
+    // Epoch jump: everything below head becomes unreachable
+    tail_.store(head_.load(std::memory_order_acquire),
+                std::memory_order_release);
 }
 
-inline std::vector<BufferEntry> PreConsciousBuffer::contents() const {
-    // Return non-expired entries
-    std::vector<BufferEntry> result;
-    result.reserve(buffer_.size());
-    
-    for (const auto& entry : buffer_) {
-        if (!is_expired(entry)) {
-            result.push_back(entry);
-        }
-    }
-    
-    return result;
+inline size_t PreConsciousBuffer::size() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    uint64_t begin = (head > CAPACITY) ? head - CAPACITY : 0;
+    if (tail > begin) begin = tail;
+    return (head > begin) ? static_cast<size_t>(head - begin) : 0;
+}
+
+inline BufferStats PreConsciousBuffer::stats() const {
+    BufferStats s;
+    s.total_entries_processed = total_entries_.load(std::memory_order_relaxed);
+    s.consolidations = consolidations_.load(std::memory_order_relaxed);
+    s.average_salience = average_salience_.load(std::memory_order_relaxed);
+    s.duplicates_filtered = duplicates_filtered_.load(std::memory_order_relaxed);
+    return s;
 }
 
-inline bool PreConsciousBuffer::is_expired(const BufferEntry& entry) const {
+inline bool PreConsciousBuffer::is_expired(const BufferEntry& entry) {
     auto now = std::chrono::steady_clock::now();
     auto age = std::chrono::duration_cast<std::chrono::milliseconds>(
         now - entry.timestamp).count();
-    
+
     // Expire after BUFFER_DURATION_SEC seconds
     return age > (fdqc_params::BUFFER_DURATION_SEC * 1000);
 }
 
 inline double PreConsciousBuffer::cosine_similarity(
-    const std::vector<double>& a,
-    const std::vector<double>& b) {
-    
-    if (a.size() != b.size() || a.empty()) {
+    const fdqc::Vec& a,
+    const fdqc::Vec& b) {
+    return cosine_similarity(a.data(), a.size(), b.data(), b.size());
+}
+
+inline double PreConsciousBuffer::cosine_similarity(
+    const fdqc::Scalar* a, size_t a_len,
+    const fdqc::Scalar* b, size_t b_len) {
+
+    if (a_len != b_len || a_len == 0) {
         return 0.0;
     }
-    
+
     double dot = 0.0, norm_a = 0.0, norm_b = 0.0;
-    for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t i = 0; i < a_len; ++i) {
         dot += a[i] * b[i];
         norm_a += a[i] * a[i];
         norm_b += b[i] * b[i];
     }
-    
+
     if (norm_a < fdqc_params::EPSILON || norm_b < fdqc_params::EPSILON) {
         return 0.0;
     }
-    
+
     return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
 }
 
 inline void PreConsciousBuffer::mark_consolidated(size_t index) {
-    if (index < buffer_.size()) {
-        stats_.consolidations++;
+    if (index < size()) {
+        consolidations_.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
 } // namespace preconscious_buffer
 
-#endif // PRECONSCIOUS_BUFFER_H
\ No newline at end of file
+#endif // PRECONSCIOUS_BUFFER_H
@@ -19,15 +19,22 @@ namespace self_writer {
 
 // Result of applying a change.  The report_id corresponds to the
 // filename of the saved report (without the .json suffix).  The
-// snapshot is the path to the snapshot of the original file (or an
-// empty string if the original file did not exist).  new_sha256 is
-// the pseudo SHA‑256 of the new content.
+// snapshot is a handle into the content-addressed snapshot store for
+// the original file contents (or an empty string if the original
+// file did not exist); pass it to read_snapshot() to recover the
+// contents.  new_sha256 is the pseudo SHA‑256 of the new content.
 struct ApplyResult {
     std::string report_id;
     std::string snapshot;
     std::string new_sha256;
 };
 
+// Recover the original file contents from a snapshot handle returned
+// in ApplyResult::snapshot.  Store entries are decompressed; plain
+// snapshot files from before the store existed are returned as-is.
+// Returns an empty string if the handle cannot be read or decoded.
+std::string read_snapshot(const std::string &handle);
+
 // Apply a change to a file.  The caller supplies the path of the file
 // to write, the new contents, the author of the change and the
 // developer intent.  The optional explanation parameter may contain
@@ -0,0 +1,264 @@
+// simd_kernels.h
+//
+// Small vectorized numeric kernels shared across FDQC modules.
+// Each kernel has an AVX2 path, a NEON path and a portable scalar
+// fallback selected at compile time, so the code builds unchanged on
+// any target; enabling -mavx2 (or building on aarch64) activates the
+// wide paths.
+
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace simd {
+
+// Dot product of two float32 vectors.
+inline float dot_f32(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float result = 0.0f;
+#if defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i);
+        __m256 vb = _mm256_loadu_ps(b + i);
+#if defined(__FMA__)
+        acc = _mm256_fmadd_ps(va, vb, acc);
+#else
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(va, vb));
+#endif
+    }
+    // Horizontal sum of the 8 lanes
+    __m128 lo = _mm256_castps256_ps128(acc);
+    __m128 hi = _mm256_extractf128_ps(acc, 1);
+    __m128 sum = _mm_add_ps(lo, hi);
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    result = _mm_cvtss_f32(sum);
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+#if defined(__aarch64__)
+    result = vaddvq_f32(acc);
+#else
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    result = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+#endif
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+// Squared L2 norm of a float32 vector.
+inline float norm_sq_f32(const float* a, size_t n) {
+    return dot_f32(a, a, n);
+}
+
+// Batch dot product: out[r] = dot(matrix row r, query) for all rows of
+// a row-major n_rows x dim matrix.  A contiguous bandwidth-bound scan,
+// as opposed to pointer-chasing through per-row allocations.
+inline void batch_dot_f32(const float* matrix, const float* query,
+                          size_t n_rows, size_t dim, float* out) {
+    for (size_t r = 0; r < n_rows; ++r) {
+        out[r] = dot_f32(matrix + r * dim, query, dim);
+    }
+}
+
+//===========================================================================
+// DOUBLE-PRECISION KERNELS
+//===========================================================================
+//
+// The collapse loop works in double precision, so exp/log2 have to be
+// vectorized too.  The AVX2 paths below use the classic Cephes-style
+// range reduction + rational/series approximations (accurate to a few
+// ulp, verified against std::exp/std::log2).  NEON has only two f64
+// lanes, so non-AVX2 targets take the scalar fallback.
+
+#if defined(__AVX2__)
+namespace detail {
+
+// exp(x) for four doubles.  Range-reduced via x = n·ln2 + r, with a
+// Cephes rational approximation of exp(r) on |r| <= ln2/2 and the
+// 2^n factor rebuilt by exponent-field insertion.
+inline __m256d exp_pd(__m256d x) {
+    const __m256d log2e = _mm256_set1_pd(1.4426950408889634074);
+    const __m256d c1 = _mm256_set1_pd(6.93145751953125e-1);
+    const __m256d c2 = _mm256_set1_pd(1.42860682030941723212e-6);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    // Clamp to the finite range of double exp
+    x = _mm256_min_pd(x, _mm256_set1_pd(709.0));
+    x = _mm256_max_pd(x, _mm256_set1_pd(-709.0));
+
+    // n = round(x / ln2)
+    __m256d fx = _mm256_round_pd(_mm256_mul_pd(x, log2e),
+                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    // r = x - n·ln2 (split constant for extra precision)
+    x = _mm256_sub_pd(x, _mm256_mul_pd(fx, c1));
+    x = _mm256_sub_pd(x, _mm256_mul_pd(fx, c2));
+
+    __m256d xx = _mm256_mul_pd(x, x);
+    __m256d px = _mm256_set1_pd(1.26177193074810590878e-4);
+    px = _mm256_add_pd(_mm256_mul_pd(px, xx), _mm256_set1_pd(3.02994407707441961300e-2));
+    px = _mm256_add_pd(_mm256_mul_pd(px, xx), _mm256_set1_pd(9.99999999999999999910e-1));
+    px = _mm256_mul_pd(px, x);
+    __m256d qx = _mm256_set1_pd(3.00198505138664455042e-6);
+    qx = _mm256_add_pd(_mm256_mul_pd(qx, xx), _mm256_set1_pd(2.52448340349684104192e-3));
+    qx = _mm256_add_pd(_mm256_mul_pd(qx, xx), _mm256_set1_pd(2.27265548208155028766e-1));
+    qx = _mm256_add_pd(_mm256_mul_pd(qx, xx), _mm256_set1_pd(2.00000000000000000005e0));
+    __m256d res = _mm256_div_pd(px, _mm256_sub_pd(qx, px));
+    res = _mm256_add_pd(one, _mm256_add_pd(res, res));
+
+    // Scale by 2^n: build the exponent field directly
+    __m128i n32 = _mm256_cvtpd_epi32(fx);
+    __m256i n64 = _mm256_cvtepi32_epi64(n32);
+    n64 = _mm256_add_epi64(n64, _mm256_set1_epi64x(1023));
+    n64 = _mm256_slli_epi64(n64, 52);
+    return _mm256_mul_pd(res, _mm256_castsi256_pd(n64));
+}
+
+// log2(x) for four positive doubles.  Splits x = m·2^e with
+// m in [sqrt(1/2), sqrt(2)), then evaluates the atanh series of
+// log(m) in z = (m-1)/(m+1).
+inline __m256d log2_pd(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d log2e = _mm256_set1_pd(1.4426950408889634074);
+
+    __m256i bits = _mm256_castpd_si256(x);
+    // Biased exponent as a double, via the 2^52 integer trick
+    __m256i exp_bits = _mm256_srli_epi64(bits, 52);
+    exp_bits = _mm256_and_si256(exp_bits, _mm256_set1_epi64x(0x7FF));
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(exp_bits, _mm256_set1_epi64x(0x4330000000000000))),
+        _mm256_set1_pd(4503599627370496.0));
+    e = _mm256_sub_pd(e, _mm256_set1_pd(1022.0));
+    // Mantissa remapped into [0.5, 1)
+    __m256i mant = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll));
+    __m256d m = _mm256_castsi256_pd(
+        _mm256_or_si256(mant, _mm256_set1_epi64x(0x3FE0000000000000ll)));
+    // If m < sqrt(1/2), double it and drop the exponent by one so the
+    // series argument stays small
+    __m256d small = _mm256_cmp_pd(m, _mm256_set1_pd(0.70710678118654752440), _CMP_LT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_add_pd(m, m), small);
+    e = _mm256_sub_pd(e, _mm256_and_pd(small, one));
+
+    __m256d z = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    __m256d w = _mm256_mul_pd(z, z);
+    // s = 1 + w/3 + w^2/5 + ... + w^10/21 (|w| < 0.03: converged)
+    __m256d s = _mm256_set1_pd(1.0 / 21.0);
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 19.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 17.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 15.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 13.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 11.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 9.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 7.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 5.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), _mm256_set1_pd(1.0 / 3.0));
+    s = _mm256_add_pd(_mm256_mul_pd(s, w), one);
+    // log2(x) = e + 2·z·s·log2(e)
+    __m256d log_m = _mm256_mul_pd(_mm256_add_pd(z, z), s);
+    return _mm256_add_pd(e, _mm256_mul_pd(log_m, log2e));
+}
+
+// Sum of the four lanes.
+inline double hsum_pd(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    __m128d sum = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+} // namespace detail
+#endif // __AVX2__
+
+// Maximum element of a double vector (n > 0).
+inline double max_f64(const double* a, size_t n) {
+    size_t i = 0;
+    double result = a[0];
+#if defined(__AVX2__)
+    if (n >= 4) {
+        __m256d acc = _mm256_loadu_pd(a);
+        for (i = 4; i + 4 <= n; i += 4) {
+            acc = _mm256_max_pd(acc, _mm256_loadu_pd(a + i));
+        }
+        __m128d lo = _mm256_castpd256_pd128(acc);
+        __m128d hi = _mm256_extractf128_pd(acc, 1);
+        __m128d m = _mm_max_pd(lo, hi);
+        result = _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+    }
+#endif
+    for (; i < n; ++i) {
+        if (a[i] > result) result = a[i];
+    }
+    return result;
+}
+
+// Shannon entropy -Σ p·log2(p) over entries with p > min_p.
+inline double entropy_f64(const double* p, size_t n, double min_p) {
+    size_t i = 0;
+    double entropy = 0.0;
+#if defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d vmin = _mm256_set1_pd(min_p);
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(p + i);
+        __m256d mask = _mm256_cmp_pd(v, vmin, _CMP_GT_OQ);
+        // Feed 1.0 (log2 = 0) into masked-out lanes so log2_pd only
+        // ever sees valid positive input
+        __m256d safe = _mm256_blendv_pd(one, v, mask);
+        __m256d term = _mm256_mul_pd(v, detail::log2_pd(safe));
+        acc = _mm256_sub_pd(acc, _mm256_and_pd(term, mask));
+    }
+    entropy = detail::hsum_pd(acc);
+#endif
+    for (; i < n; ++i) {
+        if (p[i] > min_p) {
+            entropy -= p[i] * std::log2(p[i]);
+        }
+    }
+    return entropy;
+}
+
+// Stable softmax numerators: out[i] = exp((x[i] - max_x) * inv_temp).
+// The max subtraction is fused into the exp pass; returns the sum of
+// out so the caller can normalize (or detect underflow).
+inline double softmax_exp_f64(const double* x, size_t n, double max_x,
+                              double inv_temp, double* out) {
+    size_t i = 0;
+    double sum = 0.0;
+#if defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    const __m256d vmax = _mm256_set1_pd(max_x);
+    const __m256d vit = _mm256_set1_pd(inv_temp);
+    for (; i + 4 <= n; i += 4) {
+        __m256d t = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i), vmax), vit);
+        __m256d e = detail::exp_pd(t);
+        _mm256_storeu_pd(out + i, e);
+        acc = _mm256_add_pd(acc, e);
+    }
+    sum = detail::hsum_pd(acc);
+#endif
+    for (; i < n; ++i) {
+        out[i] = std::exp((x[i] - max_x) * inv_temp);
+        sum += out[i];
+    }
+    return sum;
+}
+
+} // namespace simd
+
+#endif // SIMD_KERNELS_H
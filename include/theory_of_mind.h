@@ -15,6 +15,8 @@
 #define THEORY_OF_MIND_H
 
 #include "fdqc_params.h"
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -23,37 +25,78 @@
 
 namespace theory_of_mind {
 
-// Agent belief state representation
+// Bounded per-agent observation history.  32 entries cover the recent
+// behavioral window the models care about while keeping each profile
+// small enough to track thousands of agents.
+constexpr size_t OBSERVATION_HISTORY_CAPACITY = 32;
+
+// Agent belief state representation.  Belief states are always
+// BELIEF_STATE_DIM-dimensional, so they live inline in the profile
+// rather than on the heap; shorter inputs are zero-padded.
 struct BeliefState {
-    std::vector<double> state_estimate;  // Agent's believed world state
+    std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM> state_estimate{};
     double confidence;                   // Confidence in this belief
     size_t update_count;                 // How many times updated
-    
+
     BeliefState() : confidence(0.5), update_count(0) {}
-    
-    BeliefState(const std::vector<double>& state, double conf)
-        : state_estimate(state), confidence(conf), update_count(0) {}
+
+    BeliefState(const fdqc::Vec& state, double conf)
+        : confidence(conf), update_count(0) {
+        size_t n = std::min(state.size(), state_estimate.size());
+        for (size_t i = 0; i < n; ++i) {
+            state_estimate[i] = state[i];
+        }
+    }
+};
+
+// One observed (state, action) pair, truncated to the belief
+// dimensionality so the record is fixed-size
+struct Observation {
+    std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM> state{};
+    std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM> action{};
+    uint8_t state_len = 0;
+    uint8_t action_len = 0;
 };
 
-// Agent profile (what we know about an agent)
+// Agent profile (what we know about an agent).  The profile is a
+// fixed-size record: observations go into a ring that overwrites the
+// oldest entry, and per-dimension statistics are maintained
+// incrementally (Welford) instead of being recomputed from history.
 struct AgentProfile {
     std::string agent_id;
     BeliefState current_belief;
-    std::vector<std::pair<std::vector<double>, std::vector<double>>> observation_history;
     double trust_level;  // How reliable is this agent
-    
+
+    // Ring of recent observations; ring_head counts total observations,
+    // so valid entries are the last min(ring_head, capacity)
+    std::array<Observation, OBSERVATION_HISTORY_CAPACITY> observation_ring;
+    size_t ring_head = 0;
+
+    // Welford running statistics over observed states
+    size_t observation_count = 0;
+    std::array<double, fdqc_params::BELIEF_STATE_DIM> state_mean{};
+    std::array<double, fdqc_params::BELIEF_STATE_DIM> state_m2{};
+
     AgentProfile() : trust_level(0.5) {}
-    
+
     explicit AgentProfile(const std::string& id)
         : agent_id(id), trust_level(0.5) {}
+
+    // Sample variance of observed state along one dimension
+    double state_variance(size_t dim) const {
+        if (observation_count < 2 || dim >= state_m2.size()) {
+            return 0.0;
+        }
+        return state_m2[dim] / static_cast<double>(observation_count - 1);
+    }
 };
 
 // False-belief test scenarios (Sally-Anne style)
 struct FalseBeliefScenario {
     std::string protagonist;             // Who has the false belief
-    std::vector<double> true_state;     // Actual world state
-    std::vector<double> protagonist_belief;  // What protagonist believes
-    std::vector<double> query_state;    // State to predict action for
+    fdqc::Vec true_state;               // Actual world state
+    fdqc::Vec protagonist_belief;       // What protagonist believes
+    fdqc::Vec query_state;              // State to predict action for
     
     FalseBeliefScenario() {}
 };
@@ -79,68 +122,78 @@ public:
     
     // Observe agent behavior: (state, action) → update belief about agent
     void observe(const std::string& agent_id,
-                const std::vector<double>& observed_state,
-                const std::vector<double>& observed_action);
+                const fdqc::Vec& observed_state,
+                const fdqc::Vec& observed_action);
     
     // Backward compatibility (float vectors, self agent)
     void observe(const std::vector<float>& state, const std::vector<float>& action);
     
     // Predict action: given agent's belief state, what will they do?
-    std::vector<double> predict_action(const std::string& agent_id,
-                                       const std::vector<double>& world_state) const;
+    fdqc::Vec predict_action(const std::string& agent_id,
+                             const fdqc::Vec& world_state) const;
     
     // Backward compatibility
     std::vector<float> predict_action(const std::vector<float>& state) const;
     
     // Infer agent's belief state from observations (inverse model)
     BeliefState infer_belief(const std::string& agent_id,
-                            const std::vector<double>& world_state) const;
+                            const fdqc::Vec& world_state) const;
     
     // Update agent belief based on new information
     void update_agent_belief(const std::string& agent_id,
-                            const std::vector<double>& new_belief,
+                            const fdqc::Vec& new_belief,
                             double confidence = 0.7);
     
     // Sally-Anne false-belief test
     bool evaluate_false_belief() const;
     bool evaluate_false_belief(const FalseBeliefScenario& scenario) const;
     
-    // Get agent profile (create if doesn't exist)
+    // Get agent profile (create if doesn't exist).  Profiles live in
+    // a contiguous table; the returned reference is invalidated when
+    // a new agent is added.
     AgentProfile& get_agent(const std::string& agent_id);
     const AgentProfile& get_agent(const std::string& agent_id) const;
-    
+
     // Check if tracking agent
     bool has_agent(const std::string& agent_id) const;
-    
+
     // Get number of tracked agents
     size_t num_agents() const { return agents_.size(); }
-    
+
     // Get statistics
     const ToMStats& stats() const { return stats_; }
-    
+
     // Clear all agent models
     void clear();
 
 private:
-    std::unordered_map<std::string, AgentProfile> agents_;
+    // Contiguous agent table plus a name → slot lookup.  Keeping the
+    // profiles themselves in one allocation makes iterating thousands
+    // of agents cache-friendly.
+    std::vector<AgentProfile> agents_;
+    std::unordered_map<std::string, size_t> agent_index_;
     ToMStats stats_;
-    
-    // Helper: inverse model (action → belief state)
-    std::vector<double> inverse_model(const std::vector<double>& observed_state,
-                                     const std::vector<double>& observed_action) const;
-    
+
+    // Helper: inverse model (action → belief state); writes the
+    // inferred belief in place so updates stay allocation-free
+    void inverse_model(const fdqc::Vec& observed_state,
+                       const fdqc::Vec& observed_action,
+                       std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM>& out) const;
+
     // Helper: forward model (belief state → action)
-    std::vector<double> forward_model(const std::vector<double>& belief_state) const;
+    fdqc::Vec forward_model(
+        const std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM>& belief_state) const;
     
     // Helper: compute similarity between states
-    static double state_similarity(const std::vector<double>& a,
-                                  const std::vector<double>& b);
-    
-    // Helper: convert float to double
-    static std::vector<double> float_to_double(const std::vector<float>& vec);
+    static double state_similarity(const fdqc::Vec& a,
+                                  const fdqc::Vec& b);
     
-    // Helper: convert double to float
-    static std::vector<float> double_to_float(const std::vector<double>& vec);
+    // Helper: convert float input to the embedding scalar type (a
+    // straight copy when fdqc::Scalar is float)
+    static fdqc::Vec to_scalar(const std::vector<float>& vec);
+
+    // Helper: convert back for the float compatibility API
+    static std::vector<float> to_float(const fdqc::Vec& vec);
     
     // Helper: create default Sally-Anne scenario
     FalseBeliefScenario create_sally_anne_scenario() const;
@@ -153,30 +206,30 @@ private:
 inline TheoryOfMind::TheoryOfMind() {
     // Reserve space for typical multi-agent scenarios
     agents_.reserve(fdqc_params::MAX_TRACKED_AGENTS);
+    agent_index_.reserve(fdqc_params::MAX_TRACKED_AGENTS);
 }
 
 inline void TheoryOfMind::clear() {
     agents_.clear();
+    agent_index_.clear();
     stats_ = ToMStats();
 }
 
 inline bool TheoryOfMind::has_agent(const std::string& agent_id) const {
-    return agents_.find(agent_id) != agents_.end();
+    return agent_index_.find(agent_id) != agent_index_.end();
 }
 
-inline std::vector<double> TheoryOfMind::float_to_double(
-    const std::vector<float>& vec) {
-    return std::vector<double>(vec.begin(), vec.end());
+inline fdqc::Vec TheoryOfMind::to_scalar(const std::vector<float>& vec) {
+    return fdqc::Vec(vec.begin(), vec.end());
 }
 
-inline std::vector<float> TheoryOfMind::double_to_float(
-    const std::vector<double>& vec) {
+inline std::vector<float> TheoryOfMind::to_float(const fdqc::Vec& vec) {
     return std::vector<float>(vec.begin(), vec.end());
 }
 
 inline double TheoryOfMind::state_similarity(
-    const std::vector<double>& a,
-    const std::vector<double>& b) {
+    const fdqc::Vec& a,
+    const fdqc::Vec& b) {
     
     if (a.size() != b.size() || a.empty()) {
         return 0.0;
@@ -15,6 +15,9 @@
 #define VCCA_CONTROLLER_H
 
 #include "fdqc_params.h"
+#include <array>
+#include <cstddef>
+#include <string>
 #include <vector>
 #include <cmath>
 #include <algorithm>
@@ -36,19 +39,24 @@ struct Context {
 
 // Q-value table for policy learning
 struct QTable {
-    // Q[level_index][context_bin] = expected cumulative reward
-    std::vector<std::vector<double>> values;
-    std::vector<size_t> visit_counts;  // Visits per level
-    
+    // Number of discretized context bins (see context_to_bin())
+    static constexpr size_t N_CONTEXT_BINS = 10;
+
+    // Q[level_index * N_CONTEXT_BINS + context_bin] = expected
+    // cumulative reward.  One flat row-major block (50 doubles), so a
+    // lookup is a multiply-add into a single cache line instead of a
+    // pointer chase through per-level vectors.
+    std::array<double, fdqc_params::N_VCCA_LEVELS * N_CONTEXT_BINS> values;
+    std::array<size_t, fdqc_params::N_VCCA_LEVELS> visit_counts;  // Visits per level
+
     QTable() {
-        // Initialize Q-table for all VCCA levels
-        values.resize(fdqc_params::N_VCCA_LEVELS);
-        visit_counts.resize(fdqc_params::N_VCCA_LEVELS, 0);
-        
-        // Initialize with small random values
+        // Initialize with small level-dependent values
         for (size_t i = 0; i < fdqc_params::N_VCCA_LEVELS; ++i) {
-            values[i].resize(10, 0.1 * (i + 1));  // 10 context bins
+            for (size_t b = 0; b < N_CONTEXT_BINS; ++b) {
+                values[i * N_CONTEXT_BINS + b] = 0.1 * (i + 1);
+            }
         }
+        visit_counts.fill(0);
     }
 };
 
@@ -56,7 +64,21 @@ class VCCAController {
 public:
     // Construct controller with initial dimensionality
     explicit VCCAController(int n = fdqc_params::N_WM_BASE);
-    
+    ~VCCAController();
+
+    VCCAController(const VCCAController&) = delete;
+    VCCAController& operator=(const VCCAController&) = delete;
+    VCCAController(VCCAController&& other) noexcept;
+    VCCAController& operator=(VCCAController&& other) noexcept;
+
+    // Attach a memory-mapped store for the learned policy.  An
+    // existing file restores the Q-values, visit counts and episode
+    // count, so a restarted process resumes the learned policy
+    // immediately instead of re-exploring from the initial table.
+    // Returns false for an incompatible file (persistence is then
+    // disabled).
+    bool set_persistence(const std::string& path);
+
     // Get current working memory dimensionality
     int dimension() const { return current_n_; }
     
@@ -84,8 +106,8 @@ public:
     
     // Get statistics
     size_t total_episodes() const { return episode_count_; }
-    const std::vector<size_t>& visit_counts() const { 
-        return q_table_.visit_counts; 
+    const std::array<size_t, fdqc_params::N_VCCA_LEVELS>& visit_counts() const {
+        return q_table_.visit_counts;
     }
     
     // Get dimensionality distribution over time
@@ -96,7 +118,20 @@ private:
     size_t episode_count_;             // Total episodes processed
     QTable q_table_;                   // Q-learning table
     std::vector<int> dimension_history_;  // History for statistics
-    
+
+    // Memory-mapped persistence (inactive unless set_persistence()
+    // was called)
+    std::string persist_path_;
+    int persist_fd_ = -1;
+    void* persist_base_ = nullptr;
+    size_t persist_size_ = 0;
+
+    // Helper: copy the in-memory policy through to the mapping
+    void sync_store();
+
+    // Helper: unmap and close the store
+    void close_store();
+
     // Helper: discretize context into bin index
     size_t context_to_bin(const Context& context) const;
     
@@ -157,26 +192,27 @@ inline double VCCAController::compute_reward(double accuracy, int n) const {
     return accuracy - fdqc_params::ENERGY_PENALTY_LAMBDA * E_rel;
 }
 
-inline double VCCAController::get_q_value(size_t level_index, 
+inline double VCCAController::get_q_value(size_t level_index,
                                           size_t context_bin) const {
-    if (level_index >= q_table_.values.size() || 
-        context_bin >= q_table_.values[level_index].size()) {
+    if (level_index >= fdqc_params::N_VCCA_LEVELS ||
+        context_bin >= QTable::N_CONTEXT_BINS) {
         return 0.0;
     }
-    return q_table_.values[level_index][context_bin];
+    return q_table_.values[level_index * QTable::N_CONTEXT_BINS + context_bin];
 }
 
-inline void VCCAController::update_q_value(size_t level_index, 
+inline void VCCAController::update_q_value(size_t level_index,
                                            size_t context_bin,
-                                           double reward, 
+                                           double reward,
                                            double learning_rate) {
-    if (level_index >= q_table_.values.size() || 
-        context_bin >= q_table_.values[level_index].size()) {
+    if (level_index >= fdqc_params::N_VCCA_LEVELS ||
+        context_bin >= QTable::N_CONTEXT_BINS) {
         return;
     }
-    
-    double& q_val = q_table_.values[level_index][context_bin];
-    
+
+    double& q_val =
+        q_table_.values[level_index * QTable::N_CONTEXT_BINS + context_bin];
+
     // Q-learning update: Q(s,a) ← Q(s,a) + α[r - Q(s,a)]
     // Simplified (no next-state term for episodic setting)
     q_val += learning_rate * (reward - q_val);
@@ -17,7 +17,20 @@
 #include <sstream>
 #include <string>
 #include <unordered_set>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
 #include <cstdlib> // for getenv
 
 #include <openssl/evp.h>
@@ -47,6 +60,146 @@ namespace change_audit {
 // JSON reports to disk.
 static sqlite3 *g_db = nullptr;
 static bool g_db_initialised = false;
+// Guards lazy initialisation and inserts now that apply_change calls
+// save_report from multiple threads concurrently.
+static std::mutex g_db_mutex;
+
+// Forward declarations needed by the audit writer's hash chaining.
+static std::string compute_sha256(const std::string &input);
+static std::string load_chain_tail(const std::string &out_dir);
+static std::string load_chain_tail_locked(const std::string &out_dir);
+
+// True when this process is one of several cockpit cluster workers
+// (COCKPIT_CLUSTER_SIZE is exported by the supervisor in main.cpp).
+// In cluster mode the prev_hash chain cannot be maintained per
+// process — two workers seeding from the same tail would fork it —
+// so chaining moves from enqueue time into the write transaction,
+// where the database's own write lock linearises it across
+// processes.
+static bool cluster_chain_mode() {
+    static const bool on = [] {
+        const char *env = std::getenv("COCKPIT_CLUSTER_SIZE");
+        return env && std::atoi(env) > 1;
+    }();
+    return on;
+}
+
+//===========================================================================
+// ASYNCHRONOUS AUDIT WRITER
+//===========================================================================
+//
+// The SQLite insert used to run synchronously inside save_report(),
+// adding fsync-bound latency to every apply_change call.  Reports now
+// enqueue into a bounded in-memory queue and a dedicated thread commits
+// them in batched transactions.  The tamper-evident prev_hash chain is
+// computed at enqueue time under the queue lock, so chain order equals
+// queue order regardless of batching (in cluster mode it moves into
+// the write transaction; see cluster_chain_mode above).  Setting
+// CHANGE_AUDIT_SYNC=on
+// restores synchronous behaviour: submit() then blocks until the row's
+// batch has committed (for regulated deployments).  Batch size and
+// flush interval are tunable via CHANGE_AUDIT_BATCH and
+// CHANGE_AUDIT_INTERVAL_MS.
+
+class AuditWriter {
+public:
+    static AuditWriter &instance() {
+        static AuditWriter writer;
+        return writer;
+    }
+
+    // Queue a report for insertion.  Blocks while the queue is full
+    // (back-pressure), and, in sync mode, until the row is durable.
+    void submit(const std::string &rid, Report report,
+                const std::string &out_dir, bool sync) {
+        uint64_t seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_cv_.wait(lock, [this] {
+                return queue_.size() < max_queue_ || stop_;
+            });
+            if (stop_) return;
+            // Single-process mode: chain at enqueue time, seeded from
+            // the last row already in the database so the prev_hash
+            // chain spans process restarts instead of restarting from
+            // an empty hash (which an incremental verifier could not
+            // tell apart from tampering).  In cluster mode chaining
+            // happens inside the write transaction instead (see run()).
+            if (!cluster_chain_mode()) {
+                if (!chain_seeded_) {
+                    chain_seeded_ = true;
+                    chain_tail_ = load_chain_tail(out_dir);
+                }
+                report.prev_hash = chain_tail_;
+                chain_tail_ = compute_sha256(rid + report.new_sha256 + report.prev_hash);
+            }
+            seq = ++enqueued_seq_;
+            queue_.push_back(Item{rid, std::move(report), out_dir, seq});
+            if (!thread_.joinable()) {
+                thread_ = std::thread(&AuditWriter::run, this);
+            }
+        }
+        queue_cv_.notify_one();
+        if (sync) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushed_cv_.wait(lock, [this, seq] {
+                return flushed_seq_ >= seq || stop_;
+            });
+        }
+    }
+
+    ~AuditWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        space_cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    struct Item {
+        std::string rid;
+        Report report;
+        std::string out_dir;
+        uint64_t seq;
+    };
+
+    AuditWriter() {
+        if (const char *env = std::getenv("CHANGE_AUDIT_BATCH")) {
+            long v = std::atol(env);
+            if (v > 0) batch_size_ = static_cast<size_t>(v);
+        }
+        if (const char *env = std::getenv("CHANGE_AUDIT_INTERVAL_MS")) {
+            long v = std::atol(env);
+            if (v > 0) interval_ms_ = static_cast<long>(v);
+        }
+        if (const char *env = std::getenv("CHANGE_AUDIT_QUEUE_MAX")) {
+            long v = std::atol(env);
+            if (v > 0) max_queue_ = static_cast<size_t>(v);
+        }
+    }
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;   // writer waits for work
+    std::condition_variable space_cv_;   // producers wait for space
+    std::condition_variable flushed_cv_; // sync producers wait for durability
+    std::deque<Item> queue_;
+    std::thread thread_;
+    bool stop_ = false;
+    std::string chain_tail_;             // hash of the last enqueued report
+    bool chain_seeded_ = false;
+    uint64_t enqueued_seq_ = 0;
+    uint64_t flushed_seq_ = 0;
+    size_t batch_size_ = 64;
+    long interval_ms_ = 100;
+    size_t max_queue_ = 1024;
+};
 
 // Initialise the SQLite database given an output directory.  This
 // function opens (or creates) a database file at out_dir/reports.db
@@ -70,6 +223,9 @@ static bool init_db(const std::string &out_dir) {
     }
     // Enable WAL journal mode for concurrent readers/writers
     sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+    // In cluster mode several worker processes share this database;
+    // wait for the write lock instead of failing on SQLITE_BUSY.
+    sqlite3_busy_timeout(db, 5000);
     // Create table if not exists
     const char *create_sql =
         "CREATE TABLE IF NOT EXISTS reports ("
@@ -146,11 +302,815 @@ static void insert_report_db(const std::string &rid, const Report &report) {
     sqlite3_finalize(stmt);
 }
 
+// Writer thread main loop: drain the queue in batches, wrapping each
+// batch in a single transaction so one fsync covers many reports.
+void AuditWriter::run() {
+    for (;;) {
+        std::vector<Item> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty() && stop_) break;
+            // Give the queue a short window to accumulate a fuller batch.
+            if (queue_.size() < batch_size_ && !stop_) {
+                queue_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                                   [this] { return stop_ || queue_.size() >= batch_size_; });
+            }
+            size_t n = std::min(batch_size_, queue_.size());
+            batch.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        space_cv_.notify_all();
+        if (batch.empty()) continue;
+
+        uint64_t last_seq = batch.back().seq;
+        try {
+            std::lock_guard<std::mutex> db_lg(g_db_mutex);
+            if (init_db(batch.front().out_dir)) {
+                if (cluster_chain_mode()) {
+                    // Take the database write lock first, then chain
+                    // this batch onto whatever row is current —
+                    // concurrent workers serialise here, so the chain
+                    // stays linear across the whole cluster.
+                    sqlite3_exec(g_db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+                    std::string tail = load_chain_tail_locked(batch.front().out_dir);
+                    for (auto &item : batch) {
+                        item.report.prev_hash = tail;
+                        tail = compute_sha256(item.rid + item.report.new_sha256 +
+                                              item.report.prev_hash);
+                        insert_report_db(item.rid, item.report);
+                    }
+                } else {
+                    sqlite3_exec(g_db, "BEGIN;", nullptr, nullptr, nullptr);
+                    for (const auto &item : batch) {
+                        insert_report_db(item.rid, item.report);
+                    }
+                }
+                sqlite3_exec(g_db, "COMMIT;", nullptr, nullptr, nullptr);
+            }
+        } catch (...) {
+            // best effort: durability failures do not block the pipeline
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushed_seq_ = last_seq;
+        }
+        flushed_cv_.notify_all();
+    }
+    // Drain marker for any sync waiters blocked at shutdown.
+    flushed_cv_.notify_all();
+}
+
+//===========================================================================
+// INCREMENTAL CHAIN VERIFICATION
+//===========================================================================
+//
+// Each DB row's prev_hash must equal sha256(rid + new_sha256 +
+// prev_hash) of the row before it.  Verifying that used to mean
+// re-hashing every report from the beginning on every compliance run.
+// verify_chain() instead keeps a durable checkpoint (last verified
+// rowid plus the chain hash at that point) in a chain_checkpoint
+// table and resumes from it, so a run costs O(new rows).  The
+// per-row hashes depend only on that row's own columns — only the
+// equality walk is sequential — so they are computed in parallel
+// across hardware threads before the (cheap) linear comparison.
+
+// Hash of a single row, as used for chaining by AuditWriter::submit.
+static std::string chain_row_hash(const std::string &rid,
+                                  const std::string &new_sha256,
+                                  const std::string &prev_hash) {
+    return compute_sha256(rid + new_sha256 + prev_hash);
+}
+
+// Recompute the chain tail from the last row of an existing database
+// so a restarted writer extends the chain instead of restarting it.
+// Returns the empty string when there is no database or no rows.
+static std::string load_chain_tail(const std::string &out_dir) {
+    std::lock_guard<std::mutex> lg(g_db_mutex);
+    return load_chain_tail_locked(out_dir);
+}
+
+// As load_chain_tail, but assumes the caller already holds
+// g_db_mutex (the audit writer calls this inside its own
+// transaction).
+static std::string load_chain_tail_locked(const std::string &out_dir) {
+    if (!init_db(out_dir) || !g_db) return std::string();
+    const char *sql = "SELECT id, new_sha256, prev_hash FROM reports"
+                      " ORDER BY rowid DESC LIMIT 1;";
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(g_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::string();
+    }
+    std::string tail;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto col = [&](int i) {
+            const unsigned char *t = sqlite3_column_text(stmt, i);
+            return t ? std::string(reinterpret_cast<const char *>(t)) : std::string();
+        };
+        try {
+            tail = chain_row_hash(col(0), col(1), col(2));
+        } catch (...) {
+            tail.clear();
+        }
+    }
+    sqlite3_finalize(stmt);
+    return tail;
+}
+
+ChainVerifyResult verify_chain(const std::string &out_dir) {
+    ChainVerifyResult res;
+    std::filesystem::path db_path = std::filesystem::path(out_dir) / "reports.db";
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(db_path.string().c_str(), &db,
+                        SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        // No database yet: an empty chain is trivially intact.
+        if (db) sqlite3_close(db);
+        return res;
+    }
+    sqlite3_exec(db,
+                 "CREATE TABLE IF NOT EXISTS chain_checkpoint ("
+                 "id INTEGER PRIMARY KEY CHECK (id = 1),"
+                 "last_rowid INTEGER,"
+                 "tail_hash TEXT,"
+                 "verified_count INTEGER);",
+                 nullptr, nullptr, nullptr);
+
+    long long last_rowid = 0;
+    std::string tail;
+    uint64_t prior_count = 0;
+    {
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db,
+                "SELECT last_rowid, tail_hash, verified_count"
+                " FROM chain_checkpoint WHERE id = 1;",
+                -1, &stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                last_rowid = sqlite3_column_int64(stmt, 0);
+                const unsigned char *t = sqlite3_column_text(stmt, 1);
+                if (t) tail = reinterpret_cast<const char *>(t);
+                prior_count = static_cast<uint64_t>(sqlite3_column_int64(stmt, 2));
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    res.total = prior_count;
+
+    // Pull only the rows past the checkpoint.
+    struct Row {
+        long long rowid;
+        std::string rid;
+        std::string new_sha256;
+        std::string prev_hash;
+        std::string hash;  // chain_row_hash, filled in below
+    };
+    std::vector<Row> rows;
+    {
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db,
+                "SELECT rowid, id, new_sha256, prev_hash FROM reports"
+                " WHERE rowid > ?1 ORDER BY rowid;",
+                -1, &stmt, nullptr) != SQLITE_OK) {
+            sqlite3_close(db);
+            res.ok = false;
+            return res;
+        }
+        sqlite3_bind_int64(stmt, 1, last_rowid);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto col = [&](int i) {
+                const unsigned char *t = sqlite3_column_text(stmt, i);
+                return t ? std::string(reinterpret_cast<const char *>(t)) : std::string();
+            };
+            rows.push_back(Row{sqlite3_column_int64(stmt, 0),
+                               col(1), col(2), col(3), std::string()});
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Per-row hashes are independent: fan out across hardware threads
+    // once the batch is big enough to be worth the spawn cost.
+    auto hash_range = [&rows](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            rows[i].hash = chain_row_hash(rows[i].rid, rows[i].new_sha256,
+                                          rows[i].prev_hash);
+        }
+    };
+    try {
+        size_t workers = std::thread::hardware_concurrency();
+        if (workers < 2 || rows.size() < 1024) {
+            hash_range(0, rows.size());
+        } else {
+            workers = std::min(workers, rows.size() / 512);
+            std::vector<std::thread> threads;
+            size_t chunk = (rows.size() + workers - 1) / workers;
+            for (size_t w = 0; w < workers; ++w) {
+                size_t begin = w * chunk;
+                size_t end = std::min(begin + chunk, rows.size());
+                if (begin < end) threads.emplace_back(hash_range, begin, end);
+            }
+            for (auto &t : threads) t.join();
+        }
+    } catch (...) {
+        sqlite3_close(db);
+        res.ok = false;
+        return res;
+    }
+
+    // Sequential equality walk over the precomputed hashes.
+    for (const auto &row : rows) {
+        if (row.prev_hash != tail) {
+            res.ok = false;
+            res.first_bad = row.rid;
+            break;
+        }
+        tail = row.hash;
+        last_rowid = row.rowid;
+        ++res.verified;
+    }
+    res.total = prior_count + res.verified;
+
+    // Advance the checkpoint over the rows that did verify, so a
+    // tampered row is re-reported (not skipped) on the next run.
+    if (res.verified > 0) {
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db,
+                "INSERT OR REPLACE INTO chain_checkpoint"
+                " (id, last_rowid, tail_hash, verified_count)"
+                " VALUES (1, ?1, ?2, ?3);",
+                -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, last_rowid);
+            sqlite3_bind_text(stmt, 2, tail.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(res.total));
+            sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_close(db);
+    return res;
+}
+
+//===========================================================================
+// BINARY REPORT LOG
+//===========================================================================
+//
+// The JSON-file report path creates one pretty-printed file per
+// change; at millions of reports the per-file creation overhead and
+// directory enumeration dominate both write latency and audit-scan
+// tooling.  Setting CHANGE_LOG_FORMAT=binary switches save_report()
+// to an append-only, length-prefixed segment log instead:
+//
+//   <out_dir>/log/segment_<NNNNNN>.calog
+//       record := u32 rec_len | u16 rid_len | rid | compact JSON
+//       (rec_len counts the bytes after the length field)
+//   <out_dir>/log/segment_<NNNNNN>.idx
+//       one "<rid>\t<offset>\n" line per record (point lookups)
+//
+// Segments rotate at CHANGE_LOG_SEGMENT_BYTES (default 64 MB).
+// Records are appended complete — in deferred-signing mode the
+// signing worker appends after the signature fields are filled in —
+// so the log never needs in-place rewrites.  Scans mmap whole
+// segments and walk the length prefixes; see scan_report_log().
+// The per-file JSON format remains the default for compatibility
+// with existing tooling.
+
+// True when CHANGE_LOG_FORMAT selects the binary segment log.
+static bool binary_log_enabled() {
+    const char *fmt = std::getenv("CHANGE_LOG_FORMAT");
+    if (!fmt) return false;
+    std::string v = fmt;
+    std::transform(v.begin(), v.end(), v.begin(),
+                   [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    return v == "binary";
+}
+
+class BinaryReportLog {
+public:
+    static BinaryReportLog &instance() {
+        static BinaryReportLog log;
+        return log;
+    }
+
+    // Append one finished record.  Thread-safe; returns false (and
+    // leaves the log untouched) on any I/O failure.
+    bool append(const std::string &out_dir, const std::string &rid,
+                const std::string &json_payload) {
+        if (rid.size() > 0xffff) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ensure_segment(out_dir, 6 + rid.size() + json_payload.size())) {
+            return false;
+        }
+        uint64_t offset = seg_bytes_;
+        uint32_t rec_len = static_cast<uint32_t>(2 + rid.size() + json_payload.size());
+        uint16_t rid_len = static_cast<uint16_t>(rid.size());
+        std::string rec;
+        rec.reserve(4 + rec_len);
+        rec.push_back(static_cast<char>(rec_len & 0xff));
+        rec.push_back(static_cast<char>((rec_len >> 8) & 0xff));
+        rec.push_back(static_cast<char>((rec_len >> 16) & 0xff));
+        rec.push_back(static_cast<char>((rec_len >> 24) & 0xff));
+        rec.push_back(static_cast<char>(rid_len & 0xff));
+        rec.push_back(static_cast<char>((rid_len >> 8) & 0xff));
+        rec.append(rid);
+        rec.append(json_payload);
+        if (::write(seg_fd_, rec.data(), rec.size()) !=
+            static_cast<ssize_t>(rec.size())) {
+            return false;
+        }
+        seg_bytes_ += rec.size();
+        std::string idx_line = rid + "\t" + std::to_string(offset) + "\n";
+        // Index write failures are tolerated: the index only
+        // accelerates point lookups, scans never need it.
+        (void)!::write(idx_fd_, idx_line.data(), idx_line.size());
+        return true;
+    }
+
+private:
+    BinaryReportLog() {
+        if (const char *env = std::getenv("CHANGE_LOG_SEGMENT_BYTES")) {
+            long long v = std::atoll(env);
+            if (v > 0) max_seg_bytes_ = static_cast<uint64_t>(v);
+        }
+    }
+
+    ~BinaryReportLog() {
+        if (seg_fd_ >= 0) ::close(seg_fd_);
+        if (idx_fd_ >= 0) ::close(idx_fd_);
+    }
+
+    // Open (or rotate to) the segment the next record of `need` bytes
+    // should go to.  Caller holds mutex_.
+    bool ensure_segment(const std::string &out_dir, size_t need) {
+        if (out_dir != dir_ || seg_fd_ < 0) {
+            close_fds();
+            dir_ = out_dir;
+            seg_no_ = latest_segment_number(out_dir);
+            if (!open_segment()) return false;
+        }
+        if (seg_bytes_ > 0 && seg_bytes_ + need > max_seg_bytes_) {
+            close_fds();
+            ++seg_no_;
+            if (!open_segment()) return false;
+        }
+        return true;
+    }
+
+    static unsigned latest_segment_number(const std::string &out_dir) {
+        unsigned latest = 0;
+        std::error_code ec;
+        std::filesystem::directory_iterator it(
+            std::filesystem::path(out_dir) / "log", ec);
+        if (ec) return 0;
+        for (const auto &entry : it) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("segment_", 0) == 0 &&
+                name.size() > 14 &&
+                name.compare(name.size() - 6, 6, ".calog") == 0) {
+                unsigned n = static_cast<unsigned>(
+                    std::atoi(name.substr(8, name.size() - 14).c_str()));
+                if (n > latest) latest = n;
+            }
+        }
+        return latest;
+    }
+
+    bool open_segment() {
+        std::filesystem::path log_dir = std::filesystem::path(dir_) / "log";
+        std::error_code ec;
+        std::filesystem::create_directories(log_dir, ec);
+        char name[32];
+        std::snprintf(name, sizeof(name), "segment_%06u", seg_no_);
+        std::string base = (log_dir / name).string();
+        seg_fd_ = ::open((base + ".calog").c_str(),
+                         O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0640);
+        idx_fd_ = ::open((base + ".idx").c_str(),
+                         O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0640);
+        if (seg_fd_ < 0 || idx_fd_ < 0) {
+            close_fds();
+            return false;
+        }
+        struct stat st;
+        seg_bytes_ = (::fstat(seg_fd_, &st) == 0)
+                         ? static_cast<uint64_t>(st.st_size) : 0;
+        return true;
+    }
+
+    void close_fds() {
+        if (seg_fd_ >= 0) { ::close(seg_fd_); seg_fd_ = -1; }
+        if (idx_fd_ >= 0) { ::close(idx_fd_); idx_fd_ = -1; }
+    }
+
+    std::mutex mutex_;
+    std::string dir_;
+    unsigned seg_no_ = 0;
+    int seg_fd_ = -1;
+    int idx_fd_ = -1;
+    uint64_t seg_bytes_ = 0;
+    uint64_t max_seg_bytes_ = 64ull << 20;
+};
+
+// Sorted list of segment base paths (without extension) for a log dir.
+static std::vector<std::string> log_segment_bases(const std::string &out_dir) {
+    std::vector<std::string> bases;
+    std::error_code ec;
+    std::filesystem::directory_iterator it(
+        std::filesystem::path(out_dir) / "log", ec);
+    if (ec) return bases;
+    for (const auto &entry : it) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("segment_", 0) == 0 &&
+            name.size() > 14 &&
+            name.compare(name.size() - 6, 6, ".calog") == 0) {
+            bases.push_back(entry.path().string().substr(
+                0, entry.path().string().size() - 6));
+        }
+    }
+    std::sort(bases.begin(), bases.end());
+    return bases;
+}
+
+size_t scan_report_log(
+    const std::string &out_dir,
+    const std::function<bool(const std::string &, const nlohmann::json &)> &fn) {
+    size_t visited = 0;
+    for (const auto &base : log_segment_bases(out_dir)) {
+        int fd = ::open((base + ".calog").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            continue;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) continue;
+        const unsigned char *data = static_cast<const unsigned char *>(map);
+        size_t off = 0;
+        bool keep_going = true;
+        while (keep_going && off + 4 <= size) {
+            uint32_t rec_len = static_cast<uint32_t>(data[off]) |
+                               (static_cast<uint32_t>(data[off + 1]) << 8) |
+                               (static_cast<uint32_t>(data[off + 2]) << 16) |
+                               (static_cast<uint32_t>(data[off + 3]) << 24);
+            if (rec_len < 2 || off + 4 + rec_len > size) {
+                break;  // truncated tail (e.g. crash mid-append)
+            }
+            uint16_t rid_len = static_cast<uint16_t>(data[off + 4]) |
+                               (static_cast<uint16_t>(data[off + 5]) << 8);
+            if (static_cast<uint32_t>(rid_len) + 2 > rec_len) {
+                break;
+            }
+            const char *rid_ptr = reinterpret_cast<const char *>(data + off + 6);
+            const char *json_ptr = rid_ptr + rid_len;
+            size_t json_len = rec_len - 2 - rid_len;
+            json j = json::parse(json_ptr, json_ptr + json_len, nullptr, false);
+            if (!j.is_discarded()) {
+                ++visited;
+                keep_going = fn(std::string(rid_ptr, rid_len), j);
+            }
+            off += 4 + rec_len;
+        }
+        ::munmap(map, size);
+        if (!keep_going) break;
+    }
+    return visited;
+}
+
+bool load_logged_report(const std::string &out_dir, const std::string &report_id,
+                        nlohmann::json &out) {
+    auto bases = log_segment_bases(out_dir);
+    // Newest segments first: lookups are usually for recent reports.
+    for (auto it = bases.rbegin(); it != bases.rend(); ++it) {
+        std::ifstream idx(*it + ".idx");
+        if (!idx) continue;
+        std::string line;
+        long long offset = -1;
+        while (std::getline(idx, line)) {
+            size_t tab = line.find('\t');
+            if (tab != std::string::npos &&
+                line.compare(0, tab, report_id) == 0) {
+                offset = std::atoll(line.c_str() + tab + 1);
+                // keep scanning: a later write of the same rid wins
+            }
+        }
+        if (offset < 0) continue;
+        int fd = ::open((*it + ".calog").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        unsigned char hdr[6];
+        bool ok = ::pread(fd, hdr, sizeof(hdr), offset) == sizeof(hdr);
+        uint32_t rec_len = 0;
+        uint16_t rid_len = 0;
+        if (ok) {
+            rec_len = static_cast<uint32_t>(hdr[0]) |
+                      (static_cast<uint32_t>(hdr[1]) << 8) |
+                      (static_cast<uint32_t>(hdr[2]) << 16) |
+                      (static_cast<uint32_t>(hdr[3]) << 24);
+            rid_len = static_cast<uint16_t>(hdr[4]) |
+                      (static_cast<uint16_t>(hdr[5]) << 8);
+            ok = rec_len >= 2u + rid_len;
+        }
+        if (ok) {
+            std::string body(rec_len - 2, '\0');
+            ok = ::pread(fd, &body[0], body.size(), offset + 6) ==
+                 static_cast<ssize_t>(body.size());
+            if (ok) {
+                out = json::parse(body.begin() + rid_len, body.end(),
+                                  nullptr, false);
+                ok = !out.is_discarded();
+            }
+        }
+        ::close(fd);
+        if (ok) return true;
+    }
+    return false;
+}
+
+//===========================================================================
+// BACKGROUND REPORT SIGNING
+//===========================================================================
+//
+// Ed25519 signing used to run inline in save_report(), adding a fixed
+// chunk of crypto latency to every apply_change call and re-deriving
+// the key (hex decode, EVP_PKEY construction, context init) per
+// report.  Reports are now persisted unsigned by default and a
+// dedicated worker signs them in batches with a single reused signing
+// context, backfilling signature/pubkey_id/sig_alg into the on-disk
+// JSON and forwarding the completed report to the audit writer for DB
+// persistence.  Setting CHANGE_SIGN_SYNC=on restores inline signing
+// for deployments that must not acknowledge a change before its
+// report is signed.
+
+// Forward declarations needed by the signer (defined with the other
+// crypto helpers below).
+static bool hex_decode(const std::string &hex, std::vector<unsigned char> &out);
+static std::string hex_encode(const unsigned char *data, size_t len);
+
+// Reusable Ed25519 signing state.  The private key is decoded and the
+// EVP structures allocated once, so a batch of messages can be signed
+// without per-report key derivation.  Sensitive material is zeroised
+// as soon as the key object has been constructed.
+//
+// Note: Ed25519 must be signed through the one-shot EVP_DigestSign
+// API; the EVP_PKEY_sign path used previously returns "operation not
+// supported" for this key type on OpenSSL 3, so reports were silently
+// left unsigned.  EVP_DigestSignInit is cheap to re-run per message
+// on the retained context once the key object exists.
+class Ed25519Signer {
+public:
+    Ed25519Signer() = default;
+    ~Ed25519Signer() { reset(); }
+    Ed25519Signer(const Ed25519Signer &) = delete;
+    Ed25519Signer &operator=(const Ed25519Signer &) = delete;
+
+    // Construct the key and signing context from a 32-byte hex key.
+    // Returns false (leaving the signer unusable) on any failure.
+    bool init(const std::string &privkey_hex) {
+        reset();
+        std::vector<unsigned char> priv_bytes;
+        if (!hex_decode(privkey_hex, priv_bytes) || priv_bytes.size() != 32) {
+            return false;
+        }
+        pkey_ = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr,
+                                             priv_bytes.data(), priv_bytes.size());
+        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
+        if (!pkey_) {
+            return false;
+        }
+        unsigned char pubbuf[32];
+        size_t pub_len = sizeof(pubbuf);
+        if (EVP_PKEY_get_raw_public_key(pkey_, pubbuf, &pub_len) != 1) {
+            reset();
+            return false;
+        }
+        pubkey_hex_ = hex_encode(pubbuf, pub_len);
+        ctx_ = EVP_MD_CTX_new();
+        if (!ctx_) {
+            reset();
+            return false;
+        }
+        return true;
+    }
+
+    // Sign one message with the prepared key and context.  Returns
+    // false if init() has not succeeded or the operation fails.
+    bool sign(const std::string &message, std::string &signature_out) {
+        if (!ctx_) return false;
+        if (EVP_DigestSignInit(ctx_, nullptr, nullptr, nullptr, pkey_) != 1) {
+            return false;
+        }
+        size_t siglen = 0;
+        if (EVP_DigestSign(ctx_, nullptr, &siglen,
+                           reinterpret_cast<const unsigned char *>(message.data()),
+                           message.size()) != 1) {
+            return false;
+        }
+        std::vector<unsigned char> sigbuf(siglen);
+        if (EVP_DigestSign(ctx_, sigbuf.data(), &siglen,
+                           reinterpret_cast<const unsigned char *>(message.data()),
+                           message.size()) != 1) {
+            OPENSSL_cleanse(sigbuf.data(), sigbuf.size());
+            return false;
+        }
+        signature_out = hex_encode(sigbuf.data(), siglen);
+        OPENSSL_cleanse(sigbuf.data(), sigbuf.size());
+        return true;
+    }
+
+    const std::string &pubkey_hex() const { return pubkey_hex_; }
+
+private:
+    void reset() {
+        if (ctx_) { EVP_MD_CTX_free(ctx_); ctx_ = nullptr; }
+        if (pkey_) { EVP_PKEY_free(pkey_); pkey_ = nullptr; }
+        pubkey_hex_.clear();
+    }
+
+    EVP_PKEY *pkey_ = nullptr;
+    EVP_MD_CTX *ctx_ = nullptr;
+    std::string pubkey_hex_;
+};
+
+// Rewrite a persisted report file with its signature fields filled
+// in.  Best effort: an unreadable or malformed file is left as-is
+// (the report then simply remains unsigned, as when no key is set).
+static void backfill_signature_file(const std::string &path,
+                                    const std::string &signature_hex,
+                                    const std::string &pubkey_id) {
+    try {
+        json j;
+        {
+            std::ifstream ifs(path);
+            if (!ifs) return;
+            j = json::parse(ifs, nullptr, false);
+        }
+        if (j.is_discarded()) return;
+        j["signature"] = signature_hex;
+        j["pubkey_id"] = pubkey_id;
+        j["sig_alg"] = "ed25519";
+        std::ofstream ofs(path);
+        ofs << j.dump(2);
+    } catch (...) {
+        // leave the unsigned report in place
+    }
+}
+
+class ReportSigner {
+public:
+    static ReportSigner &instance() {
+        static ReportSigner signer;
+        return signer;
+    }
+
+    // Queue a persisted-but-unsigned report for signing.  `message` is
+    // the exact payload the signature covers (the JSON dump without
+    // signature or snapshot-encryption fields, same as the inline
+    // path).  When out_path is non-empty the signature is backfilled
+    // into that JSON file; when to_log is set the completed record is
+    // appended to the binary report log instead (final_json carries
+    // the full report JSON the record is built from).  When to_db is
+    // set the completed report is forwarded to the audit writer after
+    // signing.  Blocks while the queue is full.
+    void submit(const std::string &rid, std::string message,
+                std::string out_path, std::string final_json, bool to_log,
+                Report report, const std::string &out_dir,
+                bool to_db, bool db_sync) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_cv_.wait(lock, [this] {
+                return queue_.size() < max_queue_ || stop_;
+            });
+            if (stop_) return;
+            queue_.push_back(Item{rid, std::move(message), std::move(out_path),
+                                  std::move(final_json), to_log,
+                                  std::move(report), out_dir, to_db, db_sync});
+            if (!thread_.joinable()) {
+                thread_ = std::thread(&ReportSigner::run, this);
+            }
+        }
+        queue_cv_.notify_one();
+    }
+
+    ~ReportSigner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        space_cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    struct Item {
+        std::string rid;
+        std::string message;
+        std::string out_path;
+        std::string final_json;
+        bool to_log;
+        Report report;
+        std::string out_dir;
+        bool to_db;
+        bool db_sync;
+    };
+
+    ReportSigner() {
+        // The worker forwards to AuditWriter::instance(); touching it
+        // here guarantees the writer is constructed first and thus
+        // destroyed after this queue has drained at shutdown.
+        AuditWriter::instance();
+        if (const char *env = std::getenv("CHANGE_SIGN_QUEUE_MAX")) {
+            long v = std::atol(env);
+            if (v > 0) max_queue_ = static_cast<size_t>(v);
+        }
+    }
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;  // worker waits for work
+    std::condition_variable space_cv_;  // producers wait for space
+    std::deque<Item> queue_;
+    std::thread thread_;
+    bool stop_ = false;
+    size_t max_queue_ = 1024;
+};
+
+// Signing worker main loop: drain the queue in batches and sign every
+// drained report with one reused key/context.  The loop exits only
+// once the queue is empty after stop, so reports accepted before
+// shutdown are always signed.
+void ReportSigner::run() {
+    for (;;) {
+        std::vector<Item> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty() && stop_) break;
+            batch.reserve(queue_.size());
+            while (!queue_.empty()) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        space_cv_.notify_all();
+
+        // Key setup once per batch (also picks up key rotation between
+        // batches, matching the inline path's per-call env read).
+        Ed25519Signer signer;
+        bool have_key = false;
+        if (const char *priv_hex = std::getenv("ED25519_PRIV_HEX")) {
+            have_key = *priv_hex && signer.init(priv_hex);
+        }
+
+        for (auto &item : batch) {
+            if (have_key) {
+                std::string signature_hex;
+                if (signer.sign(item.message, signature_hex)) {
+                    std::string pubkey_id = signer.pubkey_hex().substr(0, 24);
+                    if (!item.out_path.empty()) {
+                        backfill_signature_file(item.out_path, signature_hex, pubkey_id);
+                    }
+                    if (item.to_log) {
+                        json j = json::parse(item.final_json, nullptr, false);
+                        if (!j.is_discarded()) {
+                            j["signature"] = signature_hex;
+                            j["pubkey_id"] = pubkey_id;
+                            j["sig_alg"] = "ed25519";
+                            item.final_json = j.dump();
+                        }
+                    }
+                    item.report.signature = signature_hex;
+                    item.report.pubkey_id = pubkey_id;
+                    item.report.sig_alg = "ed25519";
+                }
+            }
+            if (item.to_log) {
+                BinaryReportLog::instance().append(item.out_dir, item.rid,
+                                                   item.final_json);
+            }
+            if (item.to_db) {
+                try {
+                    AuditWriter::instance().submit(item.rid, std::move(item.report),
+                                                   item.out_dir, item.db_sync);
+                } catch (...) {
+                    // ignore DB errors
+                }
+            }
+        }
+    }
+}
+
 // Forward declarations of helper functions.
 static std::vector<std::string> split_lines(const std::string &text);
 static std::string unified_diff(const std::string &old_str, const std::string &new_str, const std::string &path);
 static std::string pseudo_sha256(const std::string &input);
 static std::string compute_sha256(const std::string &input);
+static std::string cached_file_sha256(const std::string &path,
+                                      const std::string &content);
 static std::string compute_hmac_sha256(const std::string &data, const std::string &key);
 // Decode a hexadecimal string into a byte vector.  Returns false on
 // invalid input.
@@ -165,7 +1125,8 @@ static bool sign_ed25519(const std::string &message,
                          const std::string &privkey_hex,
                          std::string &signature_out,
                          std::string &pubkey_hex_out);
-static json compute_ast_delta(const std::string &old_str, const std::string &new_str);
+static json compute_ast_delta(const std::string &old_str, const std::string &new_str,
+                              const std::string &old_sha256, const std::string &new_sha256);
 
 Report build_report(const std::string &path,
                     const std::string &old_content,
@@ -189,7 +1150,9 @@ Report build_report(const std::string &path,
     // implementation.  Compute the hash of the old content, new
     // content and diff.  The outputs are 64‑character hex strings.
     try {
-        report.old_sha256 = compute_sha256(old_content);
+        // The old content is what is currently on disk at `path`, so
+        // its hash can usually be served from the file-hash cache.
+        report.old_sha256 = cached_file_sha256(path, old_content);
         report.new_sha256 = compute_sha256(new_content);
         report.diff_sha256 = compute_sha256(report.diff);
     } catch (...) {
@@ -200,7 +1163,11 @@ Report build_report(const std::string &path,
         report.diff_sha256 = pseudo_sha256(report.diff);
     }
     // Compute a simple AST delta.  See compute_ast_delta for details.
-    report.ast_delta = compute_ast_delta(old_content, new_content);
+    // The content hashes key its symbol-table cache: consecutive
+    // changes to a file share this change's new content as the next
+    // change's old content, so half the extraction work repeats.
+    report.ast_delta = compute_ast_delta(old_content, new_content,
+                                         report.old_sha256, report.new_sha256);
     // Note: Signing is deferred to save_report() where the final
     // JSON representation is available.  report.signature remains
     // empty here and will be populated later by save_report().
@@ -245,29 +1212,47 @@ std::string save_report(const Report &report, const std::string &out_dir) {
     j["explanation_errors"] = report.explanation_errors;
 
     // Determine if Ed25519 signing is configured.  The private key
-    // should be provided via ED25519_PRIV_HEX.  If present we
-    // attempt to sign the JSON payload.  We compute the signature
-    // over the JSON string without the signature fields to avoid
-    // circular dependencies.  We also copy the signature fields
-    // back into a local copy of the report for DB insertion.
+    // should be provided via ED25519_PRIV_HEX.  The signature covers
+    // the JSON string without the signature fields to avoid circular
+    // dependencies.  By default signing is deferred: the report is
+    // persisted unsigned and the background signer backfills
+    // signature/pubkey_id, keeping the crypto off the request path.
+    // CHANGE_SIGN_SYNC=on signs inline instead, for deployments that
+    // must not acknowledge a change before its report is signed.
     const char *priv_hex = std::getenv("ED25519_PRIV_HEX");
-    std::string signature_hex;
-    std::string pubkey_hex;
     // Local copy for DB persistence
     Report db_report = report;
+    bool sign_inline = false;
+    if (const char *sync_env = std::getenv("CHANGE_SIGN_SYNC")) {
+        std::string v = sync_env;
+        std::transform(v.begin(), v.end(), v.begin(),
+                       [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        sign_inline = (v == "on" || v == "1" || v == "true" || v == "strict");
+    }
+    std::string unsigned_message;
+    bool defer_signing = false;
     if (priv_hex && *priv_hex) {
-        try {
-            std::string message = j.dump();
-            if (sign_ed25519(message, std::string(priv_hex), signature_hex, pubkey_hex)) {
-                j["signature"] = signature_hex;
-                j["pubkey_id"] = pubkey_hex.substr(0, 24); // first 12 bytes (24 hex chars)
-                j["sig_alg"] = "ed25519";
-                db_report.signature = signature_hex;
-                db_report.pubkey_id = pubkey_hex.substr(0, 24);
-                db_report.sig_alg = "ed25519";
+        if (sign_inline) {
+            try {
+                std::string message = j.dump();
+                std::string signature_hex;
+                std::string pubkey_hex;
+                if (sign_ed25519(message, std::string(priv_hex), signature_hex, pubkey_hex)) {
+                    j["signature"] = signature_hex;
+                    j["pubkey_id"] = pubkey_hex.substr(0, 24); // first 12 bytes (24 hex chars)
+                    j["sig_alg"] = "ed25519";
+                    db_report.signature = signature_hex;
+                    db_report.pubkey_id = pubkey_hex.substr(0, 24);
+                    db_report.sig_alg = "ed25519";
+                }
+            } catch (...) {
+                // leave signature fields absent
             }
-        } catch (...) {
-            // leave signature fields absent
+        } else {
+            // Snapshot the exact payload the signature covers before
+            // the snapshot-encryption fields are appended below.
+            unsigned_message = j.dump();
+            defer_signing = true;
         }
     }
 
@@ -285,21 +1270,56 @@ std::string save_report(const Report &report, const std::string &out_dir) {
         db_report.tag = report.tag;
     }
 
-    // Write JSON report to file
-    std::ofstream ofs(out_path);
-    ofs << j.dump(2);
+    // Persist the report.  Default is one pretty-printed JSON file per
+    // report; CHANGE_LOG_FORMAT=binary routes it to the append-only
+    // binary log instead.  Log records are appended complete — when
+    // signing is deferred the signing worker appends the record after
+    // filling in the signature fields, since an append-only segment
+    // cannot be rewritten in place the way the JSON file is.
+    bool to_log = binary_log_enabled();
+    if (!to_log) {
+        // Unsigned when signing is deferred; the signer rewrites the
+        // file with the signature fields filled in.
+        std::ofstream ofs(out_path);
+        ofs << j.dump(2);
+    } else if (!defer_signing) {
+        BinaryReportLog::instance().append(out_dir, rid, j.dump());
+    }
 
-    // Attempt to initialise SQLite persistence and insert the
-    // report into the database.  This is a best effort: errors
-    // silently disable DB insertion.  The caller can set
-    // CHANGE_USE_SQLITE=1 to enable this feature.  The DB file is
-    // created in the same directory as the reports.
-    try {
-        if (init_db(out_dir)) {
-            insert_report_db(rid, db_report);
+    // Hand the report to the asynchronous audit writer, which batches
+    // SQLite inserts on a dedicated thread.  This is a best effort:
+    // errors silently disable DB insertion.  The caller can set
+    // CHANGE_USE_SQLITE=1 to enable the feature and CHANGE_AUDIT_SYNC=on
+    // to block until the row is durable.
+    const char *use_db = std::getenv("CHANGE_USE_SQLITE");
+    bool to_db = use_db && *use_db;
+    bool db_sync = false;
+    if (to_db) {
+        if (const char *sync_env = std::getenv("CHANGE_AUDIT_SYNC")) {
+            std::string v = sync_env;
+            std::transform(v.begin(), v.end(), v.begin(),
+                           [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+            db_sync = (v == "on" || v == "1" || v == "true" || v == "strict");
+        }
+    }
+    if (defer_signing) {
+        // The signer forwards to the audit writer once the signature
+        // fields are complete, so the DB row is never left unsigned.
+        try {
+            ReportSigner::instance().submit(
+                rid, std::move(unsigned_message),
+                to_log ? std::string() : out_path.string(),
+                to_log ? j.dump() : std::string(), to_log,
+                std::move(db_report), out_dir, to_db, db_sync);
+        } catch (...) {
+            // ignore signing queue errors
+        }
+    } else if (to_db) {
+        try {
+            AuditWriter::instance().submit(rid, std::move(db_report), out_dir, db_sync);
+        } catch (...) {
+            // ignore DB errors
         }
-    } catch (...) {
-        // ignore DB errors
     }
     return rid;
 }
@@ -352,29 +1372,31 @@ static std::string pseudo_sha256(const std::string &input) {
 // Compute a real SHA‑256 hash of the input using OpenSSL.  The
 // function returns a 64‑character lowercase hexadecimal string.  If
 // OpenSSL reports an error a std::runtime_error is thrown.
+//
+// OpenSSL dispatches SHA-256 to the CPU's SHA extensions (SHA-NI on
+// x86, the ARMv8 crypto extensions) at runtime, so the bulk hashing
+// is already hardware-accelerated; the remaining per-call overhead
+// worth removing is the context allocation, hence the reused
+// thread-local context.
 static std::string compute_sha256(const std::string &input) {
     unsigned char md[EVP_MAX_MD_SIZE];
     unsigned int md_len = 0;
-    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    thread_local EVP_MD_CTX *ctx = EVP_MD_CTX_new();
     if (!ctx) {
         throw std::runtime_error("Failed to allocate EVP_MD_CTX");
     }
     const EVP_MD *algo = EVP_sha256();
     if (EVP_DigestInit_ex(ctx, algo, nullptr) != 1) {
-        EVP_MD_CTX_free(ctx);
         throw std::runtime_error("EVP_DigestInit_ex failed");
     }
     if (!input.empty()) {
         if (EVP_DigestUpdate(ctx, input.data(), input.size()) != 1) {
-            EVP_MD_CTX_free(ctx);
             throw std::runtime_error("EVP_DigestUpdate failed");
         }
     }
     if (EVP_DigestFinal_ex(ctx, md, &md_len) != 1) {
-        EVP_MD_CTX_free(ctx);
         throw std::runtime_error("EVP_DigestFinal_ex failed");
     }
-    EVP_MD_CTX_free(ctx);
     std::ostringstream oss;
     oss << std::hex << std::setfill('0');
     for (unsigned int i = 0; i < md_len; ++i) {
@@ -383,6 +1405,99 @@ static std::string compute_sha256(const std::string &input) {
     return oss.str();
 }
 
+//===========================================================================
+// OLD-CONTENT HASH CACHE
+//===========================================================================
+//
+// build_report() hashes the old content on every call even though,
+// for the steady-state case of Cockpit repeatedly editing the same
+// files, that exact content was written (and its hash computed as
+// new_sha256) by the previous change.  A small LRU keyed by path
+// remembers the (mtime, size, sha256) of content last seen on disk;
+// when the file's stat still matches, the old-content hash is a
+// lookup instead of a full hash pass.  The mtime+size check means a
+// file modified outside Cockpit simply misses and is re-hashed.
+
+namespace {
+
+struct FileHashEntry {
+    long long mtime_ns;
+    uint64_t size;
+    std::string sha256;
+    std::list<std::string>::iterator lru_it;
+};
+
+constexpr size_t FILE_HASH_CACHE_MAX = 256;
+
+std::mutex g_file_hash_mutex;
+std::unordered_map<std::string, FileHashEntry> g_file_hash_map;
+std::list<std::string> g_file_hash_lru;  // front = most recent
+
+} // namespace
+
+// Insert or refresh a cache entry.  Caller must hold g_file_hash_mutex.
+static void file_hash_cache_store(const std::string &path, long long mtime_ns,
+                                  uint64_t size, const std::string &sha) {
+    auto it = g_file_hash_map.find(path);
+    if (it != g_file_hash_map.end()) {
+        it->second.mtime_ns = mtime_ns;
+        it->second.size = size;
+        it->second.sha256 = sha;
+        g_file_hash_lru.splice(g_file_hash_lru.begin(), g_file_hash_lru,
+                               it->second.lru_it);
+        return;
+    }
+    g_file_hash_lru.push_front(path);
+    g_file_hash_map[path] = FileHashEntry{mtime_ns, size, sha,
+                                          g_file_hash_lru.begin()};
+    if (g_file_hash_map.size() > FILE_HASH_CACHE_MAX) {
+        g_file_hash_map.erase(g_file_hash_lru.back());
+        g_file_hash_lru.pop_back();
+    }
+}
+
+// Hash `content`, which the caller just read from `path`, reusing the
+// cached digest when the file's mtime and size are unchanged since the
+// hash was last computed.  Falls back to a plain hash (and no cache
+// entry) when the file cannot be stat'ed, e.g. for new files.
+static std::string cached_file_sha256(const std::string &path,
+                                      const std::string &content) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 ||
+        static_cast<uint64_t>(st.st_size) != content.size()) {
+        return compute_sha256(content);
+    }
+    long long mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL +
+                         st.st_mtim.tv_nsec;
+    {
+        std::lock_guard<std::mutex> lock(g_file_hash_mutex);
+        auto it = g_file_hash_map.find(path);
+        if (it != g_file_hash_map.end() &&
+            it->second.mtime_ns == mtime_ns &&
+            it->second.size == content.size()) {
+            g_file_hash_lru.splice(g_file_hash_lru.begin(), g_file_hash_lru,
+                                   it->second.lru_it);
+            return it->second.sha256;
+        }
+    }
+    std::string sha = compute_sha256(content);
+    std::lock_guard<std::mutex> lock(g_file_hash_mutex);
+    file_hash_cache_store(path, mtime_ns, content.size(), sha);
+    return sha;
+}
+
+void note_file_written(const std::string &path, const std::string &sha256) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return;
+    }
+    long long mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL +
+                         st.st_mtim.tv_nsec;
+    std::lock_guard<std::mutex> lock(g_file_hash_mutex);
+    file_hash_cache_store(path, mtime_ns,
+                          static_cast<uint64_t>(st.st_size), sha256);
+}
+
 // Compute an HMAC‑SHA256 over the given data using the provided key.
 // The key should be kept secret (e.g. loaded from a secure source).
 // Returns a hex string.  If HMAC fails a std::runtime_error is
@@ -448,69 +1563,22 @@ static std::string hex_encode(const unsigned char *data, size_t len) {
 }
 
 // Sign a message using an Ed25519 private key provided as a hex string.
-// The OpenSSL EVP_PKEY raw key APIs are used to construct the key and
-// perform a one‑shot signature.  On success signature_out contains a
-// hex‑encoded signature and pubkey_hex_out contains the corresponding
-// public key in hex.  Returns false if the key is invalid or if the
-// signing operation fails.
+// One-shot convenience wrapper over Ed25519Signer (used by the inline
+// CHANGE_SIGN_SYNC path); the batch path keeps the signer alive
+// across messages instead.  Returns false if the key is invalid or if
+// the signing operation fails.
 static bool sign_ed25519(const std::string &message,
                          const std::string &privkey_hex,
                          std::string &signature_out,
                          std::string &pubkey_hex_out) {
-    std::vector<unsigned char> priv_bytes;
-    if (!hex_decode(privkey_hex, priv_bytes) || priv_bytes.size() != 32) {
+    Ed25519Signer signer;
+    if (!signer.init(privkey_hex)) {
         return false;
     }
-    EVP_PKEY *pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr,
-                                                  priv_bytes.data(), priv_bytes.size());
-    if (!pkey) {
-        // zeroize before returning
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
+    if (!signer.sign(message, signature_out)) {
         return false;
     }
-    unsigned char pubbuf[32];
-    size_t pub_len = sizeof(pubbuf);
-    if (EVP_PKEY_get_raw_public_key(pkey, pubbuf, &pub_len) != 1) {
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-        EVP_PKEY_free(pkey);
-        return false;
-    }
-    pubkey_hex_out = hex_encode(pubbuf, pub_len);
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, nullptr);
-    if (!ctx) {
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-        EVP_PKEY_free(pkey);
-        return false;
-    }
-    if (EVP_PKEY_sign_init(ctx) != 1) {
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(pkey);
-        return false;
-    }
-    size_t siglen = 0;
-    if (EVP_PKEY_sign(ctx, nullptr, &siglen,
-                      reinterpret_cast<const unsigned char *>(message.data()), message.size()) != 1) {
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(pkey);
-        return false;
-    }
-    std::vector<unsigned char> sigbuf(siglen);
-    if (EVP_PKEY_sign(ctx, sigbuf.data(), &siglen,
-                      reinterpret_cast<const unsigned char *>(message.data()), message.size()) != 1) {
-        OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-        OPENSSL_cleanse(sigbuf.data(), sigbuf.size());
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(pkey);
-        return false;
-    }
-    signature_out = hex_encode(sigbuf.data(), siglen);
-    // Zeroize sensitive buffers
-    OPENSSL_cleanse(priv_bytes.data(), priv_bytes.size());
-    OPENSSL_cleanse(sigbuf.data(), sigbuf.size());
-    EVP_PKEY_CTX_free(ctx);
-    EVP_PKEY_free(pkey);
+    pubkey_hex_out = signer.pubkey_hex();
     return true;
 }
 
@@ -518,59 +1586,162 @@ static bool sign_ed25519(const std::string &message,
 // resembles the output of `git diff --unified=0` but without context
 // lines.  We prefix the diff with "--- a/<path>" and "+++ b/<path>"
 // headers to mirror the Python version.  The core of the diff is a
-// line oriented comparison that emits deletions and insertions; lines
+// Myers O(ND) shortest-edit-script computation over the lines; lines
 // that are unchanged are omitted to keep the report concise.
-// A minimal implementation of Myers diff algorithm would be too complex to show here.
-// The following is a conceptual placeholder for a proper diff implementation.
-// For a production system, it's recommended to integrate a well-tested library
-// or implement a standard algorithm like Myers Diff.
 
-// Helper for Myers diff
+// Helper for Myers diff.  Only changed lines are recorded ('-' for a
+// deletion, '+' for an insertion); unified_diff never emits unchanged
+// lines, so we avoid copying them through the result.
 struct DiffResult {
-    std::vector<std::pair<char, std::string>> changes; // ' ' for unchanged, '-' for deletion, '+' for addition
+    std::vector<std::pair<char, std::string>> changes;
 };
 
-// Placeholder for a proper diff algorithm (e.g., Myers diff)
+// 64-bit FNV-1a line hash.  Line comparisons during the diff compare
+// hashes first and only fall back to a full string compare on a hash
+// match, so the inner loop never touches line bytes for mismatches.
+static uint64_t hash_line(const std::string &line) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : line) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Beyond this edit distance we give up on a minimal script and emit a
+// whole-region replacement.  Keeps worst-case time and the O(D^2)
+// backtrack trace bounded when the two sides share almost nothing.
+static constexpr int MYERS_MAX_D = 4096;
+
+// Myers O(ND) diff over pre-hashed lines with common prefix/suffix
+// trimming.  Returns the minimal edit script for the middle region
+// (or a full replacement if the edit distance exceeds MYERS_MAX_D).
 static DiffResult myers_diff_lines(const std::vector<std::string>& old_lines, const std::vector<std::string>& new_lines) {
-    // This is a highly simplified and incorrect diff for demonstration.
-    // A real implementation is required here.
     DiffResult res;
-    size_t i = 0, j = 0;
-    while (i < old_lines.size() && j < new_lines.size()) {
-        if (old_lines[i] == new_lines[j]) {
-            res.changes.push_back({' ', old_lines[i]});
-            i++; j++;
-        } else {
-            // Heuristically find next match (this is where real algorithm is needed)
-            size_t next_i = i + 1, next_j = j + 1;
-            while(next_i < old_lines.size() && old_lines[next_i] != new_lines[j]) next_i++;
-            while(next_j < new_lines.size() && old_lines[i] != new_lines[next_j]) next_j++;
 
-            if (next_i - i < next_j - j) {
-                res.changes.push_back({'-', old_lines[i++]});
+    // Trim the common prefix and suffix first; for typical changes to
+    // large files this shrinks the problem from the whole file to the
+    // edited region.
+    size_t lo = 0;
+    while (lo < old_lines.size() && lo < new_lines.size() &&
+           old_lines[lo] == new_lines[lo]) {
+        lo++;
+    }
+    size_t old_hi = old_lines.size();
+    size_t new_hi = new_lines.size();
+    while (old_hi > lo && new_hi > lo &&
+           old_lines[old_hi - 1] == new_lines[new_hi - 1]) {
+        old_hi--;
+        new_hi--;
+    }
+
+    const int n = static_cast<int>(old_hi - lo);
+    const int m = static_cast<int>(new_hi - lo);
+    if (n == 0 && m == 0) {
+        return res;
+    }
+
+    std::vector<uint64_t> old_hash(n), new_hash(m);
+    for (int i = 0; i < n; ++i) old_hash[i] = hash_line(old_lines[lo + i]);
+    for (int j = 0; j < m; ++j) new_hash[j] = hash_line(new_lines[lo + j]);
+    auto lines_equal = [&](int i, int j) {
+        return old_hash[i] == new_hash[j] &&
+               old_lines[lo + i] == new_lines[lo + j];
+    };
+
+    // Emit the full middle region as a replacement (used both for the
+    // over-budget fallback and directly when one side is empty).
+    auto emit_replace = [&]() {
+        res.changes.reserve(static_cast<size_t>(n + m));
+        for (int i = 0; i < n; ++i) res.changes.push_back({'-', old_lines[lo + i]});
+        for (int j = 0; j < m; ++j) res.changes.push_back({'+', new_lines[lo + j]});
+    };
+
+    const int limit = std::min(n + m, MYERS_MAX_D);
+
+    // Forward pass: furthest-reaching x for each diagonal k, keeping a
+    // per-d snapshot of the frontier for backtracking.  trace[d][i]
+    // holds x for diagonal k = -d + 2*i.
+    std::vector<std::vector<int>> trace;
+    std::vector<int> v(2 * static_cast<size_t>(limit) + 3, 0);
+    const int offset = limit + 1;
+    int found_d = -1;
+    for (int d = 0; d <= limit && found_d < 0; ++d) {
+        trace.emplace_back(static_cast<size_t>(d) + 1);
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                x = v[offset + k + 1];
             } else {
-                res.changes.push_back({'+', new_lines[j++]});
+                x = v[offset + k - 1] + 1;
             }
-        static std::string unified_diff(const std::string &old_str, const std::string &new_str, const std::string &path) {
-            // Fallback: if proper diff not implemented, emit full replace hunk
-            std::stringstream diff;
-            diff << "--- a/" << path << "\n";
-            diff << "+++ b/" << path << "\n";
-            // Single hunk covering entire files
-            size_t old_lines = split_lines(old_str).size();
-            size_t new_lines = split_lines(new_str).size();
-            diff << "@@ -" << (old_lines ? 1 : 0) << "," << old_lines
-                 << " +" << (new_lines ? 1 : 0) << "," << new_lines << " @@\n";
-            // Emit deletions then additions to avoid ambiguity
-            for (const auto &line : split_lines(old_str)) {
-                diff << "-" << line << "\n";
+            int y = x - k;
+            while (x < n && y < m && lines_equal(x, y)) {
+                x++;
+                y++;
             }
-            for (const auto &line : split_lines(new_str)) {
-                diff << "+" << line << "\n";
+            v[offset + k] = x;
+            trace[d][(k + d) / 2] = x;
+            if (x >= n && y >= m) {
+                found_d = d;
+                break;
             }
-    // This part would need to generate hunk headers (e.g., @@ -1,5 +1,5 @@)
-    // For simplicity, we just print the changed lines.
-    for (const auto& change : result.changes) {
+        }
+    }
+    if (found_d < 0) {
+        emit_replace();
+        return res;
+    }
+
+    // Backtrack through the frontier snapshots, collecting edits in
+    // reverse order.
+    std::vector<std::pair<char, int>> edits;
+    edits.reserve(static_cast<size_t>(found_d));
+    int x = n;
+    int y = m;
+    for (int d = found_d; d > 0; --d) {
+        const std::vector<int> &prev = trace[d - 1];
+        auto prev_x_for = [&](int kk) { return prev[(kk + d - 1) / 2]; };
+        int k = x - y;
+        int prev_k;
+        if (k == -d || (k != d && prev_x_for(k - 1) < prev_x_for(k + 1))) {
+            prev_k = k + 1;
+        } else {
+            prev_k = k - 1;
+        }
+        int prev_x = prev_x_for(prev_k);
+        int prev_y = prev_x - prev_k;
+        if (prev_k == k + 1) {
+            edits.push_back({'+', prev_y});
+        } else {
+            edits.push_back({'-', prev_x});
+        }
+        x = prev_x;
+        y = prev_y;
+    }
+    res.changes.reserve(edits.size());
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        if (it->first == '-') {
+            res.changes.push_back({'-', old_lines[lo + it->second]});
+        } else {
+            res.changes.push_back({'+', new_lines[lo + it->second]});
+        }
+    }
+    return res;
+}
+
+static std::string unified_diff(const std::string &old_str, const std::string &new_str, const std::string &path) {
+    std::stringstream diff;
+    diff << "--- a/" << path << "\n";
+    diff << "+++ b/" << path << "\n";
+    std::vector<std::string> old_lines = split_lines(old_str);
+    std::vector<std::string> new_lines = split_lines(new_str);
+    // Single hunk covering both files.  We do not emit context lines;
+    // unchanged lines are simply omitted to keep the report concise.
+    diff << "@@ -" << (old_lines.empty() ? 0 : 1) << "," << old_lines.size()
+         << " +" << (new_lines.empty() ? 0 : 1) << "," << new_lines.size() << " @@\n";
+    DiffResult result = myers_diff_lines(old_lines, new_lines);
+    for (const auto &change : result.changes) {
         if (change.first != ' ') {
             diff << change.first << change.second << "\n";
         }
@@ -578,49 +1749,208 @@ static DiffResult myers_diff_lines(const std::vector<std::string>& old_lines, co
     return diff.str();
 }
 
-    std::vector<std::string> lines = split_lines(source);
+//===========================================================================
+// SYMBOL TABLE CACHE
+//===========================================================================
+//
+// compute_ast_delta() used to regex-scan both the full old and full
+// new content on every change.  Consecutive changes to a file share
+// the previous change's new content as this change's old content, so
+// half that work is always redundant.  A small LRU keyed by content
+// sha256 remembers the extracted symbol table; on the steady-state
+// path the old side is a lookup and only genuinely new content is
+// scanned.  Tables store per-symbol occurrence counts rather than a
+// set, which makes the diff-guided incremental update below exact:
+// extraction is strictly line-local, so a content's table is the sum
+// of its lines' tables.
+
+namespace {
+
+// symbol name → number of defining lines
+using SymbolTable = std::unordered_map<std::string, int>;
+
+constexpr size_t SYMBOL_CACHE_MAX = 128;
+
+// Files at or above this many lines take the incremental path when
+// the old side's table is cached: re-extract only the changed middle
+// (lines outside the common prefix/suffix) instead of the whole file.
+constexpr size_t SYMBOL_INCREMENTAL_MIN_LINES = 2048;
+
+struct SymbolCacheEntry {
+    std::shared_ptr<const SymbolTable> table;
+    std::list<std::string>::iterator lru_it;
+};
+
+std::mutex g_symbol_cache_mutex;
+std::unordered_map<std::string, SymbolCacheEntry> g_symbol_cache_map;
+std::list<std::string> g_symbol_cache_lru;  // front = most recent
+
+std::shared_ptr<const SymbolTable> symbol_cache_get(const std::string &sha256) {
+    std::lock_guard<std::mutex> lock(g_symbol_cache_mutex);
+    auto it = g_symbol_cache_map.find(sha256);
+    if (it == g_symbol_cache_map.end()) {
+        return nullptr;
+    }
+    g_symbol_cache_lru.splice(g_symbol_cache_lru.begin(), g_symbol_cache_lru,
+                              it->second.lru_it);
+    return it->second.table;
+}
+
+void symbol_cache_put(const std::string &sha256,
+                      std::shared_ptr<const SymbolTable> table) {
+    std::lock_guard<std::mutex> lock(g_symbol_cache_mutex);
+    auto it = g_symbol_cache_map.find(sha256);
+    if (it != g_symbol_cache_map.end()) {
+        it->second.table = std::move(table);
+        g_symbol_cache_lru.splice(g_symbol_cache_lru.begin(),
+                                  g_symbol_cache_lru, it->second.lru_it);
+        return;
+    }
+    g_symbol_cache_lru.push_front(sha256);
+    g_symbol_cache_map[sha256] =
+        SymbolCacheEntry{std::move(table), g_symbol_cache_lru.begin()};
+    if (g_symbol_cache_map.size() > SYMBOL_CACHE_MAX) {
+        g_symbol_cache_map.erase(g_symbol_cache_lru.back());
+        g_symbol_cache_lru.pop_back();
+    }
+}
+
+} // namespace
+
+// Add (delta = +1) or subtract (delta = -1) the symbols defined on a
+// single line.  This is deliberately regex based rather than a real
+// parser: it only needs to be stable enough that the AST delta
+// reports which definitions appeared or disappeared.
+static void count_line_symbols(const std::string &line, SymbolTable &counts,
+                               int delta) {
     // Require an opening brace to reduce false positives; allow trailing spaces/comments
     static const std::regex func_def(R"(^\s*(?:inline\s+)?(?:static\s+)?(?:virtual\s+)?(?:[\w:\<\>\s\*&]+)\s+([A-Za-z_][A-Za-z0-9_]*)\s*\([^;]*\)\s*(?:const\s*)?\{)");
     static const std::regex class_def(R"(^\s*class\s+([A-Za-z_][A-Za-z0-9_]*)\b)");
     std::smatch m;
+    const std::string *name = nullptr;
+    std::string captured;
+    if (std::regex_search(line, m, func_def)) {
+        captured = m[1];
+        name = &captured;
+    } else if (std::regex_search(line, m, class_def)) {
+        captured = m[1];
+        name = &captured;
+    }
+    if (!name) {
+        return;
+    }
+    int &count = counts[*name];
+    count += delta;
+    if (count <= 0) {
+        counts.erase(*name);
+    }
+}
+
+// Extract the full symbol table (per-symbol defining-line counts)
+// from a source string.
+static SymbolTable extract_symbols(const std::string &source) {
+    SymbolTable symbols;
+    std::vector<std::string> lines = split_lines(source);
     for (const auto &line : lines) {
-        if (std::regex_search(line, m, func_def)) {
-            symbols.insert(m[1]);
-        } else if (std::regex_search(line, m, class_def)) {
-            symbols.insert(m[1]);
-    static const std::regex class_regex(R"(^\s*class\s+([A-Za-z_][A-Za-z0-9_]*)\b)");
-    std::smatch m;
-    for (const auto &line : lines) {
-        if (std::regex_search(line, m, func_regex)) {
-            symbols.insert(m[1]);
-        } else if (std::regex_search(line, m, class_regex)) {
-            symbols.insert(m[1]);
-        }
+        count_line_symbols(line, symbols, 1);
     }
     return symbols;
 }
 
+// Derive `new_str`'s symbol table from the old content's cached
+// table by rescanning only the lines outside the common line prefix
+// and suffix.  Exact because extraction is line-local: subtract the
+// old middle's symbols, add the new middle's.
+static SymbolTable incremental_symbols(const SymbolTable &old_table,
+                                       const std::vector<std::string> &old_lines,
+                                       const std::vector<std::string> &new_lines) {
+    size_t prefix = 0;
+    size_t max_prefix = std::min(old_lines.size(), new_lines.size());
+    while (prefix < max_prefix && old_lines[prefix] == new_lines[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    size_t max_suffix = max_prefix - prefix;
+    while (suffix < max_suffix &&
+           old_lines[old_lines.size() - 1 - suffix] ==
+               new_lines[new_lines.size() - 1 - suffix]) {
+        suffix++;
+    }
+    SymbolTable table = old_table;
+    for (size_t i = prefix; i < old_lines.size() - suffix; ++i) {
+        count_line_symbols(old_lines[i], table, -1);
+    }
+    for (size_t i = prefix; i < new_lines.size() - suffix; ++i) {
+        count_line_symbols(new_lines[i], table, 1);
+    }
+    return table;
+}
+
+// Look up the symbol table for a content, computing and caching it on
+// a miss.  `other` optionally carries the already-resolved table of
+// the other side of the diff plus both line vectors, enabling the
+// incremental path for large files.
+static std::shared_ptr<const SymbolTable> symbols_for_content(
+    const std::string &content, const std::string &sha256,
+    const std::shared_ptr<const SymbolTable> &old_table,
+    const std::vector<std::string> *old_lines,
+    const std::vector<std::string> *new_lines) {
+    std::shared_ptr<const SymbolTable> cached = symbol_cache_get(sha256);
+    if (cached) {
+        return cached;
+    }
+    std::shared_ptr<SymbolTable> table;
+    if (old_table && old_lines && new_lines &&
+        old_lines->size() >= SYMBOL_INCREMENTAL_MIN_LINES) {
+        table = std::make_shared<SymbolTable>(
+            incremental_symbols(*old_table, *old_lines, *new_lines));
+    } else {
+        table = std::make_shared<SymbolTable>(extract_symbols(content));
+    }
+    symbol_cache_put(sha256, table);
+    return table;
+}
+
 // Compute the AST delta between two source strings.  We call this a
 // "delta" despite not building a full AST: the function returns
 // added and removed definitions based on the crude symbol extraction
 // above.  The return value is a JSON object with `added_defs` and
 // `removed_defs` arrays, matching the Python version.
-static json compute_ast_delta(const std::string &old_str, const std::string &new_str) {
-    auto old_syms = extract_symbols(old_str);
-    auto new_syms = extract_symbols(new_str);
+static json compute_ast_delta(const std::string &old_str, const std::string &new_str,
+                              const std::string &old_sha256,
+                              const std::string &new_sha256) {
+    std::shared_ptr<const SymbolTable> old_syms =
+        symbols_for_content(old_str, old_sha256, nullptr, nullptr, nullptr);
+    // The new side can reuse the old table incrementally when the old
+    // side is large; split the lines only in that case.
+    std::shared_ptr<const SymbolTable> new_syms;
+    if (symbol_cache_get(new_sha256)) {
+        new_syms = symbols_for_content(new_str, new_sha256, nullptr, nullptr,
+                                       nullptr);
+    } else if (old_str.size() >= SYMBOL_INCREMENTAL_MIN_LINES &&
+               std::count(old_str.begin(), old_str.end(), '\n') >=
+                   static_cast<long>(SYMBOL_INCREMENTAL_MIN_LINES)) {
+        std::vector<std::string> old_lines = split_lines(old_str);
+        std::vector<std::string> new_lines = split_lines(new_str);
+        new_syms = symbols_for_content(new_str, new_sha256, old_syms,
+                                       &old_lines, &new_lines);
+    } else {
+        new_syms = symbols_for_content(new_str, new_sha256, nullptr, nullptr,
+                                       nullptr);
+    }
     json delta;
     // Compute added definitions
     json added = json::array();
-    for (const auto &s : new_syms) {
-        if (old_syms.find(s) == old_syms.end()) {
-            added.push_back(s);
+    for (const auto &pair : *new_syms) {
+        if (old_syms->find(pair.first) == old_syms->end()) {
+            added.push_back(pair.first);
         }
     }
     // Compute removed definitions
     json removed = json::array();
-    for (const auto &s : old_syms) {
-        if (new_syms.find(s) == new_syms.end()) {
-            removed.push_back(s);
+    for (const auto &pair : *old_syms) {
+        if (new_syms->find(pair.first) == new_syms->end()) {
+            removed.push_back(pair.first);
         }
     }
     delta["added_defs"] = added;
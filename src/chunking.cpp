@@ -4,12 +4,20 @@
 //
 // Implements pattern-based chunking to expand working memory capacity
 // from base n=4 up to effective capacity of 7±2 items.
+//
+// The chunk library is read-copy-update: every public reader works
+// against one immutable published Library version, and learn_chunk()
+// / clear() swap in a freshly built version.  Cloning the library on
+// a learn is O(library size), which is cheap at the 0.1% learn rate
+// it sees in production; the payoff is that encode() never takes a
+// lock.
 
 #include "chunking.h"
 #include <algorithm>
 #include <numeric>
 #include <sstream>
 #include <functional>
+#include <random>
 
 namespace chunking {
 
@@ -21,65 +29,76 @@ std::vector<std::string> Chunker::encode(const std::vector<std::string>& tokens)
     if (tokens.empty()) {
         return tokens;
     }
-    
+
+    // One snapshot for the whole call: every lookup below sees the
+    // same library version even if a learn publishes mid-encode.
+    std::shared_ptr<const Library> lib = snapshot();
+
     std::vector<std::string> compressed;
     size_t i = 0;
-    
+
     // Scan through tokens looking for chunkable patterns
     while (i < tokens.size()) {
         // Try to find longest matching chunk starting at position i
         bool found_chunk = false;
-        
-        // Search for patterns of length 2-4 tokens
-        for (size_t pattern_len = std::min(size_t(4), tokens.size() - i); 
-             pattern_len >= 2 && !found_chunk; 
-             --pattern_len) {
-            
-            if (i + pattern_len > tokens.size()) {
-                continue;
-            }
-            
-            // Extract subsequence
-            std::vector<std::string> subseq(
-                tokens.begin() + i, 
-                tokens.begin() + i + pattern_len
-            );
-            
-            // Compute embedding
-            std::vector<double> embedding = compute_embedding(subseq);
-            
-            // Check if it matches existing chunk
-            int chunk_id = find_matching_chunk(embedding);
-            
-            if (chunk_id >= 0) {
-                // Found match - replace with chunk ID
-                std::ostringstream oss;
-                oss << "CHUNK_" << chunk_id;
-                compressed.push_back(oss.str());
-                
-                // Update chunk frequency
-                if (chunk_library_.find(chunk_id) != chunk_library_.end()) {
-                    chunk_library_[chunk_id].frequency++;
+
+        // Fast path: exact token-sequence match via the trie.  This
+        // walks at most 4 edges and needs no embedding at all.
+        size_t match_len = 0;
+        int chunk_id = trie_longest_match(*lib, tokens, i, match_len);
+
+        // Slow path: approximate match via the LSH index.  Only
+        // reached for windows the trie has never seen verbatim.
+        if (chunk_id < 0) {
+            for (size_t pattern_len = std::min(size_t(4), tokens.size() - i);
+                 pattern_len >= 2 && chunk_id < 0;
+                 --pattern_len) {
+
+                // Extract subsequence
+                std::vector<std::string> subseq(
+                    tokens.begin() + i,
+                    tokens.begin() + i + pattern_len
+                );
+
+                // Compute embedding
+                fdqc::Vec embedding = compute_embedding(subseq);
+
+                // Check if it matches existing chunk
+                chunk_id = find_matching_chunk_in(*lib, embedding);
+                if (chunk_id >= 0) {
+                    match_len = pattern_len;
                 }
-                
-                i += pattern_len;
-                found_chunk = true;
             }
         }
-        
+
+        if (chunk_id >= 0) {
+            // Found match - replace with chunk ID
+            std::ostringstream oss;
+            oss << "CHUNK_" << chunk_id;
+            compressed.push_back(oss.str());
+
+            // Update chunk frequency (advisory atomic on the shared
+            // version; see the Chunk::frequency comment)
+            auto it = lib->chunks.find(chunk_id);
+            if (it != lib->chunks.end()) {
+                it->second.frequency.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            i += match_len;
+            found_chunk = true;
+        }
+
         // No chunk found - copy token as-is
         if (!found_chunk) {
             compressed.push_back(tokens[i]);
             i++;
         }
     }
-    
-    // Update statistics
+
+    // Update statistics.  Pruning happens in learn_chunk() — the only
+    // place the library grows — so the encode path stays read-only.
     update_stats(tokens.size(), compressed.size());
-    
-    // Prune library if it gets too large
-    prune_library_if_needed();
-    
+
     return compressed;
 }
 
@@ -88,17 +107,18 @@ std::vector<std::string> Chunker::encode(const std::vector<std::string>& tokens)
 //===========================================================================
 
 std::vector<std::string> Chunker::decode(const std::vector<std::string>& codes) const {
+    std::shared_ptr<const Library> lib = snapshot();
     std::vector<std::string> decoded;
-    
+
     for (const std::string& code : codes) {
         // Check if this is a chunk ID
         if (code.substr(0, 6) == "CHUNK_") {
             try {
                 int chunk_id = std::stoi(code.substr(6));
-                
+
                 // Look up chunk in library
-                auto it = chunk_library_.find(chunk_id);
-                if (it != chunk_library_.end()) {
+                auto it = lib->chunks.find(chunk_id);
+                if (it != lib->chunks.end()) {
                     // Expand chunk to original tokens
                     const std::vector<std::string>& tokens = it->second.tokens;
                     decoded.insert(decoded.end(), tokens.begin(), tokens.end());
@@ -115,7 +135,7 @@ std::vector<std::string> Chunker::decode(const std::vector<std::string>& codes)
             decoded.push_back(code);
         }
     }
-    
+
     return decoded;
 }
 
@@ -123,31 +143,46 @@ std::vector<std::string> Chunker::decode(const std::vector<std::string>& codes)
 // CHUNK LEARNING
 //===========================================================================
 
-void Chunker::learn_chunk(const std::vector<double>& pattern_embedding,
+void Chunker::learn_chunk(const fdqc::Vec& pattern_embedding,
                           const std::vector<std::string>& tokens) {
+    // Writers are serialized; readers keep going against the current
+    // version while the next one is built.
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    std::shared_ptr<const Library> current = snapshot();
+
     // Check if similar chunk already exists
-    int existing_id = find_matching_chunk(pattern_embedding);
-    
+    int existing_id = find_matching_chunk_in(*current, pattern_embedding);
+
     if (existing_id >= 0) {
-        // Update existing chunk frequency
-        if (chunk_library_.find(existing_id) != chunk_library_.end()) {
-            chunk_library_[existing_id].frequency++;
+        // Update existing chunk frequency in place; no new version
+        // needed for an advisory counter bump.
+        auto it = current->chunks.find(existing_id);
+        if (it != current->chunks.end()) {
+            it->second.frequency.fetch_add(1, std::memory_order_relaxed);
         }
         return;
     }
-    
-    // Create new chunk
+
+    // Build the next version: clone, insert, index, prune, publish.
+    std::shared_ptr<Library> next = clone_library(*current);
+
     Chunk new_chunk(pattern_embedding, tokens);
     new_chunk.salience = 1.0;  // Initial salience
-    
-    int chunk_id = next_chunk_id_++;
-    chunk_library_[chunk_id] = new_chunk;
-    
-    stats_.total_chunks = chunk_library_.size();
-    
+
+    int chunk_id = next->next_chunk_id++;
+    next->chunks[chunk_id] = new_chunk;
+    index_chunk(*next, chunk_id, next->chunks[chunk_id]);
+
+    prune_library_if_needed(*next);
+
+    size_t total = next->chunks.size();
+    publish(std::move(next));
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.total_chunks = total;
+
     // Update capacity multiplier
-    double boost = 1.0 + fdqc_params::CHUNK_GAMMA * 
-                   chunk_library_.size() / 100.0;
+    double boost = 1.0 + fdqc_params::CHUNK_GAMMA * total / 100.0;
     stats_.capacity_multiplier = std::min(boost, fdqc_params::CHUNK_BOOST_MAX);
 }
 
@@ -155,65 +190,215 @@ void Chunker::learn_chunk(const std::vector<double>& pattern_embedding,
 // PATTERN MATCHING
 //===========================================================================
 
-int Chunker::find_matching_chunk(const std::vector<double>& pattern_embedding) const {
+int Chunker::find_matching_chunk(const fdqc::Vec& pattern_embedding) const {
+    return find_matching_chunk_in(*snapshot(), pattern_embedding);
+}
+
+int Chunker::find_matching_chunk_in(const Library& lib,
+                                    const fdqc::Vec& pattern_embedding) const {
     double best_similarity = -1.0;
     int best_chunk_id = -1;
-    
-    for (const auto& pair : chunk_library_) {
-        int chunk_id = pair.first;
-        const Chunk& chunk = pair.second;
-        
-        double similarity = cosine_similarity(pattern_embedding, chunk.pattern);
-        
-        if (similarity > best_similarity && 
-            similarity >= fdqc_params::CHUNK_SIMILARITY_THRESHOLD) {
-            best_similarity = similarity;
-            best_chunk_id = chunk_id;
+
+    // Multi-probe LSH: candidates live in the bucket for this
+    // embedding's signature or a bucket within Hamming distance 2 of
+    // it (vectors above the 0.9 similarity threshold rarely disagree
+    // with the query on more than two hyperplanes).  Each candidate
+    // is still verified with the exact cosine similarity.
+    const uint32_t sig = lsh_signature(pattern_embedding);
+
+    auto scan_bucket = [&](uint32_t probe_sig) {
+        auto it = lib.lsh_buckets.find(probe_sig);
+        if (it == lib.lsh_buckets.end()) {
+            return;
+        }
+        for (int chunk_id : it->second) {
+            auto chunk_it = lib.chunks.find(chunk_id);
+            if (chunk_it == lib.chunks.end()) {
+                continue;
+            }
+            double similarity = cosine_similarity(pattern_embedding,
+                                                  chunk_it->second.pattern);
+            if (similarity > best_similarity &&
+                similarity >= fdqc_params::CHUNK_SIMILARITY_THRESHOLD) {
+                best_similarity = similarity;
+                best_chunk_id = chunk_id;
+            }
+        }
+    };
+
+    scan_bucket(sig);
+    for (size_t a = 0; a < LSH_SIGNATURE_BITS; ++a) {
+        scan_bucket(sig ^ (1u << a));
+        for (size_t b = a + 1; b < LSH_SIGNATURE_BITS; ++b) {
+            scan_bucket(sig ^ (1u << a) ^ (1u << b));
         }
     }
-    
+
     return best_chunk_id;
 }
 
+//===========================================================================
+// VERSION CLONING
+//===========================================================================
+
+void Chunker::clone_trie(const TrieNode& src, TrieNode& dst) {
+    dst.chunk_id = src.chunk_id;
+    dst.children.reserve(src.children.size());
+    for (const auto& pair : src.children) {
+        std::unique_ptr<TrieNode>& child = dst.children[pair.first];
+        child.reset(new TrieNode());
+        clone_trie(*pair.second, *child);
+    }
+}
+
+std::shared_ptr<Chunker::Library> Chunker::clone_library(const Library& lib) {
+    auto next = std::make_shared<Library>();
+    next->chunks = lib.chunks;
+    next->lsh_buckets = lib.lsh_buckets;
+    next->next_chunk_id = lib.next_chunk_id;
+    clone_trie(lib.trie_root, next->trie_root);
+    return next;
+}
+
+//===========================================================================
+// INDEX MAINTENANCE
+//===========================================================================
+
+void Chunker::init_lsh_planes() {
+    // Deterministic seed: signatures (and therefore bucket layout)
+    // must be reproducible across runs and across Chunker instances.
+    std::mt19937 rng(0x5eed);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+
+    lsh_planes_.resize(LSH_SIGNATURE_BITS * CHUNK_EMBEDDING_DIM);
+    for (fdqc::Scalar& component : lsh_planes_) {
+        component = gauss(rng);
+    }
+}
+
+uint32_t Chunker::lsh_signature(const fdqc::Vec& embedding) const {
+    uint32_t sig = 0;
+    size_t dim = std::min(embedding.size(), CHUNK_EMBEDDING_DIM);
+
+    for (size_t bit = 0; bit < LSH_SIGNATURE_BITS; ++bit) {
+        const fdqc::Scalar* plane = &lsh_planes_[bit * CHUNK_EMBEDDING_DIM];
+        double dot = 0.0;
+        for (size_t d = 0; d < dim; ++d) {
+            dot += plane[d] * embedding[d];
+        }
+        if (dot >= 0.0) {
+            sig |= (1u << bit);
+        }
+    }
+
+    return sig;
+}
+
+void Chunker::index_chunk(Library& lib, int chunk_id, const Chunk& chunk) {
+    // LSH side: one bucket per chunk
+    lib.lsh_buckets[lsh_signature(chunk.pattern)].push_back(chunk_id);
+
+    // Trie side: one path per token sequence
+    TrieNode* node = &lib.trie_root;
+    for (const std::string& token : chunk.tokens) {
+        std::unique_ptr<TrieNode>& child = node->children[token];
+        if (!child) {
+            child.reset(new TrieNode());
+        }
+        node = child.get();
+    }
+    node->chunk_id = chunk_id;
+}
+
+void Chunker::unindex_chunk(Library& lib, int chunk_id, const Chunk& chunk) {
+    // LSH side
+    auto bucket_it = lib.lsh_buckets.find(lsh_signature(chunk.pattern));
+    if (bucket_it != lib.lsh_buckets.end()) {
+        std::vector<int>& bucket = bucket_it->second;
+        bucket.erase(std::remove(bucket.begin(), bucket.end(), chunk_id),
+                     bucket.end());
+        if (bucket.empty()) {
+            lib.lsh_buckets.erase(bucket_it);
+        }
+    }
+
+    // Trie side: unmark the terminal node.  Interior nodes are left
+    // in place; they are tiny and often shared with other chunks.
+    TrieNode* node = &lib.trie_root;
+    for (const std::string& token : chunk.tokens) {
+        auto it = node->children.find(token);
+        if (it == node->children.end()) {
+            return;
+        }
+        node = it->second.get();
+    }
+    if (node->chunk_id == chunk_id) {
+        node->chunk_id = -1;
+    }
+}
+
+int Chunker::trie_longest_match(const Library& lib,
+                                const std::vector<std::string>& tokens,
+                                size_t start, size_t& match_len) const {
+    const TrieNode* node = &lib.trie_root;
+    int best_id = -1;
+    size_t best_len = 0;
+
+    size_t max_len = std::min(size_t(4), tokens.size() - start);
+    for (size_t len = 1; len <= max_len; ++len) {
+        auto it = node->children.find(tokens[start + len - 1]);
+        if (it == node->children.end()) {
+            break;
+        }
+        node = it->second.get();
+        if (node->chunk_id >= 0 && len >= 2) {
+            best_id = node->chunk_id;
+            best_len = len;
+        }
+    }
+
+    match_len = best_len;
+    return best_id;
+}
+
 //===========================================================================
 // EMBEDDING COMPUTATION (SIMPLIFIED)
 //===========================================================================
 
-std::vector<double> Chunker::compute_embedding(
+fdqc::Vec Chunker::compute_embedding(
     const std::vector<std::string>& tokens) const {
-    
+
     // Simplified embedding: hash-based feature vector
     // In a real system, this would use learned embeddings (e.g., Word2Vec)
-    
-    constexpr size_t EMBEDDING_DIM = 64;
-    std::vector<double> embedding(EMBEDDING_DIM, 0.0);
-    
+
+    fdqc::Vec embedding(CHUNK_EMBEDDING_DIM, 0.0);
+
     // Create deterministic features from tokens
     std::hash<std::string> hasher;
-    
+
     for (size_t i = 0; i < tokens.size(); ++i) {
         size_t hash = hasher(tokens[i]);
-        
+
         // Spread hash across embedding dimensions
-        for (size_t d = 0; d < EMBEDDING_DIM; ++d) {
+        for (size_t d = 0; d < CHUNK_EMBEDDING_DIM; ++d) {
             double value = std::sin((hash + i * 1000 + d) * 0.01);
             embedding[d] += value;
         }
     }
-    
+
     // Normalize
     double norm = 0.0;
-    for (double val : embedding) {
+    for (fdqc::Scalar val : embedding) {
         norm += val * val;
     }
-    
+
     if (norm > fdqc_params::EPSILON) {
         double inv_norm = 1.0 / std::sqrt(norm);
-        for (double& val : embedding) {
+        for (fdqc::Scalar& val : embedding) {
             val *= inv_norm;
         }
     }
-    
+
     return embedding;
 }
 
@@ -222,15 +407,16 @@ std::vector<double> Chunker::compute_embedding(
 //===========================================================================
 
 void Chunker::update_stats(size_t original_length, size_t compressed_length) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     stats_.sequences_processed++;
-    
+
     // Update average compression ratio
-    double compression = (original_length > 0) 
+    double compression = (original_length > 0)
         ? static_cast<double>(compressed_length) / original_length
         : 1.0;
-    
+
     double alpha = 0.9;  // Exponential moving average
-    stats_.average_compression = alpha * stats_.average_compression + 
+    stats_.average_compression = alpha * stats_.average_compression +
                                 (1.0 - alpha) * compression;
 }
 
@@ -238,33 +424,32 @@ void Chunker::update_stats(size_t original_length, size_t compressed_length) {
 // LIBRARY PRUNING
 //===========================================================================
 
-void Chunker::prune_library_if_needed() {
-    if (chunk_library_.size() <= fdqc_params::MAX_CHUNK_LIBRARY_SIZE) {
+void Chunker::prune_library_if_needed(Library& lib) {
+    if (lib.chunks.size() <= fdqc_params::MAX_CHUNK_LIBRARY_SIZE) {
         return;
     }
-    
+
     // Find least frequently used chunks
     std::vector<std::pair<int, size_t>> chunk_frequencies;
-    for (const auto& pair : chunk_library_) {
-        chunk_frequencies.push_back({pair.first, pair.second.frequency});
+    for (const auto& pair : lib.chunks) {
+        chunk_frequencies.push_back(
+            {pair.first,
+             pair.second.frequency.load(std::memory_order_relaxed)});
     }
-    
+
     // Sort by frequency (ascending)
     std::sort(chunk_frequencies.begin(), chunk_frequencies.end(),
               [](const auto& a, const auto& b) { return a.second < b.second; });
-    
+
     // Remove bottom 10%
-    size_t num_to_remove = chunk_library_.size() / 10;
+    size_t num_to_remove = lib.chunks.size() / 10;
     for (size_t i = 0; i < num_to_remove && i < chunk_frequencies.size(); ++i) {
-        chunk_library_.erase(chunk_frequencies[i].first);
+        auto it = lib.chunks.find(chunk_frequencies[i].first);
+        if (it != lib.chunks.end()) {
+            unindex_chunk(lib, it->first, it->second);
+            lib.chunks.erase(it);
+        }
     }
-    
-    stats_.total_chunks = chunk_library_.size();
-    
-    // Recalculate capacity multiplier
-    double boost = 1.0 + fdqc_params::CHUNK_GAMMA * 
-                   chunk_library_.size() / 100.0;
-    stats_.capacity_multiplier = std::min(boost, fdqc_params::CHUNK_BOOST_MAX);
 }
 
 } // namespace chunking
@@ -9,10 +9,12 @@
 // - 10 Hz collapse loop monitoring
 
 #include "collapse.h"
+#include "simd_kernels.h"
 #include <random>
 #include <cmath>
 #include <numeric>
 #include <algorithm>
+#include <thread>
 
 namespace collapse {
 
@@ -21,16 +23,10 @@ namespace collapse {
 //===========================================================================
 
 double CollapseLoop::calculate_entropy(const std::vector<double>& probabilities) {
-    double entropy = 0.0;
-    
-    for (double p : probabilities) {
-        if (p > fdqc_params::MIN_PROBABILITY) {
-            // S = -Σᵢ pᵢ·log₂(pᵢ)
-            entropy -= p * std::log2(p);
-        }
-    }
-    
-    return entropy;
+    // S = -Σᵢ pᵢ·log₂(pᵢ), vectorized (entries below MIN_PROBABILITY
+    // contribute nothing, matching the old scalar loop).
+    return simd::entropy_f64(probabilities.data(), probabilities.size(),
+                             fdqc_params::MIN_PROBABILITY);
 }
 
 //===========================================================================
@@ -50,36 +46,30 @@ double CollapseLoop::sample_gumbel() {
     return -std::log(-std::log(u));
 }
 
-std::vector<double> CollapseLoop::softmax(const std::vector<double>& logits,
-                                          double temperature) {
+void CollapseLoop::softmax_into(const std::vector<double>& logits,
+                                double temperature, std::vector<double>& out) {
+    out.resize(logits.size());
     if (logits.empty()) {
-        return {};
+        return;
     }
-    
-    // Compute max for numerical stability
-    double max_logit = *std::max_element(logits.begin(), logits.end());
-    
-    // Compute exp((logit - max) / temperature)
-    std::vector<double> exp_values(logits.size());
-    double sum = 0.0;
-    
-    for (size_t i = 0; i < logits.size(); ++i) {
-        exp_values[i] = std::exp((logits[i] - max_logit) / temperature);
-        sum += exp_values[i];
-    }
-    
+
+    // Max for numerical stability, then exp((logit - max) / temperature)
+    // in one vectorized pass that also accumulates the sum
+    double max_logit = simd::max_f64(logits.data(), logits.size());
+    double sum = simd::softmax_exp_f64(logits.data(), logits.size(),
+                                       max_logit, 1.0 / temperature, out.data());
+
     // Normalize
     if (sum > fdqc_params::EPSILON) {
-        for (double& val : exp_values) {
-            val /= sum;
+        double inv_sum = 1.0 / sum;
+        for (double& val : out) {
+            val *= inv_sum;
         }
     } else {
         // Uniform distribution if sum is too small
         double uniform_val = 1.0 / logits.size();
-        std::fill(exp_values.begin(), exp_values.end(), uniform_val);
+        std::fill(out.begin(), out.end(), uniform_val);
     }
-    
-    return exp_values;
 }
 
 CollapsedState CollapseLoop::gumbel_softmax_collapse(
@@ -95,14 +85,15 @@ CollapsedState CollapseLoop::gumbel_softmax_collapse(
         return state;
     }
     
-    // Add Gumbel noise to each logit
-    std::vector<double> gumbel_logits(logits.size());
+    // Add Gumbel noise to each logit (scratch buffer reused across
+    // cycles so the hot loop performs no allocation)
+    scratch_.resize(logits.size());
     for (size_t i = 0; i < logits.size(); ++i) {
-        gumbel_logits[i] = logits[i] + sample_gumbel();
+        scratch_[i] = logits[i] + sample_gumbel();
     }
-    
+
     // Apply softmax with temperature
-    state.weights = softmax(gumbel_logits, temperature);
+    softmax_into(scratch_, temperature, state.weights);
     
     // Select index with maximum weight (hard selection)
     state.selected_index = std::distance(
@@ -200,6 +191,96 @@ CollapsedState CollapseLoop::process_cycle(
     return state;
 }
 
+//===========================================================================
+// BATCH COLLAPSE
+//===========================================================================
+
+std::vector<CollapsedState> CollapseLoop::process_cycle_batch(
+    const std::vector<double>& rows, size_t row_dim, bool force_collapse) {
+
+    std::vector<CollapsedState> states;
+    if (row_dim == 0 || rows.size() < row_dim) {
+        return states;
+    }
+    const size_t n_rows = rows.size() / row_dim;
+    states.resize(n_rows);
+
+    const double threshold = entropy_threshold_;
+    const double max_ent = std::log2(static_cast<double>(row_dim));
+
+    // Same per-row logic as process_cycle(), but reading straight out
+    // of the matrix instead of copying each row into a vector first.
+    auto process_rows = [&](size_t begin, size_t end,
+                            double& entropy_sum, size_t& collapsed) {
+        for (size_t r = begin; r < end; ++r) {
+            const double* p = rows.data() + r * row_dim;
+            CollapsedState& state = states[r];
+
+            double entropy = simd::entropy_f64(p, row_dim,
+                                               fdqc_params::MIN_PROBABILITY);
+            entropy_sum += entropy;
+
+            size_t max_idx = 0;
+            double max_val = p[0];
+            for (size_t i = 1; i < row_dim; ++i) {
+                if (p[i] > max_val) {
+                    max_val = p[i];
+                    max_idx = i;
+                }
+            }
+            state.selected_index = max_idx;
+            state.entropy = entropy;
+
+            if (force_collapse || entropy < threshold) {
+                // Winner-take-all: one-hot weights
+                state.weights.assign(row_dim, 0.0);
+                state.weights[max_idx] = 1.0;
+                state.confidence = max_val;
+                ++collapsed;
+            } else {
+                // Distributed state maintained
+                state.weights.assign(p, p + row_dim);
+                state.confidence = (max_ent > fdqc_params::EPSILON)
+                    ? 1.0 - entropy / max_ent
+                    : 1.0;
+            }
+        }
+    };
+
+    // Parallelize across rows once the batch is big enough to pay for
+    // thread startup; rows are independent, so a plain chunked split
+    // with per-thread partial sums suffices.
+    size_t n_threads = std::thread::hardware_concurrency();
+    if (n_threads == 0) n_threads = 1;
+    n_threads = std::min(n_threads, n_rows / 256);
+
+    double total_entropy = 0.0;
+    size_t total_collapsed = 0;
+    if (n_threads <= 1) {
+        process_rows(0, n_rows, total_entropy, total_collapsed);
+    } else {
+        std::vector<std::thread> threads;
+        std::vector<double> entropy_parts(n_threads, 0.0);
+        std::vector<size_t> collapsed_parts(n_threads, 0);
+        const size_t chunk = (n_rows + n_threads - 1) / n_threads;
+        for (size_t t = 0; t < n_threads; ++t) {
+            size_t begin = t * chunk;
+            size_t end = std::min(begin + chunk, n_rows);
+            threads.emplace_back(process_rows, begin, end,
+                                 std::ref(entropy_parts[t]),
+                                 std::ref(collapsed_parts[t]));
+        }
+        for (size_t t = 0; t < n_threads; ++t) {
+            threads[t].join();
+            total_entropy += entropy_parts[t];
+            total_collapsed += collapsed_parts[t];
+        }
+    }
+
+    update_stats_batch(total_entropy / n_rows, n_rows, total_collapsed);
+    return states;
+}
+
 //===========================================================================
 // STATISTICS UPDATE
 //===========================================================================
@@ -237,4 +318,36 @@ void CollapseLoop::update_stats(double entropy, bool collapsed) {
     }
 }
 
+void CollapseLoop::update_stats_batch(double mean_entropy, size_t rows,
+                                      size_t collapsed) {
+    if (rows == 0) return;
+
+    bool first = (stats_.total_updates == 0);
+    stats_.total_updates += rows;
+    stats_.total_collapses += collapsed;
+
+    // One EMA step per batch, fed the batch mean
+    double alpha = 0.9;
+    if (first) {
+        stats_.average_entropy = mean_entropy;
+    } else {
+        stats_.average_entropy = alpha * stats_.average_entropy +
+                                 (1.0 - alpha) * mean_entropy;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - stats_.last_update).count();
+
+    if (elapsed > 0) {
+        double instant_rate = collapsed ? (collapsed * 1000.0 / elapsed) : 0.0;
+        stats_.collapse_rate = alpha * stats_.collapse_rate +
+                               (1.0 - alpha) * instant_rate;
+    }
+
+    if (collapsed > 0) {
+        stats_.last_update = now;
+    }
+}
+
 } // namespace collapse
@@ -6,41 +6,612 @@
 // importance-based consolidation, and capacity management.
 
 #include "episodic_memory.h"
+#include "simd_kernels.h"
 #include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <numeric>
+#include <queue>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace episodic_memory {
 
+//===========================================================================
+// HNSW INDEX
+//===========================================================================
+
+HnswIndex::HnswIndex(size_t M, size_t ef_construction)
+    : M_(M), ef_construction_(ef_construction),
+      level_mult_(1.0 / std::log(static_cast<double>(M))) {}
+
+void HnswIndex::clear() {
+    dim_ = 0;
+    data_.clear();
+    ids_.clear();
+    nodes_.clear();
+    max_level_ = -1;
+    entry_point_ = 0;
+}
+
+std::vector<float> HnswIndex::normalize(const fdqc::Vec& v) const {
+    double norm = 0.0;
+    for (double x : v) norm += x * x;
+    if (norm < fdqc_params::EPSILON) {
+        return {};
+    }
+    double inv = 1.0 / std::sqrt(norm);
+    std::vector<float> out(v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+        out[i] = static_cast<float>(v[i] * inv);
+    }
+    return out;
+}
+
+float HnswIndex::distance(const float* query, uint32_t node) const {
+    const float* vec = data_.data() + static_cast<size_t>(node) * dim_;
+    return 1.0f - simd::dot_f32(query, vec, dim_);
+}
+
+std::vector<std::pair<float, uint32_t>> HnswIndex::search_layer(
+    const float* query, uint32_t entry, size_t ef, int layer) const {
+    // Min-heap of candidates to expand; max-heap of current best ef.
+    using Entry = std::pair<float, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> candidates;
+    std::priority_queue<Entry> best;
+    std::vector<uint8_t> visited(nodes_.size(), 0);
+
+    float d0 = distance(query, entry);
+    candidates.emplace(d0, entry);
+    best.emplace(d0, entry);
+    visited[entry] = 1;
+
+    while (!candidates.empty()) {
+        auto [dist, node] = candidates.top();
+        if (dist > best.top().first && best.size() >= ef) {
+            break;
+        }
+        candidates.pop();
+        const auto& layer_neighbors = nodes_[node].neighbors;
+        if (layer >= static_cast<int>(layer_neighbors.size())) continue;
+        for (uint32_t next : layer_neighbors[layer]) {
+            if (visited[next]) continue;
+            visited[next] = 1;
+            float d = distance(query, next);
+            if (best.size() < ef || d < best.top().first) {
+                candidates.emplace(d, next);
+                best.emplace(d, next);
+                if (best.size() > ef) {
+                    best.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Entry> result;
+    result.reserve(best.size());
+    while (!best.empty()) {
+        result.push_back(best.top());
+        best.pop();
+    }
+    std::reverse(result.begin(), result.end()); // best first
+    return result;
+}
+
+bool HnswIndex::add(const fdqc::Vec& embedding, size_t id) {
+    if (dim_ == 0) {
+        dim_ = embedding.size();
+    }
+    if (embedding.size() != dim_ || dim_ == 0) {
+        return false;
+    }
+    std::vector<float> vec = normalize(embedding);
+    if (vec.empty()) {
+        // Zero vector: index it at the origin so ids_ stays aligned.
+        vec.assign(dim_, 0.0f);
+    }
+
+    uint32_t node_id = static_cast<uint32_t>(nodes_.size());
+    data_.insert(data_.end(), vec.begin(), vec.end());
+    ids_.push_back(id);
+
+    // Sample the node's top layer from an exponential distribution.
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    double r = unif(rng_);
+    if (r < 1e-12) r = 1e-12;
+    int level = static_cast<int>(-std::log(r) * level_mult_);
+
+    Node node;
+    node.level = level;
+    node.neighbors.resize(level + 1);
+    nodes_.push_back(std::move(node));
+
+    if (max_level_ < 0) {
+        // First node becomes the entry point.
+        max_level_ = level;
+        entry_point_ = node_id;
+        return true;
+    }
+
+    const float* query = data_.data() + static_cast<size_t>(node_id) * dim_;
+    uint32_t entry = entry_point_;
+
+    // Greedy descent through layers above the node's level.
+    for (int layer = max_level_; layer > level; --layer) {
+        bool improved = true;
+        float best_dist = distance(query, entry);
+        while (improved) {
+            improved = false;
+            const auto& layer_neighbors = nodes_[entry].neighbors;
+            if (layer >= static_cast<int>(layer_neighbors.size())) break;
+            for (uint32_t next : layer_neighbors[layer]) {
+                float d = distance(query, next);
+                if (d < best_dist) {
+                    best_dist = d;
+                    entry = next;
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    // Connect on each layer from min(level, max_level_) down to 0.
+    for (int layer = std::min(level, max_level_); layer >= 0; --layer) {
+        auto found = search_layer(query, entry, ef_construction_, layer);
+        size_t max_links = (layer == 0) ? M_ * 2 : M_;
+        size_t n_links = std::min(max_links, found.size());
+        auto& my_neighbors = nodes_[node_id].neighbors[layer];
+        for (size_t i = 0; i < n_links; ++i) {
+            uint32_t peer = found[i].second;
+            if (peer == node_id) continue;
+            my_neighbors.push_back(peer);
+            // Bidirectional link; trim the peer's list if it overflows.
+            auto& peer_neighbors = nodes_[peer].neighbors[layer];
+            peer_neighbors.push_back(node_id);
+            if (peer_neighbors.size() > max_links) {
+                const float* peer_vec = data_.data() + static_cast<size_t>(peer) * dim_;
+                std::sort(peer_neighbors.begin(), peer_neighbors.end(),
+                          [&](uint32_t a, uint32_t b) {
+                              return distance(peer_vec, a) < distance(peer_vec, b);
+                          });
+                peer_neighbors.resize(max_links);
+            }
+        }
+        if (!found.empty()) {
+            entry = found.front().second;
+        }
+    }
+
+    if (level > max_level_) {
+        max_level_ = level;
+        entry_point_ = node_id;
+    }
+    return true;
+}
+
+std::vector<size_t> HnswIndex::search(const fdqc::Vec& query,
+                                      size_t k, size_t ef) const {
+    if (nodes_.empty() || query.size() != dim_) {
+        return {};
+    }
+    std::vector<float> q = normalize(query);
+    if (q.empty()) {
+        q.assign(dim_, 0.0f);
+    }
+
+    uint32_t entry = entry_point_;
+    for (int layer = max_level_; layer > 0; --layer) {
+        bool improved = true;
+        float best_dist = distance(q.data(), entry);
+        while (improved) {
+            improved = false;
+            const auto& layer_neighbors = nodes_[entry].neighbors;
+            if (layer >= static_cast<int>(layer_neighbors.size())) break;
+            for (uint32_t next : layer_neighbors[layer]) {
+                float d = distance(q.data(), next);
+                if (d < best_dist) {
+                    best_dist = d;
+                    entry = next;
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    auto found = search_layer(q.data(), entry, std::max(ef, k), 0);
+    std::vector<size_t> result;
+    result.reserve(std::min(k, found.size()));
+    for (size_t i = 0; i < found.size() && result.size() < k; ++i) {
+        result.push_back(ids_[found[i].second]);
+    }
+    return result;
+}
+
+//===========================================================================
+// MEMORY-MAPPED PERSISTENCE
+//===========================================================================
+//
+// Store layout (little-endian, fixed-size records so the file can be
+// mapped and appended in place):
+//
+//   [PersistHeader]                       (padded to 4096 bytes)
+//   [capacity * dim float32 embeddings]
+//   [capacity * PersistRecord]
+//
+// The file is sized for MAX_EPISODIC_MEMORIES up front; `count` in the
+// header tracks how many slots are live.  Appends fill the next slot
+// and bump the count, so a crash at worst loses the episode being
+// written.  Pruning rewrites the live slots and shrinks the count.
+
+namespace {
+
+constexpr char PERSIST_MAGIC[8] = {'F','D','Q','C','M','E','M','1'};
+constexpr size_t PERSIST_HEADER_BYTES = 4096;
+
+struct PersistHeader {
+    char magic[8];
+    uint32_t dim;
+    uint32_t capacity;
+    uint64_t count;
+};
+
+struct PersistRecord {
+    double importance;
+    double affective_valence;
+    int64_t timestamp_ms;       // wall-clock epoch ms at encoding
+    uint32_t retrieval_count;
+    uint32_t meta_len;
+    char metadata[EPISODE_META_BYTES];
+};
+
+size_t store_size(size_t dim, size_t capacity) {
+    return PERSIST_HEADER_BYTES +
+           capacity * dim * sizeof(float) +
+           capacity * sizeof(PersistRecord);
+}
+
+// Convert a stored wall-clock timestamp back into the steady clock
+// used in memory, preserving relative age across restarts.
+std::chrono::steady_clock::time_point to_steady(int64_t epoch_ms) {
+    auto now_sys = std::chrono::system_clock::now();
+    auto now_steady = std::chrono::steady_clock::now();
+    auto age = now_sys.time_since_epoch() - std::chrono::milliseconds(epoch_ms);
+    return now_steady - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+}
+
+int64_t to_epoch_ms(std::chrono::steady_clock::time_point tp) {
+    auto now_sys = std::chrono::system_clock::now();
+    auto now_steady = std::chrono::steady_clock::now();
+    auto sys_tp = now_sys - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        now_steady - tp);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        sys_tp.time_since_epoch()).count();
+}
+
+} // namespace
+
+EpisodicMemory::~EpisodicMemory() {
+    // Drop tombstoned slots and fold any decay epochs not yet
+    // reflected in the persisted importance values, so a reload
+    // resumes from the pruned, decayed state.
+    if (persist_base_) {
+        if (!free_slots_.empty()) {
+            compact();  // rewrites the store
+        } else if (decay_epochs_ != persisted_epoch_) {
+            rewrite_store();
+        }
+    }
+    close_store();
+}
+
+bool EpisodicMemory::set_persistence(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_store();
+    persist_path_ = path;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec) || ec) {
+        // Created lazily once the embedding dimension is known.
+        return true;
+    }
+    if (!load_store()) {
+        persist_path_.clear();
+        return false;
+    }
+    return true;
+}
+
+bool EpisodicMemory::create_store() {
+    if (dim_ == 0 || persist_path_.empty()) return false;
+
+    std::filesystem::path p{persist_path_};
+    if (p.has_parent_path()) {
+        std::error_code ec;
+        std::filesystem::create_directories(p.parent_path(), ec);
+    }
+    int fd = ::open(persist_path_.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0640);
+    if (fd < 0) return false;
+
+    size_t total = store_size(dim_, fdqc_params::MAX_EPISODIC_MEMORIES);
+    if (::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    auto* header = static_cast<PersistHeader*>(base);
+    std::memcpy(header->magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC));
+    header->dim = static_cast<uint32_t>(dim_);
+    header->capacity = static_cast<uint32_t>(fdqc_params::MAX_EPISODIC_MEMORIES);
+    header->count = 0;
+
+    persist_fd_ = fd;
+    persist_base_ = base;
+    persist_size_ = total;
+    return true;
+}
+
+bool EpisodicMemory::load_store() {
+    int fd = ::open(persist_path_.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < PERSIST_HEADER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    size_t total = static_cast<size_t>(st.st_size);
+    void* base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    auto* header = static_cast<PersistHeader*>(base);
+    if (std::memcmp(header->magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC)) != 0 ||
+        header->dim == 0 || header->count > header->capacity ||
+        total < store_size(header->dim, header->capacity)) {
+        ::munmap(base, total);
+        ::close(fd);
+        return false;
+    }
+
+    persist_fd_ = fd;
+    persist_base_ = base;
+    persist_size_ = total;
+
+    // Bulk-load: one memcpy for the embedding block, one pass for the
+    // fixed-size records.
+    dim_ = header->dim;
+    size_t count = header->count;
+    const float* embeddings = reinterpret_cast<const float*>(
+        static_cast<char*>(base) + PERSIST_HEADER_BYTES);
+    const auto* records = reinterpret_cast<const PersistRecord*>(
+        static_cast<char*>(base) + PERSIST_HEADER_BYTES +
+        static_cast<size_t>(header->capacity) * dim_ * sizeof(float));
+
+    matrix_.assign(embeddings, embeddings + count * dim_);
+    norms_.resize(count);
+    meta_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        norms_[i] = std::sqrt(simd::norm_sq_f32(matrix_.data() + i * dim_, dim_));
+        const PersistRecord& rec = records[i];
+        size_t len = std::min<size_t>(rec.meta_len, EPISODE_META_BYTES);
+        meta_[i].metadata.assign(rec.metadata, len);
+        meta_[i].importance = rec.importance;
+        meta_[i].affective_valence = rec.affective_valence;
+        meta_[i].timestamp = to_steady(rec.timestamp_ms);
+        meta_[i].retrieval_count = rec.retrieval_count;
+        meta_[i].decay_epoch = decay_epochs_;
+        meta_[i].id = next_id_++;
+        meta_[i].alive = true;
+        id_to_slot_[meta_[i].id] = i;
+        evict_heap_.emplace(meta_[i].importance, meta_[i].id);
+    }
+    live_count_ = count;
+    stats_.total_episodes = count;
+
+    rebuild_index();
+    return true;
+}
+
+void EpisodicMemory::append_to_store(size_t index) {
+    if (!persist_base_ && !create_store()) {
+        return;
+    }
+    auto* header = static_cast<PersistHeader*>(persist_base_);
+    if (index >= header->capacity || dim_ != header->dim) {
+        return; // store full or incompatible: skip persistence
+    }
+
+    char* base = static_cast<char*>(persist_base_);
+    float* embeddings = reinterpret_cast<float*>(base + PERSIST_HEADER_BYTES);
+    auto* records = reinterpret_cast<PersistRecord*>(
+        base + PERSIST_HEADER_BYTES +
+        static_cast<size_t>(header->capacity) * dim_ * sizeof(float));
+
+    std::memcpy(embeddings + index * dim_, matrix_.data() + index * dim_,
+                dim_ * sizeof(float));
+
+    PersistRecord& rec = records[index];
+    const EpisodeMeta& meta = meta_[index];
+    // Persist the decayed value: on reload it becomes the new base
+    // importance (with the episode's decay epoch reset).
+    rec.importance = effective_importance(index);
+    rec.affective_valence = meta.affective_valence;
+    rec.timestamp_ms = to_epoch_ms(meta.timestamp);
+    rec.retrieval_count = static_cast<uint32_t>(meta.retrieval_count);
+    rec.meta_len = static_cast<uint32_t>(
+        std::min(meta.metadata.size(), EPISODE_META_BYTES));
+    std::memcpy(rec.metadata, meta.metadata.data(), rec.meta_len);
+
+    // Publish the slot only after its contents are written.  Reused
+    // tombstone slots rewrite in place below the high-water mark.
+    header->count = std::max<uint64_t>(header->count,
+                                       static_cast<uint64_t>(index) + 1);
+}
+
+void EpisodicMemory::rewrite_store() {
+    if (!persist_base_) return;
+    auto* header = static_cast<PersistHeader*>(persist_base_);
+    header->count = 0;
+    for (size_t i = 0; i < meta_.size(); ++i) {
+        append_to_store(i);
+    }
+    persisted_epoch_ = decay_epochs_;
+}
+
+void EpisodicMemory::close_store() {
+    if (persist_base_) {
+        ::msync(persist_base_, persist_size_, MS_ASYNC);
+        ::munmap(persist_base_, persist_size_);
+        persist_base_ = nullptr;
+        persist_size_ = 0;
+    }
+    if (persist_fd_ >= 0) {
+        ::close(persist_fd_);
+        persist_fd_ = -1;
+    }
+}
+
+void EpisodicMemory::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dim_ = 0;
+    matrix_.clear();
+    norms_.clear();
+    meta_.clear();
+    index_.clear();
+    free_slots_.clear();
+    id_to_slot_.clear();
+    evict_heap_ = {};
+    live_count_ = 0;
+    dead_in_index_ = 0;
+    stats_ = MemoryStats();
+    if (persist_base_) {
+        static_cast<PersistHeader*>(persist_base_)->count = 0;
+    }
+}
+
 //===========================================================================
 // RECORDING
 //===========================================================================
 
-void EpisodicMemory::record(const std::vector<double>& embedding,
+std::vector<float> EpisodicMemory::to_row(const fdqc::Vec& vec) const {
+    std::vector<float> row(dim_, 0.0f);
+    size_t n = std::min(dim_, vec.size());
+    for (size_t i = 0; i < n; ++i) {
+        row[i] = static_cast<float>(vec[i]);
+    }
+    return row;
+}
+
+Episode EpisodicMemory::materialize(size_t index) const {
+    Episode episode;
+    const float* row = matrix_.data() + index * dim_;
+    episode.embedding.assign(row, row + dim_);
+    episode.metadata = meta_[index].metadata;
+    episode.importance = effective_importance(index);
+    episode.affective_valence = meta_[index].affective_valence;
+    episode.timestamp = meta_[index].timestamp;
+    episode.retrieval_count = meta_[index].retrieval_count;
+    return episode;
+}
+
+double EpisodicMemory::effective_importance(size_t index) const {
+    const EpisodeMeta& meta = meta_[index];
+    uint64_t elapsed = decay_epochs_ - meta.decay_epoch;
+    if (elapsed == 0) {
+        return meta.importance;
+    }
+    return meta.importance * std::pow(1.0 - fdqc_params::MEMORY_DECAY_RATE,
+                                      static_cast<double>(elapsed));
+}
+
+double EpisodicMemory::row_similarity(const float* query, float query_norm,
+                                      size_t index) const {
+    float row_norm = norms_[index];
+    if (query_norm < fdqc_params::EPSILON || row_norm < fdqc_params::EPSILON) {
+        return 0.0;
+    }
+    float dot = simd::dot_f32(query, matrix_.data() + index * dim_, dim_);
+    return static_cast<double>(dot / (query_norm * row_norm));
+}
+
+void EpisodicMemory::record(const fdqc::Vec& embedding,
                             const std::string& metadata,
                             double importance,
                             double affective_valence) {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Create new episode
-    Episode episode(embedding, metadata, importance, affective_valence);
-    
-    // Add to memory store
-    episodes_.push_back(episode);
-    
+
+    // First record fixes the embedding dimension of the store
+    if (dim_ == 0) {
+        dim_ = embedding.size();
+        matrix_.reserve(fdqc_params::MAX_EPISODIC_MEMORIES * dim_);
+    }
+
+    EpisodeMeta meta;
+    meta.metadata = metadata;
+    meta.importance = importance;
+    meta.affective_valence = affective_valence;
+    meta.timestamp = std::chrono::steady_clock::now();
+    meta.retrieval_count = 0;
+    meta.decay_epoch = decay_epochs_;
+    meta.id = next_id_++;
+    meta.alive = true;
+
+    // Reuse a tombstoned slot when one is free; otherwise append.
+    std::vector<float> row = to_row(embedding);
+    size_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        std::copy(row.begin(), row.end(), matrix_.begin() + slot * dim_);
+        norms_[slot] = std::sqrt(simd::norm_sq_f32(row.data(), dim_));
+        meta_[slot] = std::move(meta);
+    } else {
+        slot = meta_.size();
+        matrix_.insert(matrix_.end(), row.begin(), row.end());
+        norms_.push_back(std::sqrt(simd::norm_sq_f32(row.data(), dim_)));
+        meta_.push_back(std::move(meta));
+    }
+    id_to_slot_[meta_[slot].id] = slot;
+    ++live_count_;
+
+    // Seed the eviction heap: at encoding the pruning score is exactly
+    // the importance (no retrievals yet, zero age penalty).
+    evict_heap_.emplace(importance, meta_[slot].id);
+
+    // Maintain the ANN index incrementally (keyed by stable id)
+    index_.add(embedding, meta_[slot].id);
+
+    // Append to the mapped on-disk store if persistence is enabled
+    if (!persist_path_.empty()) {
+        append_to_store(slot);
+    }
+
     // Update statistics
     update_stats(importance);
-    
+
     // Prune if over capacity
-    if (episodes_.size() > fdqc_params::MAX_EPISODIC_MEMORIES) {
+    if (live_count_ > fdqc_params::MAX_EPISODIC_MEMORIES) {
         prune_if_needed();
     }
 }
 
 void EpisodicMemory::record(const std::vector<float>& embedding,
                             const std::string& metadata) {
-    // Convert float to double and use default importance
-    std::vector<double> double_embedding = float_to_double(embedding);
-    record(double_embedding, metadata, 0.5, 0.0);
+    // Forward to the scalar API with default importance (a straight
+    // copy when fdqc::Scalar is float)
+    fdqc::Vec scalar_embedding(embedding.begin(), embedding.end());
+    record(scalar_embedding, metadata, 0.5, 0.0);
 }
 
 //===========================================================================
@@ -48,34 +619,75 @@ void EpisodicMemory::record(const std::vector<float>& embedding,
 //===========================================================================
 
 std::vector<RetrievalResult> EpisodicMemory::retrieve(
-    const std::vector<double>& query_embedding,
+    const fdqc::Vec& query_embedding,
     size_t k) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (episodes_.empty()) {
+
+    if (live_count_ == 0) {
         return {};
     }
-    
-    // Compute similarity for all episodes
-    std::vector<RetrievalResult> all_results;
-    all_results.reserve(episodes_.size());
-    
-    for (size_t i = 0; i < episodes_.size(); ++i) {
-        double similarity = cosine_similarity(query_embedding, 
-                                             episodes_[i].embedding);
-        
-        all_results.emplace_back(episodes_[i], similarity, i);
+
+    std::vector<float> query = to_row(query_embedding);
+    float query_norm = std::sqrt(simd::norm_sq_f32(query.data(), dim_));
+
+    std::vector<RetrievalResult> top_k;
+
+    // Prefer the ANN index: sublinear candidate generation, then exact
+    // cosine re-ranking of the small candidate set.  Falls back to a
+    // batch scan of the matrix when the index cannot serve the query.
+    // Tombstoned episodes are soft-deleted: their nodes stay in the
+    // graph until compaction, so ask for extra candidates and skip
+    // the dead ones.
+    if (index_.size() >= live_count_ && live_count_ > 0 &&
+        query_embedding.size() == index_.dim()) {
+        size_t want = std::min(k + dead_in_index_, index_.size());
+        size_t ef = std::max<size_t>(fdqc_params::HNSW_EF_SEARCH, want * 4);
+        std::vector<size_t> candidates = index_.search(query_embedding, want, ef);
+        top_k.reserve(candidates.size());
+        for (size_t id : candidates) {
+            auto it = id_to_slot_.find(id);
+            if (it == id_to_slot_.end()) continue;  // tombstoned
+            size_t slot = it->second;
+            double similarity = row_similarity(query.data(), query_norm, slot);
+            top_k.emplace_back(materialize(slot), similarity, id);
+        }
+        std::sort(top_k.begin(), top_k.end());
+        if (top_k.size() > k) {
+            top_k.resize(k);
+        }
+    }
+
+    if (top_k.empty()) {
+        // Bandwidth-bound scan: one vectorized dot product per row of
+        // the contiguous embedding matrix (dead rows scored but
+        // filtered before ranking).
+        std::vector<float> dots(meta_.size());
+        simd::batch_dot_f32(matrix_.data(), query.data(), meta_.size(), dim_,
+                            dots.data());
+
+        std::vector<std::pair<double, size_t>> scored;
+        scored.reserve(live_count_);
+        for (size_t i = 0; i < meta_.size(); ++i) {
+            if (!meta_[i].alive) continue;
+            double similarity = 0.0;
+            if (query_norm >= fdqc_params::EPSILON &&
+                norms_[i] >= fdqc_params::EPSILON) {
+                similarity = static_cast<double>(dots[i] / (query_norm * norms_[i]));
+            }
+            scored.emplace_back(-similarity, i); // negate for ascending sort
+        }
+        std::partial_sort(scored.begin(),
+                          scored.begin() + std::min(k, scored.size()),
+                          scored.end());
+
+        size_t result_count = std::min(k, scored.size());
+        top_k.reserve(result_count);
+        for (size_t i = 0; i < result_count; ++i) {
+            size_t slot = scored[i].second;
+            top_k.emplace_back(materialize(slot), -scored[i].first,
+                               meta_[slot].id);
+        }
     }
-    
-    // Sort by similarity (descending)
-    std::sort(all_results.begin(), all_results.end());
-    
-    // Take top k
-    size_t result_count = std::min(k, all_results.size());
-    std::vector<RetrievalResult> top_k(
-        all_results.begin(),
-        all_results.begin() + result_count
-    );
     
     // Mark episodes as retrieved
     for (const auto& result : top_k) {
@@ -88,27 +700,31 @@ std::vector<RetrievalResult> EpisodicMemory::retrieve(
     return top_k;
 }
 
+#ifndef FDQC_SCALAR_FLOAT
 std::vector<std::pair<std::vector<float>, std::string>> EpisodicMemory::retrieve(
     const std::vector<float>& embedding,
     size_t k) const {
     
-    // Convert to double and retrieve
-    std::vector<double> double_embedding = float_to_double(embedding);
-    auto results = retrieve(double_embedding, k);
-    
-    // Convert back to old format
+    // Forward to the scalar API
+    fdqc::Vec scalar_embedding(embedding.begin(), embedding.end());
+    auto results = retrieve(scalar_embedding, k);
+
+    // Convert back to old format.  Embeddings are stored as float32,
+    // so this narrowing is lossless.
     std::vector<std::pair<std::vector<float>, std::string>> output;
     output.reserve(results.size());
-    
+
     for (const auto& result : results) {
         output.emplace_back(
-            double_to_float(result.episode.embedding),
+            std::vector<float>(result.episode.embedding.begin(),
+                               result.episode.embedding.end()),
             result.episode.metadata
         );
     }
-    
+
     return output;
 }
+#endif // FDQC_SCALAR_FLOAT
 
 //===========================================================================
 // FILTERED RETRIEVAL
@@ -118,23 +734,35 @@ std::vector<Episode> EpisodicMemory::get_important_episodes(
     double threshold) const {
     
     std::vector<Episode> result;
-    
-    for (const auto& episode : episodes_) {
-        if (episode.importance >= threshold) {
-            result.push_back(episode);
+
+    for (size_t i = 0; i < meta_.size(); ++i) {
+        if (meta_[i].alive && effective_importance(i) >= threshold) {
+            result.push_back(materialize(i));
         }
     }
-    
+
     return result;
 }
 
 std::vector<Episode> EpisodicMemory::get_recent_episodes(size_t n) const {
-    size_t start_idx = (episodes_.size() > n) ? episodes_.size() - n : 0;
-    
-    return std::vector<Episode>(
-        episodes_.begin() + start_idx,
-        episodes_.end()
-    );
+    // Slot order no longer equals insertion order once tombstoned
+    // slots are reused, so rank recency by stable id.
+    std::vector<std::pair<uint64_t, size_t>> live;
+    live.reserve(live_count_);
+    for (size_t i = 0; i < meta_.size(); ++i) {
+        if (meta_[i].alive) {
+            live.emplace_back(meta_[i].id, i);
+        }
+    }
+    std::sort(live.begin(), live.end());
+    size_t start_idx = (live.size() > n) ? live.size() - n : 0;
+
+    std::vector<Episode> result;
+    result.reserve(live.size() - start_idx);
+    for (size_t i = start_idx; i < live.size(); ++i) {
+        result.push_back(materialize(live[i].second));
+    }
+    return result;
 }
 
 //===========================================================================
@@ -142,66 +770,122 @@ std::vector<Episode> EpisodicMemory::get_recent_episodes(size_t n) const {
 //===========================================================================
 
 void EpisodicMemory::apply_decay() {
-    // Apply exponential decay to all episode importance
-    for (auto& episode : episodes_) {
-        episode.importance *= (1.0 - fdqc_params::MEMORY_DECAY_RATE);
-    }
+    // Decay is a pure function of how many decay epochs have elapsed
+    // since an episode was encoded, so a decay pass only has to bump
+    // the epoch counter: effective_importance() folds the accumulated
+    // factor in wherever importance is read (retrieval, filtering,
+    // pruning).  This removes the O(N) sweep over the store — and the
+    // full store rewrite that refreshed persisted values — from the
+    // decay path entirely; the store catches up on the next compaction
+    // or at destruction.
+    ++decay_epochs_;
 }
 
 //===========================================================================
 // MEMORY PRUNING
 //===========================================================================
 
+double EpisodicMemory::prune_score(
+    size_t slot, std::chrono::steady_clock::time_point now) const {
+    const EpisodeMeta& meta = meta_[slot];
+
+    // Age in hours
+    auto age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - meta.timestamp).count();
+    double age_hours = age_ms / 3600000.0;
+
+    // Score components: importance + retrieval_bonus - age_penalty
+    return effective_importance(slot) + meta.retrieval_count * 0.1 -
+           std::log(1.0 + age_hours) * 0.1;
+}
+
+void EpisodicMemory::tombstone(size_t slot) {
+    meta_[slot].alive = false;
+    meta_[slot].metadata.clear();
+    meta_[slot].metadata.shrink_to_fit();
+    id_to_slot_.erase(meta_[slot].id);
+    free_slots_.push_back(slot);
+    --live_count_;
+    ++dead_in_index_;
+}
+
 void EpisodicMemory::prune_if_needed() {
-    if (episodes_.size() <= fdqc_params::MAX_EPISODIC_MEMORIES) {
+    if (live_count_ <= fdqc_params::MAX_EPISODIC_MEMORIES) {
         return;
     }
-    
-    // Compute pruning score: importance + retrieval_bonus - age_penalty
-    std::vector<std::pair<double, size_t>> scores;
-    scores.reserve(episodes_.size());
-    
+
+    // Evict down to 80% of capacity (the old sweep removed the bottom
+    // 20% in one pass), popping victims off the lazy min-heap.  Heap
+    // keys are the pruning score when the entry was pushed; scores
+    // only fall over time (decay, age) except for retrieval bonuses,
+    // so a popped entry whose current score has risen past its key is
+    // stale — re-push it at the current score and keep popping.
+    size_t target = fdqc_params::MAX_EPISODIC_MEMORIES -
+                    fdqc_params::MAX_EPISODIC_MEMORIES / 5;
     auto now = std::chrono::steady_clock::now();
-    
-    for (size_t i = 0; i < episodes_.size(); ++i) {
-        const auto& episode = episodes_[i];
-        
-        // Age in hours
-        auto age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - episode.timestamp).count();
-        double age_hours = age_ms / 3600000.0;
-        
-        // Score components
-        double importance_score = episode.importance;
-        double retrieval_bonus = episode.retrieval_count * 0.1;
-        double age_penalty = std::log(1.0 + age_hours) * 0.1;
-        
-        double total_score = importance_score + retrieval_bonus - age_penalty;
-        
-        scores.emplace_back(total_score, i);
+
+    while (live_count_ > target && !evict_heap_.empty()) {
+        HeapEntry entry = evict_heap_.top();
+        evict_heap_.pop();
+        auto it = id_to_slot_.find(entry.second);
+        if (it == id_to_slot_.end()) {
+            continue;  // already tombstoned
+        }
+        size_t slot = it->second;
+        double score = prune_score(slot, now);
+        if (score > entry.first + 0.05 && !evict_heap_.empty()) {
+            evict_heap_.emplace(score, entry.second);
+            continue;
+        }
+        tombstone(slot);
     }
-    
-    // Sort by score (ascending - lowest scores first)
-    std::sort(scores.begin(), scores.end());
-    
-    // Remove bottom 20%
-    size_t num_to_remove = episodes_.size() / 5;
-    
-    // Collect indices to remove
-    std::vector<size_t> indices_to_remove;
-    for (size_t i = 0; i < num_to_remove; ++i) {
-        indices_to_remove.push_back(scores[i].second);
+
+    stats_.pruning_events++;
+
+    // Dead slots cost matrix bandwidth on scan fallback and stale
+    // candidates in the ANN index; compact once they reach a quarter
+    // of the arrays.
+    if (free_slots_.size() * 4 >= meta_.size()) {
+        compact();
     }
-    
-    // Sort indices in descending order for safe removal
-    std::sort(indices_to_remove.rbegin(), indices_to_remove.rend());
-    
-    // Remove episodes
-    for (size_t idx : indices_to_remove) {
-        episodes_.erase(episodes_.begin() + idx);
+}
+
+void EpisodicMemory::compact() {
+    size_t write = 0;
+    for (size_t read = 0; read < meta_.size(); ++read) {
+        if (!meta_[read].alive) continue;
+        if (write != read) {
+            std::copy(matrix_.begin() + read * dim_,
+                      matrix_.begin() + (read + 1) * dim_,
+                      matrix_.begin() + write * dim_);
+            norms_[write] = norms_[read];
+            meta_[write] = std::move(meta_[read]);
+        }
+        id_to_slot_[meta_[write].id] = write;
+        ++write;
+    }
+    matrix_.resize(write * dim_);
+    norms_.resize(write);
+    meta_.resize(write);
+    free_slots_.clear();
+    dead_in_index_ = 0;
+
+    // Compaction moves slots, but ids are stable: the eviction heap
+    // stays valid while the ANN index (keyed by id, yet holding dead
+    // vectors) is rebuilt over the survivors, and the on-disk store
+    // is rewritten to match.
+    rebuild_index();
+    rewrite_store();
+}
+
+void EpisodicMemory::rebuild_index() {
+    index_.clear();
+    fdqc::Vec embedding(dim_);
+    for (size_t i = 0; i < meta_.size(); ++i) {
+        const float* row = matrix_.data() + i * dim_;
+        embedding.assign(row, row + dim_);
+        index_.add(embedding, meta_[i].id);
     }
-    
-    stats_.pruning_events++;
 }
 
 //===========================================================================
@@ -209,11 +893,11 @@ void EpisodicMemory::prune_if_needed() {
 //===========================================================================
 
 void EpisodicMemory::update_stats(double importance) {
-    stats_.total_episodes = episodes_.size();
-    
+    stats_.total_episodes = meta_.size();
+
     // Update average importance (exponential moving average)
     double alpha = 0.95;
-    if (episodes_.size() == 1) {
+    if (meta_.size() == 1) {
         stats_.average_importance = importance;
     } else {
         stats_.average_importance = alpha * stats_.average_importance +
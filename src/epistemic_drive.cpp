@@ -5,7 +5,6 @@
 // Implements 5-sigma crisis detection with statistical tracking.
 
 #include "epistemic_drive.h"
-#include <numeric>
 #include <algorithm>
 
 namespace epistemic_drive {
@@ -50,34 +49,25 @@ bool EpistemicDrive::update(double prediction_error) {
 //===========================================================================
 
 void EpistemicDrive::update_statistics(double error) {
-    // Add to history
-    error_history_.push_back(error);
-    
-    // Maintain window size
-    if (error_history_.size() > fdqc_params::ERROR_HISTORY_WINDOW) {
-        error_history_.pop_front();
-    }
-    
-    // Recompute mean and std dev
-    if (error_history_.empty()) {
-        mean_ = 0.0;
-        std_dev_ = 0.0;
-        return;
-    }
-    
-    // Mean
-    mean_ = std::accumulate(error_history_.begin(), error_history_.end(), 0.0) /
-            error_history_.size();
-    
-    // Std dev
-    double variance = 0.0;
-    for (double err : error_history_) {
-        double diff = err - mean_;
-        variance += diff * diff;
+    // Exponentially weighted mean/variance, one O(1) update per
+    // observation (no stored history).  The standard coupled update:
+    //   diff  = x - mean
+    //   mean += alpha * diff
+    //   var   = (1 - alpha) * (var + alpha * diff^2)
+    // ages old errors out at a rate fixed by window_, so crisis
+    // sensitivity does not degrade as uptime grows.
+    if (samples_ == 0) {
+        mean_ = error;
+        var_ = 0.0;
+    } else {
+        double diff = error - mean_;
+        double incr = alpha_ * diff;
+        mean_ += incr;
+        var_ = (1.0 - alpha_) * (var_ + diff * incr);
     }
-    variance /= error_history_.size();
-    std_dev_ = std::sqrt(variance);
-    
+    ++samples_;
+    std_dev_ = std::sqrt(var_);
+
     // Update stats
     stats_.average_error = mean_;
     stats_.error_std_dev = std_dev_;
@@ -89,7 +79,7 @@ void EpistemicDrive::update_statistics(double error) {
 
 bool EpistemicDrive::detect_crisis(double z_score) {
     // Need sufficient history for reliable statistics
-    if (error_history_.size() < 10) {
+    if (samples_ < 10) {
         return false;
     }
     
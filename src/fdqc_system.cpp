@@ -7,42 +7,113 @@
 #include "fdqc_system.h"
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 
 namespace fdqc_system {
 
+namespace {
+
+// Cosine similarity between two embeddings (novelty / dedup helper)
+double embedding_similarity(const fdqc::Scalar* a, size_t a_len,
+                            const fdqc::Scalar* b, size_t b_len) {
+    if (a_len != b_len || a_len == 0) return 0.0;
+    double dot = 0.0, norm_a = 0.0, norm_b = 0.0;
+    for (size_t i = 0; i < a_len; ++i) {
+        dot += a[i] * b[i];
+        norm_a += a[i] * a[i];
+        norm_b += b[i] * b[i];
+    }
+    if (norm_a < fdqc_params::EPSILON || norm_b < fdqc_params::EPSILON) return 0.0;
+    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+double embedding_similarity(const fdqc::Vec& a,
+                            const fdqc::Vec& b) {
+    return embedding_similarity(a.data(), a.size(), b.data(), b.size());
+}
+
+// How many recently consolidated embeddings to keep for dedup
+constexpr size_t CONSOLIDATION_DEDUP_WINDOW = 32;
+
+} // namespace
+
 //===========================================================================
 // CHANGE EVALUATION
 //===========================================================================
 
 EvaluationResult FDQCSystem::evaluate_change(const ChangeContext& context) {
     EvaluationResult result;
-    
+
+    // Arena for this evaluation's vector data; everything allocated
+    // from it dies with the call, so nothing is individually freed
+    std::pmr::monotonic_buffer_resource arena(
+        eval_arena_buffer_.data(), eval_arena_buffer_.size());
+
     // 1. Compute change embedding
-    std::vector<double> change_embedding = compute_change_embedding(context);
-    
+    std::pmr::vector<fdqc::Scalar> change_embedding(&arena);
+    compute_change_embedding(context, change_embedding);
+
     // 2. Check preconscious buffer for similar recent changes
-    bool is_novel = !buffer_.contains_similar(change_embedding, 0.85);
+    // (compares against slot storage in place; no allocation)
+    bool is_novel = !buffer_.contains_similar(change_embedding.data(),
+                                              change_embedding.size(), 0.85);
     
     // 3. Assess explanation quality
     result.explanation_quality = assess_explanation_quality(context);
-    
+
     // 4. Compute epistemic risk
     result.epistemic_risk = compute_epistemic_risk(context);
+
+    // 5-12. Stateful cognitive stages (shared with the batch path)
+    run_cognitive_stages(context, is_novel, result);
+
+    // 13. Queue for episodic consolidation if significant.  The
+    // actual memory write (similarity index insert, persistence)
+    // happens on the consolidation thread so evaluation never stalls
+    // on it.
+    double importance = (result.epistemic_risk + std::abs(result.emotional_valence)) / 2.0;
+    if (importance > fdqc_params::CONSOLIDATION_THRESHOLD) {
+        // The queued episode must outlive the arena, so this copy to
+        // the general heap is deliberate — and only paid for the
+        // minority of changes important enough to consolidate
+        fdqc::Vec queued_embedding(change_embedding.begin(),
+                                   change_embedding.end());
+        {
+            std::lock_guard<std::mutex> lock(consolidation_mutex_);
+            pending_episodes_.push_back({std::move(queued_embedding),
+                                         context.file_path + ": " + context.intent,
+                                         importance,
+                                         result.emotional_valence});
+        }
+        consolidation_cv_.notify_one();
+    }
+
+    // 14. Add to preconscious buffer (slots copy from the raw pointer)
+    buffer_.push(change_embedding.data(), change_embedding.size(),
+                 context.file_path, importance);
     
+    episode_count_++;
+    
+    return result;
+}
+
+void FDQCSystem::run_cognitive_stages(const ChangeContext& context,
+                                      bool is_novel,
+                                      EvaluationResult& result) {
     // 5. Update affective state based on change characteristics
     double reward = (result.explanation_quality > 0.7) ? 0.5 : -0.3;
     double surprise = is_novel ? 0.8 : 0.2;
     affective_.update(reward, surprise, surprise);
-    
+
     // 6. Get emotional state
     result.emotional_valence = affective_.valence();
     result.emotional_arousal = affective_.arousal();
     result.emotional_novelty = affective_.novelty();
-    
+
     // 7. Check for epistemic crisis
     bool crisis_detected = epistemic_.update(result.epistemic_risk);
-    
+
     if (crisis_detected) {
         // Crisis mode: increase capacity, boost arousal
         vcca_.force_dimension(fdqc_params::N_WM_MAX);
@@ -53,11 +124,11 @@ EvaluationResult FDQCSystem::evaluate_change(const ChangeContext& context) {
         vcca_context.task_complexity = 0.5 + result.epistemic_risk * 0.5;
         vcca_context.cognitive_load = 0.5;
         vcca_context.affective_arousal = result.emotional_arousal;
-        
+
         int selected_n = vcca_.select_dimension(vcca_context, 0.1);
         result.recommended_wm_dimension = selected_n;
     }
-    
+
     // 8. Update meta-monitor
     meta_monitor::ProcessObservation obs;
     obs.entropy = 0.5;  // Would be computed from actual state
@@ -65,53 +136,191 @@ EvaluationResult FDQCSystem::evaluate_change(const ChangeContext& context) {
     obs.working_memory_dimension = result.recommended_wm_dimension;
     obs.affective_valence = result.emotional_valence;
     obs.affective_arousal = result.emotional_arousal;
-    obs.processing_mode = crisis_detected ? 
+    obs.processing_mode = crisis_detected ?
         fdqc_params::ProcessingMode::CRISIS :
         fdqc_params::ProcessingMode::PRESENT;
     obs.temporal_mode = fdqc_params::TemporalMode::PRESENT;
-    
+
     meta_.observe(obs);
-    
+
     // 9. Get self-awareness score
     result.self_awareness_score = meta_.evaluate_self_awareness();
-    
+
     // 10. Make recommendation
     // Allow if: explanation quality good AND not in crisis AND valence not too negative
-    result.recommend_allow = 
+    result.recommend_allow =
         (result.explanation_quality >= 0.5) &&
         (!crisis_detected || result.epistemic_risk < 0.8) &&
         (result.emotional_valence > -0.7);
-    
+
     // 11. Generate reasoning
     result.reasoning = generate_reasoning(context, result);
-    
+
     // 12. Generate phenomenal report (avoid multiple implicit state mutations)
     const auto report = meta_.generate_report();
     result.phenomenal_experience = report.textual_report;
     // If needed elsewhere, reuse `report.state` and `report.observation` without re-calling.
-    
-    // 13. Store in episodic memory if significant
-    double importance = (result.epistemic_risk + std::abs(result.emotional_valence)) / 2.0;
-    if (importance > fdqc_params::CONSOLIDATION_THRESHOLD) {
-        memory_.record(change_embedding, 
-                      context.file_path + ": " + context.intent,
-                      importance,
-                      result.emotional_valence);
+}
+
+std::vector<EvaluationResult> FDQCSystem::evaluate_changes(
+    const std::vector<ChangeContext>& contexts) {
+
+    std::vector<EvaluationResult> results(contexts.size());
+    if (contexts.empty()) {
+        return results;
+    }
+
+    // Batch embeddings live in one heap-backed arena (the member
+    // buffer only holds a single evaluation's worth) and die together
+    // when this call returns.
+    std::pmr::monotonic_buffer_resource arena(
+        contexts.size() * 64 * sizeof(fdqc::Scalar) + 256);
+    std::pmr::vector<std::pmr::vector<fdqc::Scalar>> embeddings(&arena);
+    embeddings.reserve(contexts.size());
+
+    // Stage 1: all embeddings (elements inherit the arena from the
+    // outer vector via uses-allocator construction)
+    for (const auto& context : contexts) {
+        embeddings.emplace_back();
+        compute_change_embedding(context, embeddings.back());
+    }
+
+    // Stage 2: novelty.  Replicates the view the sequential path
+    // sees — each change's embedding is pushed to the ring before
+    // the next change is evaluated — so a change is compared against
+    // the pre-batch buffer plus the BUFFER_SIZE most recent earlier
+    // batch entries (older ones would already have been evicted).
+    std::vector<bool> is_novel(contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        bool novel = (i >= fdqc_params::BUFFER_SIZE) ||
+                     !buffer_.contains_similar(embeddings[i].data(),
+                                               embeddings[i].size(), 0.85);
+        size_t lookback = (i > fdqc_params::BUFFER_SIZE)
+                              ? i - fdqc_params::BUFFER_SIZE : 0;
+        for (size_t j = lookback; novel && j < i; ++j) {
+            if (embedding_similarity(embeddings[i].data(), embeddings[i].size(),
+                                     embeddings[j].data(), embeddings[j].size())
+                    >= 0.85) {
+                novel = false;
+            }
+        }
+        is_novel[i] = novel;
+    }
+
+    // Stage 3: quality and risk (pure scoring, no module state)
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        results[i].explanation_quality = assess_explanation_quality(contexts[i]);
+        results[i].epistemic_risk = compute_epistemic_risk(contexts[i]);
+    }
+
+    // Stage 4: stateful cognitive stages, strictly in input order so
+    // affect/VCCA/meta trajectories match sequential evaluation
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        run_cognitive_stages(contexts[i], is_novel[i], results[i]);
+    }
+
+    // Stage 5: consolidation enqueue (one lock, one wakeup for the
+    // whole batch) and buffer pushes
+    std::vector<PendingEpisode> batch_episodes;
+    std::vector<double> importances(contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        importances[i] = (results[i].epistemic_risk +
+                          std::abs(results[i].emotional_valence)) / 2.0;
+        if (importances[i] > fdqc_params::CONSOLIDATION_THRESHOLD) {
+            batch_episodes.push_back(
+                {fdqc::Vec(embeddings[i].begin(), embeddings[i].end()),
+                 contexts[i].file_path + ": " + contexts[i].intent,
+                 importances[i],
+                 results[i].emotional_valence});
+        }
+    }
+    if (!batch_episodes.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(consolidation_mutex_);
+            pending_episodes_.insert(pending_episodes_.end(),
+                                     std::make_move_iterator(batch_episodes.begin()),
+                                     std::make_move_iterator(batch_episodes.end()));
+        }
+        consolidation_cv_.notify_one();
+    }
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        buffer_.push(embeddings[i].data(), embeddings[i].size(),
+                     contexts[i].file_path, importances[i]);
+    }
+
+    episode_count_ += contexts.size();
+
+    return results;
+}
+
+//===========================================================================
+// BACKGROUND CONSOLIDATION
+//===========================================================================
+
+void FDQCSystem::consolidation_loop() {
+    std::unique_lock<std::mutex> lock(consolidation_mutex_);
+    while (consolidation_running_) {
+        consolidation_cv_.wait_for(lock, std::chrono::milliseconds(100), [this] {
+            return !pending_episodes_.empty() || !consolidation_running_;
+        });
+        lock.unlock();
+        consolidate_pending();
+        lock.lock();
+    }
+}
+
+void FDQCSystem::consolidate_pending() {
+    std::vector<PendingEpisode> batch;
+    {
+        std::lock_guard<std::mutex> lock(consolidation_mutex_);
+        batch.swap(pending_episodes_);
+    }
+
+    for (auto& episode : batch) {
+        if (episode.importance <= fdqc_params::CONSOLIDATION_THRESHOLD) {
+            continue;
+        }
+
+        // Dedup against the recently consolidated window (covers both
+        // repeats within this batch and across adjacent batches)
+        bool duplicate = false;
+        {
+            std::lock_guard<std::mutex> lock(consolidation_mutex_);
+            for (const auto& recent : recent_consolidated_) {
+                if (embedding_similarity(episode.embedding, recent) >=
+                    fdqc_params::BUFFER_SIMILARITY_THRESHOLD) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) {
+                recent_consolidated_.push_back(episode.embedding);
+                if (recent_consolidated_.size() > CONSOLIDATION_DEDUP_WINDOW) {
+                    recent_consolidated_.erase(recent_consolidated_.begin());
+                }
+            }
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        memory_.record(episode.embedding, episode.metadata,
+                       episode.importance, episode.valence);
+
+        // Credit the originating buffer entry in the buffer statistics
+        auto indices = buffer_.find_similar(episode.embedding,
+                                            fdqc_params::BUFFER_SIMILARITY_THRESHOLD);
+        if (!indices.empty()) {
+            buffer_.mark_consolidated(indices.front());
+        }
     }
-    
-    // 14. Add to preconscious buffer
-    buffer_.push(change_embedding, context.file_path, importance);
-    
-    episode_count_++;
-    
-    return result;
 }
 
 //===========================================================================
 // COGNITIVE CYCLE (FOR TESTING)
 //===========================================================================
 
-void FDQCSystem::process_cycle(const std::vector<double>& stimulus) {
+void FDQCSystem::process_cycle(const fdqc::Vec& stimulus) {
     // Simplified cognitive cycle for testing
     
     // 1. Add to preconscious buffer
@@ -158,13 +367,15 @@ void FDQCSystem::process_cycle(const std::vector<double>& stimulus) {
 // HELPER: CHANGE EMBEDDING
 //===========================================================================
 
-std::vector<double> FDQCSystem::compute_change_embedding(
-    const ChangeContext& context) {
-    
+void FDQCSystem::compute_change_embedding(
+    const ChangeContext& context,
+    std::pmr::vector<fdqc::Scalar>& out) {
+
     // Simplified embedding: hash-based features
     // In production, would use learned embeddings
-    
-    std::vector<double> embedding(64, 0.0);
+
+    out.assign(64, 0.0);
+    std::pmr::vector<fdqc::Scalar>& embedding = out;
     
     // Feature 1: File path hash
     std::hash<std::string> hasher;
@@ -179,23 +390,22 @@ std::vector<double> FDQCSystem::compute_change_embedding(
     
     // Fill embedding
     for (size_t i = 0; i < embedding.size(); ++i) {
-        embedding[i] = std::sin((path_hash + i * 1000) * 0.01) * 
-                      length_ratio * intent_complexity;
+        embedding[i] = static_cast<fdqc::Scalar>(
+            std::sin((path_hash + i * 1000) * 0.01) *
+            length_ratio * intent_complexity);
     }
     
     // Normalize
     double norm = 0.0;
-    for (double val : embedding) {
-        norm += val * val;
+    for (fdqc::Scalar val : embedding) {
+        norm += static_cast<double>(val) * val;
     }
     if (norm > fdqc_params::EPSILON) {
         double inv_norm = 1.0 / std::sqrt(norm);
-        for (double& val : embedding) {
-            val *= inv_norm;
+        for (fdqc::Scalar& val : embedding) {
+            val = static_cast<fdqc::Scalar>(val * inv_norm);
         }
     }
-    
-    return embedding;
 }
 
 //===========================================================================
@@ -216,8 +426,8 @@ double FDQCSystem::assess_explanation_quality(const ChangeContext& context) {
     double length_score = std::min(1.0, context.explanation.size() / 200.0);
     quality += length_score * 0.2;
     
-    // Keyword presence
-    std::vector<std::string> good_keywords = {
+    // Keyword presence (built once, not per evaluation)
+    static const std::vector<std::string> good_keywords = {
         "because", "reason", "purpose", "change", "improve",
         "fix", "bug", "feature", "update", "refactor"
     };
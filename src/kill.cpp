@@ -1,9 +1,11 @@
 // kill.cpp
 //
 // Implementation of the kill switch API declared in kill.h.  The
-// implementation relies only on the C++ standard library and uses a
-// simple sentinel file on disk to persist the tripped state across
-// processes.
+// tripped state is persisted as a sentinel file on disk so it spans
+// processes.  Because require_alive() runs at the top of every
+// apply_change, the sentinel check is cached in an atomic that a
+// background watcher keeps fresh via inotify (with a timed fallback
+// poll), rather than stat'ing the file on every call.
 
 #include "kill.h"
 
@@ -12,6 +14,15 @@
 #include <fstream>
 #include <stdexcept>
 
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
 namespace kill {
 
 namespace {
@@ -28,6 +39,115 @@ static std::string sentinel_path() {
     return std::string("KILL_SWITCH");
 }
 
+// How long the watcher sleeps between forced re-checks.  This bounds
+// trip latency when inotify is unavailable (or the event is missed,
+// e.g. the sentinel's directory was replaced wholesale).
+constexpr int FALLBACK_POLL_MS = 500;
+
+// Cached existence of the sentinel file, maintained by the watcher
+// thread below and updated synchronously by trip()/reset() so an
+// in-process trip takes effect immediately.
+class SentinelWatcher {
+public:
+    static SentinelWatcher &instance() {
+        static SentinelWatcher watcher;
+        return watcher;
+    }
+
+    bool sentinel_present() const {
+        return present_.load(std::memory_order_relaxed);
+    }
+
+    // Re-stat the sentinel right now (used by trip()/reset() and the
+    // watcher thread).  Also re-arms the inotify watch if the sentinel
+    // path changed, e.g. when KILL_SWITCH_PATH is set after startup.
+    void refresh() {
+        std::string path = sentinel_path();
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            if (path != watched_path_) {
+                rearm_watch(path);
+            }
+        }
+        std::error_code ec;
+        present_.store(std::filesystem::exists(path, ec) && !ec,
+                       std::memory_order_relaxed);
+    }
+
+private:
+    SentinelWatcher() {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        refresh();
+        thread_ = std::thread(&SentinelWatcher::run, this);
+    }
+
+    ~SentinelWatcher() {
+        stop_.store(true);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (inotify_fd_ >= 0) {
+            ::close(inotify_fd_);
+        }
+    }
+
+    // Watch the sentinel's parent directory: the file itself usually
+    // does not exist yet, and watching the directory catches both
+    // creation (trip) and removal (reset).  Caller holds watch_mutex_.
+    void rearm_watch(const std::string &path) {
+        if (inotify_fd_ < 0) {
+            watched_path_ = path;
+            return;
+        }
+        if (watch_wd_ >= 0) {
+            inotify_rm_watch(inotify_fd_, watch_wd_);
+            watch_wd_ = -1;
+        }
+        std::filesystem::path dir = std::filesystem::path(path).parent_path();
+        if (dir.empty()) {
+            dir = ".";
+        }
+        watch_wd_ = inotify_add_watch(inotify_fd_, dir.c_str(),
+                                      IN_CREATE | IN_DELETE | IN_MOVED_TO |
+                                      IN_MOVED_FROM | IN_CLOSE_WRITE);
+        watched_path_ = path;
+    }
+
+    // Watcher loop: block on the inotify fd with a bounded timeout,
+    // then refresh the cached state.  Refreshing on every wakeup (not
+    // just matching events) keeps the logic simple and self-healing;
+    // at worst it is one stat per FALLBACK_POLL_MS.
+    void run() {
+        while (!stop_.load()) {
+            if (inotify_fd_ >= 0) {
+                struct pollfd pfd;
+                pfd.fd = inotify_fd_;
+                pfd.events = POLLIN;
+                int rc = ::poll(&pfd, 1, FALLBACK_POLL_MS);
+                if (rc > 0 && (pfd.revents & POLLIN)) {
+                    // Drain pending events; their content does not
+                    // matter, any directory activity triggers a re-stat.
+                    char buf[4096];
+                    while (::read(inotify_fd_, buf, sizeof(buf)) > 0) {
+                    }
+                }
+            } else {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(FALLBACK_POLL_MS));
+            }
+            refresh();
+        }
+    }
+
+    std::atomic<bool> present_{false};
+    std::atomic<bool> stop_{false};
+    int inotify_fd_ = -1;
+    int watch_wd_ = -1;
+    std::string watched_path_;
+    std::mutex watch_mutex_;
+    std::thread thread_;
+};
+
 } // anonymous namespace
 
 bool is_tripped() {
@@ -35,13 +155,14 @@ bool is_tripped() {
     // 'off' then the kill switch is considered tripped regardless of
     // the sentinel file state.  This mirrors the behaviour of the
     // Python implementation and provides a single env var to disable
-    // the entire system.
+    // the entire system.  getenv is an in-memory lookup, so checking
+    // it inline keeps env changes effective immediately; only the
+    // sentinel stat is cached behind the watcher.
     const char *evolve = std::getenv("COCKPIT_EVOLVE");
     if (evolve && std::string(evolve) == "off") {
         return true;
     }
-    std::filesystem::path p{sentinel_path()};
-    return std::filesystem::exists(p);
+    return SentinelWatcher::instance().sentinel_present();
 }
 
 void require_alive() {
@@ -60,6 +181,9 @@ void trip() {
     // why the file exists.
     std::ofstream ofs(p);
     ofs << "halt";
+    // Make the trip visible to this process immediately instead of
+    // waiting for the watcher to observe the file.
+    SentinelWatcher::instance().refresh();
 }
 
 void reset() {
@@ -67,6 +191,7 @@ void reset() {
     if (std::filesystem::exists(p)) {
         std::filesystem::remove(p);
     }
+    SentinelWatcher::instance().refresh();
 }
 
-} // namespace kill
\ No newline at end of file
+} // namespace kill
@@ -0,0 +1,193 @@
+// latency_metrics.cpp
+//
+// Implementation of the per-thread stage latency histograms declared
+// in latency_metrics.h.  Each thread owns a ThreadBuckets block
+// registered in a global list on first use; record() touches only the
+// calling thread's block, and the scrape path sums across blocks.
+// When a thread exits its counts are folded into a retired aggregate
+// under the registry mutex so no samples are lost.
+
+#include "latency_metrics.h"
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace latency_metrics {
+
+namespace {
+
+// Stage label values, indexed by Stage (keep in sync with the enum).
+const char* const STAGE_NAMES[N_STAGES] = {
+    "validate_path",
+    "moral_core",
+    "build_report",
+    "fdqc_evaluate",
+    "snapshot_write",
+    "db_insert",
+};
+
+// Per-thread histogram block.  Counters are atomics so the scrape
+// thread can read them while the owner writes; both sides use relaxed
+// ordering since scrape totals only need to be eventually consistent.
+struct ThreadBuckets {
+    std::atomic<uint64_t> counts[N_STAGES][N_BUCKETS] = {};
+    std::atomic<uint64_t> sum_cycles[N_STAGES] = {};
+};
+
+// Plain (non-atomic) aggregate used for retired threads and as the
+// scrape-side accumulator.
+struct Totals {
+    uint64_t counts[N_STAGES][N_BUCKETS] = {};
+    uint64_t sum_cycles[N_STAGES] = {};
+
+    void add(const ThreadBuckets& tb) {
+        for (size_t s = 0; s < N_STAGES; ++s) {
+            for (size_t b = 0; b < N_BUCKETS; ++b) {
+                counts[s][b] += tb.counts[s][b].load(std::memory_order_relaxed);
+            }
+            sum_cycles[s] += tb.sum_cycles[s].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBuckets*> live;
+    Totals retired;
+};
+
+Registry& registry() {
+    static Registry inst;
+    return inst;
+}
+
+// Thread-local handle: registers this thread's block on first use and
+// folds it into the retired aggregate on thread exit.
+struct ThreadHandle {
+    ThreadBuckets buckets;
+
+    ThreadHandle() {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.live.push_back(&buckets);
+    }
+
+    ~ThreadHandle() {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.retired.add(buckets);
+        for (auto it = reg.live.begin(); it != reg.live.end(); ++it) {
+            if (*it == &buckets) {
+                reg.live.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+ThreadBuckets& local_buckets() {
+    thread_local ThreadHandle handle;
+    return handle.buckets;
+}
+
+// Bucket index for a cycle delta: floor(log2(cycles)), clamped to the
+// open-ended last bucket.
+size_t bucket_index(uint64_t cycles) {
+    if (cycles < 2) {
+        return 0;
+    }
+    size_t idx = 63 - static_cast<size_t>(__builtin_clzll(cycles));
+    return idx < N_BUCKETS - 1 ? idx : N_BUCKETS - 1;
+}
+
+// Calibrated cycles-per-second, measured once on first scrape by
+// bracketing a short sleep with cycle and steady_clock reads.  The
+// record path never needs it.
+double cycles_per_second() {
+    static const double hz = [] {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = read_cycles();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t c1 = read_cycles();
+        auto t1 = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        return secs > 0.0 ? static_cast<double>(c1 - c0) / secs : 1e9;
+#else
+        return 1e9;  // read_cycles() falls back to nanoseconds
+#endif
+    }();
+    return hz;
+}
+
+} // namespace
+
+uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t cnt;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(cnt));
+    return cnt;
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void record(Stage stage, uint64_t cycles) {
+    ThreadBuckets& tb = local_buckets();
+    size_t s = static_cast<size_t>(stage);
+    tb.counts[s][bucket_index(cycles)].fetch_add(1, std::memory_order_relaxed);
+    tb.sum_cycles[s].fetch_add(cycles, std::memory_order_relaxed);
+}
+
+std::string render_prometheus() {
+    double hz = cycles_per_second();
+
+    Totals totals;
+    {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        totals = reg.retired;
+        for (const ThreadBuckets* tb : reg.live) {
+            totals.add(*tb);
+        }
+    }
+
+    std::ostringstream out;
+    out << "# HELP cockpit_apply_stage_seconds "
+           "Latency of apply_change pipeline stages\n";
+    out << "# TYPE cockpit_apply_stage_seconds histogram\n";
+    out.precision(9);
+    for (size_t s = 0; s < N_STAGES; ++s) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < N_BUCKETS - 1; ++b) {
+            cumulative += totals.counts[s][b];
+            // Upper edge of bucket b is 2^(b+1) cycles.
+            double le = static_cast<double>(1ull << (b + 1)) / hz;
+            out << "cockpit_apply_stage_seconds_bucket{stage=\""
+                << STAGE_NAMES[s] << "\",le=\"" << le << "\"} "
+                << cumulative << "\n";
+        }
+        cumulative += totals.counts[s][N_BUCKETS - 1];
+        out << "cockpit_apply_stage_seconds_bucket{stage=\""
+            << STAGE_NAMES[s] << "\",le=\"+Inf\"} " << cumulative << "\n";
+        out << "cockpit_apply_stage_seconds_sum{stage=\"" << STAGE_NAMES[s]
+            << "\"} " << (static_cast<double>(totals.sum_cycles[s]) / hz)
+            << "\n";
+        out << "cockpit_apply_stage_seconds_count{stage=\"" << STAGE_NAMES[s]
+            << "\"} " << cumulative << "\n";
+    }
+    return out.str();
+}
+
+} // namespace latency_metrics
@@ -12,21 +12,37 @@
 #include "self_writer.h"
 #include "fdqc_system.h"
 #include "change_audit.h"
+#include "latency_metrics.h"
 #include <nlohmann/json.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <map>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <array>
 #include <chrono>
 #include <csignal>
+#include <condition_variable>
+#include <coroutine>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 
 using json = nlohmann::json;
@@ -40,8 +56,12 @@ namespace cockpit {
 struct Config {
     int port = 8080;
     int max_connections = 100;
+    int worker_threads = 0;   // compute-pool size; 0 = one per hardware thread
+    size_t max_body_bytes = 64 * 1024 * 1024;  // reject larger request bodies
     std::string log_file = "cockpit.log";
     bool enable_fdqc = true;
+    int cluster_workers = 0;  // >1 = fork that many worker processes
+    std::string cluster_dir = "logs/cluster";  // per-worker unix sockets
 };
 
 std::unique_ptr<fdqc_system::FDQCSystem> g_fdqc_system;
@@ -52,80 +72,215 @@ std::atomic<size_t> g_requests_processed{0};
 std::atomic<size_t> g_requests_allowed{0};
 std::atomic<size_t> g_requests_blocked{0};
 
+// Cluster identity of this process.  Size 1 means single-process mode
+// (the default); in cluster mode the supervisor in main() forks
+// cluster_workers children and each gets its index here.
+int g_cluster_index = 0;
+int g_cluster_size = 1;
+
 //===========================================================================
 // LOGGING SYSTEM
 //===========================================================================
 
 enum class LogLevel { DEBUG, INFO, WARN, ERROR };
 
+// Asynchronous logger.  log() enqueues the raw message onto a bounded
+// lock-free MPSC ring (Vyukov-style sequence numbers) and returns; a
+// dedicated drain thread formats timestamps and writes batches with a
+// single flush per batch.  The handler threads therefore never share
+// a mutex or pay for a flush on the request path.  If producers
+// outrun the drain thread the ring drops the line and the drop count
+// is reported in-stream once the queue recovers.
 class Logger {
 public:
     static void init(const std::string& filename) {
-        instance().log_file_.open(filename, std::ios::app);
+        auto& inst = instance();
+        inst.log_file_.open(filename, std::ios::app);
+        if (const char* level = std::getenv("COCKPIT_LOG_LEVEL")) {
+            std::string v = level;
+            if (v == "DEBUG") inst.min_level_ = LogLevel::DEBUG;
+            else if (v == "INFO") inst.min_level_ = LogLevel::INFO;
+            else if (v == "WARN") inst.min_level_ = LogLevel::WARN;
+            else if (v == "ERROR") inst.min_level_ = LogLevel::ERROR;
+        }
+        inst.running_ = true;
+        inst.drain_thread_ = std::thread(&Logger::drain_loop, &inst);
     }
-    
-    static void log(LogLevel level, const std::string& message) {
+
+    // Level gate, checked by the LOG_* macros before the message
+    // string is even built.
+    static bool enabled(LogLevel level) {
+        return level >= instance().min_level_.load(std::memory_order_relaxed);
+    }
+
+    static void log(LogLevel level, std::string message) {
         auto& inst = instance();
-        std::lock_guard<std::mutex> lock(inst.mutex_);
-        
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        char time_buf[100];
-        std::tm tm_buf{};
-        #if defined(_WIN32)
-        // On Windows, use localtime_s
-        localtime_s(&tm_buf, &time);
-        #else
-        localtime_r(&time, &tm_buf);
-        #endif
-        std::strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
-        
-        const char* level_str[] = {"DEBUG", "INFO", "WARN", "ERROR"};
-        std::string log_line = std::string("[") + time_buf + "] [" + 
-                               level_str[static_cast<int>(level)] + "] " + message + "\n";
-        
-        if (inst.log_file_.is_open()) {
-            inst.log_file_ << log_line;
-            inst.log_file_.flush();
+        if (!inst.running_.load(std::memory_order_acquire)) {
+            // Before init()/after close(): fall back to synchronous stdout.
+            if (level >= LogLevel::INFO) std::cout << message << "\n";
+            return;
         }
-        
-        if (level >= LogLevel::INFO) {
-            std::cout << log_line;
+        size_t pos = inst.enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = inst.slots_[pos & RING_MASK];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (inst.enqueue_pos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.level = level;
+                    slot.ts = std::chrono::system_clock::now();
+                    slot.msg = std::move(message);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else if (dif < 0) {
+                // Ring full: drop rather than block the request path.
+                inst.dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = inst.enqueue_pos_.load(std::memory_order_relaxed);
+            }
         }
     }
-    
+
     static void close() {
         auto& inst = instance();
-        std::lock_guard<std::mutex> lock(inst.mutex_);
+        if (inst.running_.exchange(false)) {
+            if (inst.drain_thread_.joinable()) inst.drain_thread_.join();
+            inst.drain();  // flush anything enqueued before the stop
+        }
         if (inst.log_file_.is_open()) {
             inst.log_file_.close();
         }
     }
-    
+
 private:
-    Logger() = default;
+    static constexpr size_t RING_SIZE = 4096;  // power of two
+    static constexpr size_t RING_MASK = RING_SIZE - 1;
+
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        LogLevel level = LogLevel::DEBUG;
+        std::chrono::system_clock::time_point ts;
+        std::string msg;
+    };
+
+    Logger() {
+        for (size_t i = 0; i < RING_SIZE; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
     static Logger& instance() {
         static Logger logger;
         return logger;
     }
-    
+
+    void drain_loop() {
+        while (running_.load(std::memory_order_acquire)) {
+            if (!drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+
+    // Drain everything currently queued into one file write and one
+    // flush.  Returns false if the queue was empty.  Single consumer:
+    // only ever called from the drain thread (or close(), after the
+    // drain thread has been joined).
+    bool drain() {
+        std::string file_batch;
+        std::string console_batch;
+        for (;;) {
+            Slot& slot = slots_[dequeue_pos_ & RING_MASK];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != dequeue_pos_ + 1) break;
+            append_line(slot.level, slot.ts, slot.msg, file_batch, console_batch);
+            slot.msg.clear();
+            slot.seq.store(dequeue_pos_ + RING_SIZE, std::memory_order_release);
+            dequeue_pos_++;
+        }
+        size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            append_line(LogLevel::WARN, std::chrono::system_clock::now(),
+                        "Logger dropped " + std::to_string(dropped) +
+                            " message(s) under load",
+                        file_batch, console_batch);
+        }
+        if (file_batch.empty() && console_batch.empty()) return false;
+        if (log_file_.is_open() && !file_batch.empty()) {
+            log_file_ << file_batch;
+            log_file_.flush();
+        }
+        if (!console_batch.empty()) {
+            std::cout << console_batch;
+        }
+        return true;
+    }
+
+    void append_line(LogLevel level, std::chrono::system_clock::time_point ts,
+                     const std::string& message,
+                     std::string& file_batch, std::string& console_batch) {
+        auto time = std::chrono::system_clock::to_time_t(ts);
+        char time_buf[100];
+        std::tm tm_buf{};
+        #if defined(_WIN32)
+        // On Windows, use localtime_s
+        localtime_s(&tm_buf, &time);
+        #else
+        localtime_r(&time, &tm_buf);
+        #endif
+        std::strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+
+        const char* level_str[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        std::string log_line = std::string("[") + time_buf + "] [" +
+                               level_str[static_cast<int>(level)] + "] " + message + "\n";
+        file_batch += log_line;
+        if (level >= LogLevel::INFO) {
+            console_batch += log_line;
+        }
+    }
+
     std::ofstream log_file_;
-    std::mutex mutex_;
+    std::array<Slot, RING_SIZE> slots_;
+    std::atomic<size_t> enqueue_pos_{0};
+    size_t dequeue_pos_ = 0;   // consumer-only
+    std::atomic<size_t> dropped_{0};
+    std::atomic<LogLevel> min_level_{LogLevel::DEBUG};
+    std::atomic<bool> running_{false};
+    std::thread drain_thread_;
 };
 
-#define LOG_INFO(msg) Logger::log(LogLevel::INFO, msg)
-#define LOG_WARN(msg) Logger::log(LogLevel::WARN, msg)
-#define LOG_ERROR(msg) Logger::log(LogLevel::ERROR, msg)
+#define LOG_INFO(msg) do { if (Logger::enabled(LogLevel::INFO)) Logger::log(LogLevel::INFO, msg); } while (0)
+#define LOG_WARN(msg) do { if (Logger::enabled(LogLevel::WARN)) Logger::log(LogLevel::WARN, msg); } while (0)
+#define LOG_ERROR(msg) do { if (Logger::enabled(LogLevel::ERROR)) Logger::log(LogLevel::ERROR, msg); } while (0)
 
 //===========================================================================
 // HTTP HANDLING
 //===========================================================================
 
+// Parsed request.  Header values and the body are views into the
+// connection's receive buffer — no copy is made of multi-megabyte
+// bodies on the way to json::parse.  A request is only valid until
+// the receive buffer is next mutated (consumed after routing).
 struct HttpRequest {
     std::string method;
     std::string path;
-    std::string body;
-    std::map<std::string, std::string> headers;
+    std::string version;
+    std::string_view body;
+    std::map<std::string, std::string_view> headers;
+
+    // HTTP/1.1 defaults to persistent connections; HTTP/1.0 must opt in.
+    bool keep_alive() const {
+        auto it = headers.find("connection");
+        std::string conn = (it != headers.end()) ? std::string(it->second) : "";
+        for (char& c : conn) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (version == "HTTP/1.0") {
+            return conn == "keep-alive";
+        }
+        return conn != "close";
+    }
 };
 
 struct HttpResponse {
@@ -159,11 +314,29 @@ bool load_config(const std::string& filename, Config& config) {
             if (mc > 0) g_config.max_connections = mc;
             else LOG_WARN("Invalid max_connections, keeping default");
         }
+        if (j.contains("worker_threads") && j["worker_threads"].is_number_integer()) {
+            int wt = j["worker_threads"];
+            if (wt >= 0) config.worker_threads = wt;
+            else LOG_WARN("Invalid worker_threads, keeping default");
+        }
+        if (j.contains("max_body_bytes") && j["max_body_bytes"].is_number_integer()) {
+            long long mb = j["max_body_bytes"];
+            if (mb > 0) config.max_body_bytes = static_cast<size_t>(mb);
+            else LOG_WARN("Invalid max_body_bytes, keeping default");
+        }
         if (j.contains("log_file") && j["log_file"].is_string()) {
             // re-init logger to new path if needed
             // Logger::init(j["log_file"]);
         }
         if (j.contains("enable_fdqc")) config.enable_fdqc = j["enable_fdqc"].get<bool>();
+        if (j.contains("cluster_workers") && j["cluster_workers"].is_number_integer()) {
+            int cw = j["cluster_workers"];
+            if (cw >= 0) config.cluster_workers = cw;
+            else LOG_WARN("Invalid cluster_workers, keeping default");
+        }
+        if (j.contains("cluster_dir") && j["cluster_dir"].is_string()) {
+            config.cluster_dir = j["cluster_dir"].get<std::string>();
+        }
         LOG_INFO("Configuration loaded from: " + filename);
         return true;
     } catch (const std::exception& e) {
@@ -172,30 +345,57 @@ bool load_config(const std::string& filename, Config& config) {
     }
 }
 
-HttpRequest parse_http_request(const std::string& raw) {
+// Parse a complete HTTP request in place.  Framing (end of headers,
+// Content-Length, body arrival) is handled by request_length() before
+// this is called, so the parser can slice string_views straight out of
+// the receive buffer instead of streaming copies through
+// istringstream — the body in particular is never copied.
+HttpRequest parse_http_request(std::string_view raw) {
     const size_t MAX_REQUEST_LINE = 8192;
     HttpRequest req;
-    std::istringstream stream(raw);
-    std::string line;
 
-    if (!std::getline(stream, line)) {
+    // Pull the next LF-terminated line, stripping the trailing CR.
+    auto next_line = [raw](size_t& pos) -> std::string_view {
+        size_t eol = raw.find('\n', pos);
+        std::string_view line;
+        if (eol == std::string_view::npos) {
+            line = raw.substr(pos);
+            pos = raw.size();
+        } else {
+            line = raw.substr(pos, eol - pos);
+            pos = eol + 1;
+        }
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return line;
+    };
+
+    if (raw.empty()) {
         throw std::runtime_error("Empty request");
     }
-    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    size_t pos = 0;
+    std::string_view line = next_line(pos);
     if (line.size() > MAX_REQUEST_LINE) {
         throw std::runtime_error("Request line too long");
     }
 
     // Expect: METHOD SP PATH SP HTTP/VERSION
-    {
-        std::istringstream ls(line);
-        std::string http_version;
-        if (!(ls >> req.method >> req.path >> http_version) || http_version.rfind("HTTP/", 0) != 0) {
-            throw std::runtime_error("Malformed request line");
-        }
+    size_t sp1 = line.find(' ');
+    size_t sp2 = (sp1 == std::string_view::npos)
+                     ? std::string_view::npos
+                     : line.find(' ', sp1 + 1);
+    if (sp1 == std::string_view::npos || sp2 == std::string_view::npos) {
+        throw std::runtime_error("Malformed request line");
+    }
+    req.method = std::string(line.substr(0, sp1));
+    req.path = std::string(line.substr(sp1 + 1, sp2 - sp1 - 1));
+    req.version = std::string(line.substr(sp2 + 1));
+    if (req.method.empty() || req.path.empty() ||
+        req.version.rfind("HTTP/", 0) != 0) {
+        throw std::runtime_error("Malformed request line");
     }
 
-    auto has_ctl = [](const std::string& s) {
+    auto has_ctl = [](std::string_view s) {
         for (unsigned char c : s) {
             if ((c < 0x20 && c != '\t') || c == 0x7F) return true;
         }
@@ -204,54 +404,161 @@ HttpRequest parse_http_request(const std::string& raw) {
 
     size_t header_count = 0;
     const size_t MAX_HEADERS = 100;
-    while (std::getline(stream, line) && line != "\r") {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        if (line.empty()) break;
+    while (pos < raw.size()) {
+        line = next_line(pos);
+        if (line.empty()) break; // blank line: end of headers
         if (++header_count > MAX_HEADERS) {
             throw std::runtime_error("Too many headers");
         }
         size_t colon = line.find(':');
-        if (colon == std::string::npos) continue;
+        if (colon == std::string_view::npos) continue;
 
-        std::string key = line.substr(0, colon);
+        std::string_view key_view = line.substr(0, colon);
         size_t value_start = line.find_first_not_of(" \t", colon + 1);
-        if (value_start == std::string::npos) continue;
-        std::string value = line.substr(value_start);
+        if (value_start == std::string_view::npos) continue;
+        std::string_view value = line.substr(value_start);
 
         // Basic validation against control chars
-        if (has_ctl(key) || has_ctl(value)) {
+        if (has_ctl(key_view) || has_ctl(value)) {
             throw std::runtime_error("Invalid header characters");
         }
 
         // Normalize key to lowercase
+        std::string key(key_view);
         for (char& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
 
-        req.headers[key] = value;
+        req.headers[std::move(key)] = value;
     }
 
-    std::ostringstream body_stream;
-    body_stream << stream.rdbuf();
-    req.body = body_stream.str();
+    req.body = raw.substr(pos);
 
     return req;
 }
 
-std::string format_http_response(const HttpResponse& resp) {
+std::string format_http_response(const HttpResponse& resp, bool keep_alive) {
     std::ostringstream stream;
     stream << "HTTP/1.1 " << resp.status_code << " " << resp.status_message << "\r\n";
     stream << "Content-Type: " << resp.content_type << "\r\n";
     stream << "Content-Length: " << resp.body.size() << "\r\n";
-    stream << "Connection: close\r\n\r\n";
+    stream << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
     stream << resp.body;
     return stream.str();
 }
 
+//===========================================================================
+// CLUSTER PATH-AFFINITY ROUTING
+//===========================================================================
+//
+// In cluster mode every worker process accepts client connections
+// (the kernel balances them across the SO_REUSEPORT listeners), but
+// each file path is owned by exactly one worker, chosen by consistent
+// hash.  A worker that receives a change for a path it does not own
+// forwards the request over the owner's unix domain socket and relays
+// the response.  Per-file ordering therefore reduces to the owner's
+// per-path shard lock — no cross-process file lock contention — while
+// read-only endpoints are served by whichever worker the kernel picked.
+
+// Unix socket on which cluster worker `index` accepts forwarded
+// requests (alongside its TCP listener).
+std::string cluster_socket_path(int index) {
+    return g_config.cluster_dir + "/worker_" + std::to_string(index) + ".sock";
+}
+
+// Owning worker for a change path (FNV-1a over the path, mod cluster
+// size).  Matches shard_for_path's spirit: same path, same owner.
+int cluster_owner(const std::string& file_path) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : file_path) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return static_cast<int>(h % static_cast<uint64_t>(g_cluster_size));
+}
+
+// Forward a change request to the owning worker and relay its
+// response.  The X-Cockpit-Forwarded header stops a second hop if the
+// cluster is mid-resize and ownership views disagree.
+HttpResponse forward_change_request(int owner, const HttpRequest& req) {
+    HttpResponse resp;
+    resp.status_code = 503;
+    resp.status_message = "Service Unavailable";
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        resp.body = json({{"error", "cluster forward failed"}}).dump();
+        return resp;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::string sock_path = cluster_socket_path(owner);
+    if (sock_path.size() >= sizeof(addr.sun_path)) {
+        close(fd);
+        resp.body = json({{"error", "cluster socket path too long"}}).dump();
+        return resp;
+    }
+    std::strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        LOG_WARN("Cluster forward to worker " + std::to_string(owner) +
+                 " failed: " + std::string(std::strerror(errno)));
+        resp.body = json({{"error", "owning worker unreachable"}}).dump();
+        return resp;
+    }
+
+    std::ostringstream wire;
+    wire << "POST /api/change HTTP/1.1\r\n"
+         << "Host: cluster\r\n"
+         << "Content-Type: application/json\r\n"
+         << "Content-Length: " << req.body.size() << "\r\n"
+         << "X-Cockpit-Forwarded: " << g_cluster_index << "\r\n"
+         << "Connection: close\r\n\r\n"
+         << req.body;
+    std::string out = wire.str();
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = write(fd, out.data() + sent, out.size() - sent);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            close(fd);
+            resp.body = json({{"error", "cluster forward write failed"}}).dump();
+            return resp;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    // Connection: close framing — read until EOF.
+    std::string raw;
+    char buf[8192];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        raw.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    // Relay status code and body; headers are regenerated locally by
+    // format_http_response.
+    size_t sp = raw.find(' ');
+    if (raw.rfind("HTTP/", 0) != 0 || sp == std::string::npos) {
+        resp.body = json({{"error", "bad response from owning worker"}}).dump();
+        return resp;
+    }
+    resp.status_code = std::atoi(raw.c_str() + sp + 1);
+    if (resp.status_code <= 0) resp.status_code = 502;
+    resp.status_message = (resp.status_code == 200) ? "OK" : "Error";
+    size_t body_at = raw.find("\r\n\r\n");
+    resp.body = (body_at == std::string::npos) ? std::string()
+                                               : raw.substr(body_at + 4);
+    return resp;
+}
+
 HttpResponse handle_change_request(const HttpRequest& req) {
     HttpResponse resp;
-    
+
     try {
         json request_json = json::parse(req.body);
-        
+
         std::string file_path = request_json.value("file_path", "");
         std::string new_content = request_json.value("new_content", "");
         std::string author = request_json.value("author", "anonymous");
@@ -262,7 +569,17 @@ HttpResponse handle_change_request(const HttpRequest& req) {
             resp.body = json({{"error", "Missing required fields"}}).dump();
             return resp;
         }
-        
+
+        // Cluster mode: route the change to the worker owning this
+        // path (already-forwarded requests are handled locally).
+        if (g_cluster_size > 1 &&
+            req.headers.find("x-cockpit-forwarded") == req.headers.end()) {
+            int owner = cluster_owner(file_path);
+            if (owner != g_cluster_index) {
+                return forward_change_request(owner, req);
+            }
+        }
+
         LOG_INFO("Change request: " + file_path + " by " + author);
         
         json explanation = request_json.contains("explanation") ? request_json["explanation"] : json::object();
@@ -321,6 +638,9 @@ HttpResponse handle_metrics(const HttpRequest&) {
     metrics << "cockpit_requests_total " << g_requests_processed.load() << "\n";
     metrics << "cockpit_requests_allowed " << g_requests_allowed.load() << "\n";
     metrics << "cockpit_requests_blocked " << g_requests_blocked.load() << "\n";
+    // Per-stage apply_change latency histograms, aggregated across
+    // worker threads at scrape time.
+    metrics << latency_metrics::render_prometheus();
     resp.body = metrics.str();
     return resp;
 }
@@ -341,29 +661,431 @@ HttpResponse route_request(const HttpRequest& req) {
     }
 }
 
-// New: properly defined client handler
-static void handle_client(int client_socket) {
-    try {
-        // Read request
-        std::string raw;
-        char buffer[8192];
-        ssize_t n;
-        while ((n = ::read(client_socket, buffer, sizeof(buffer))) > 0) {
-            raw.append(buffer, buffer + n);
-            // Stop if we've received end of headers and Content-Length satisfied
-            // Minimal approach: break on connection close; production code should parse Content-Length.
-            if (n < static_cast<ssize_t>(sizeof(buffer))) break;
-        }
-        HttpRequest req = parse_http_request(raw);
-        HttpResponse resp = route_request(req);
-        std::string response = format_http_response(resp);
-        ::write(client_socket, response.c_str(), response.size());
-    } catch (const std::exception& e) {
-        LOG_ERROR("Error: " + std::string(e.what()));
+//===========================================================================
+// EVENT LOOP SERVER
+//===========================================================================
+//
+// Each connection is served by a C++20 coroutine that owns the socket
+// from accept to close.  Socket readiness and route_request()
+// completion are both awaitables: awaiting I/O parks the coroutine in
+// the event loop's epoll bookkeeping, and awaiting a route hands the
+// request to a compute pool and resumes on the loop thread once the
+// response is ready.  One event-loop thread therefore interleaves
+// every in-flight request, and a slow FDQC evaluation on /api/change
+// occupies a compute thread instead of stalling the loop that owns
+// all other connections.  Concurrency is bounded by open sockets, not
+// thread count.
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Sentinel from request_length(): the request exceeds configured
+// limits and must be rejected rather than buffered further.
+static constexpr size_t REQUEST_TOO_LARGE = static_cast<size_t>(-1);
+
+// Upper bound on the header section; anything larger is a flood.
+static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+
+// Check whether in_buf holds a complete HTTP request.  With a
+// non-blocking read loop we cannot rely on short reads as a request
+// delimiter: headers must be complete and, if Content-Length is
+// present, the body must have arrived.  Returns the total request
+// length in bytes, 0 if more data is needed, or REQUEST_TOO_LARGE if
+// the headers overflow MAX_HEADER_BYTES or the declared body exceeds
+// max_body_bytes.  Oversized bodies are rejected here, as soon as the
+// headers arrive, so the connection never buffers them.
+static size_t request_length(const std::string& in_buf) {
+    size_t header_end = in_buf.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return in_buf.size() > MAX_HEADER_BYTES ? REQUEST_TOO_LARGE : 0;
+    }
+    size_t body_start = header_end + 4;
+    // Scan headers for Content-Length (case-insensitive)
+    size_t content_length = 0;
+    size_t pos = in_buf.find("\r\n");
+    while (pos != std::string::npos && pos < header_end) {
+        size_t line_start = pos + 2;
+        size_t line_end = in_buf.find("\r\n", line_start);
+        if (line_end == std::string::npos || line_end > header_end) line_end = header_end;
+        size_t colon = in_buf.find(':', line_start);
+        if (colon != std::string::npos && colon < line_end) {
+            std::string key = in_buf.substr(line_start, colon - line_start);
+            for (char& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (key == "content-length") {
+                try {
+                    content_length = std::stoul(in_buf.substr(colon + 1, line_end - colon - 1));
+                } catch (...) {
+                    return body_start; // malformed length: let the parser reject it
+                }
+            }
+        }
+        pos = line_end;
+        if (pos >= header_end) break;
     }
-    ::close(client_socket);
+    if (content_length > g_config.max_body_bytes) return REQUEST_TOO_LARGE;
+    if (in_buf.size() < body_start + content_length) return 0;
+    return body_start + content_length;
 }
 
+// Fixed pool of threads that run route_request() off the event loop.
+// Sized by worker_threads, so request CPU work still spreads across
+// cores.  Jobs queued after stop() begins are drained before the
+// threads exit, so every coroutine awaiting a route gets its
+// completion posted back to the loop.
+class ComputePool {
+public:
+    void start(int n_threads) {
+        for (int i = 0; i < n_threads; ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_) {
+            if (t.joinable()) t.join();
+        }
+        threads_.clear();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return; // stopping, queue drained
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+static ComputePool g_compute_pool;
+
+// Detached per-connection coroutine.  The frame destroys itself when
+// serve_connection() returns (final_suspend never suspends); while
+// suspended, the sole reference to the frame is held either in the
+// event loop's armed-fd table or by a compute-pool completion.
+struct ConnTask {
+    struct promise_type {
+        ConnTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {
+            LOG_ERROR("Connection coroutine terminated by exception");
+        }
+    };
+};
+
+class EventLoop {
+public:
+    EventLoop() = default;
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool start() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || wake_fd_ < 0) {
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0) {
+            return false;
+        }
+        thread_ = std::thread(&EventLoop::run, this);
+        return true;
+    }
+
+    // Called from the acceptor thread: queue a socket and wake the loop.
+    void add_connection(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.push_back(fd);
+        }
+        wake();
+    }
+
+    // Called from compute threads: queue a coroutine for resumption on
+    // the loop thread and wake it.  All coroutine code runs on the loop
+    // thread; compute threads only ever touch this queue.
+    void post_resume(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(resume_mutex_);
+            resumes_.push_back(h);
+        }
+        wake();
+    }
+
+    // Must run after ComputePool::stop(): with the pool drained, every
+    // live coroutine is suspended either in the armed-fd table or on
+    // the resume queue, and destroying the handle frees its frame.
+    void stop() {
+        if (thread_.joinable()) {
+            wake();
+            thread_.join();
+        }
+        for (auto& entry : armed_) {
+            entry.second.destroy();
+        }
+        armed_.clear();
+        {
+            std::lock_guard<std::mutex> lock(resume_mutex_);
+            for (std::coroutine_handle<> h : resumes_) h.destroy();
+            resumes_.clear();
+        }
+        for (int fd : conns_) ::close(fd);
+        conns_.clear();
+        if (wake_fd_ >= 0) ::close(wake_fd_);
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    }
+
+private:
+    // Awaitable: suspend until epoll reports `events` on fd.  Armed
+    // with EPOLLONESHOT so a socket whose coroutine is busy elsewhere
+    // (e.g. awaiting a route) can never spin the loop, and HUP/ERR
+    // simply resume the coroutine, whose next syscall surfaces the
+    // error.
+    struct IoAwaitable {
+        EventLoop& loop;
+        int fd;
+        uint32_t events;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop.arm(fd, events, h); }
+        void await_resume() const noexcept {}
+    };
+
+    // Awaitable: run route_request() on the compute pool and resume on
+    // the loop thread once the response is ready.  This is the
+    // suspension point that lets one loop thread interleave many
+    // in-flight requests.  The response is written through `out` into
+    // a coroutine-frame local rather than stored in the awaitable:
+    // the awaitable stays trivially copyable, so it is immune to the
+    // compiler relocating the co_await operand within the frame
+    // (observed with GCC 12, which leaves interior SSO pointers
+    // dangling when the operand holds std::string members).
+    struct RouteAwaitable {
+        EventLoop& loop;
+        const HttpRequest& req;
+        HttpResponse& out;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            EventLoop* l = &loop;
+            const HttpRequest* r = &req;
+            HttpResponse* o = &out;
+            g_compute_pool.submit([l, r, o, h] {
+                try {
+                    *o = route_request(*r);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("route_request failed: " + std::string(e.what()));
+                    o->status_code = 500;
+                    o->status_message = "Internal Server Error";
+                    o->body = json({{"error", "internal error"}}).dump();
+                }
+                l->post_resume(h);
+            });
+        }
+        void await_resume() const noexcept {}
+    };
+
+    void run() {
+        constexpr int MAX_EVENTS = 64;
+        epoll_event events[MAX_EVENTS];
+        while (!g_shutdown_requested) {
+            int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, 1000);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("epoll_wait failed: " + std::string(std::strerror(errno)));
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wake_fd_) {
+                    drain_wake();
+                    continue;
+                }
+                auto it = armed_.find(fd);
+                if (it == armed_.end()) continue; // stale oneshot event
+                std::coroutine_handle<> h = it->second;
+                armed_.erase(it);
+                h.resume();
+            }
+        }
+    }
+
+    void drain_wake() {
+        uint64_t counter;
+        while (::read(wake_fd_, &counter, sizeof(counter)) > 0) {}
+        // New connections: register the socket disabled (events = 0);
+        // the coroutine's first blocked await arms it.
+        std::vector<int> fds;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            fds.swap(pending_);
+        }
+        for (int fd : fds) {
+            if (!set_nonblocking(fd)) {
+                ::close(fd);
+                continue;
+            }
+            epoll_event ev{};
+            ev.events = 0;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                ::close(fd);
+                continue;
+            }
+            conns_.insert(fd);
+            serve_connection(fd); // runs until its first suspension
+        }
+        // Completions posted by the compute pool.
+        std::vector<std::coroutine_handle<>> ready;
+        {
+            std::lock_guard<std::mutex> lock(resume_mutex_);
+            ready.swap(resumes_);
+        }
+        for (std::coroutine_handle<> h : ready) h.resume();
+    }
+
+    void arm(int fd, uint32_t ev_mask, std::coroutine_handle<> h) {
+        epoll_event ev{};
+        ev.events = ev_mask | EPOLLONESHOT;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
+            // Cannot wait on the fd; resume via the queue and let the
+            // coroutine's next syscall surface the error.
+            post_resume(h);
+            return;
+        }
+        armed_[fd] = h;
+    }
+
+    // The per-connection coroutine: read one complete request, await
+    // its route, write the response; repeat while keep-alive.  Every
+    // exit path falls through to the fd cleanup at the bottom.
+    ConnTask serve_connection(int fd) {
+        std::string in_buf;
+        bool keep_alive = true;
+        bool broken = false;
+        while (keep_alive && !broken && !g_shutdown_requested) {
+            // Accumulate until request_length() sees a full request; a
+            // pipelined request left over from the previous iteration
+            // is served without touching the socket.
+            size_t req_len;
+            for (;;) {
+                req_len = request_length(in_buf);
+                if (req_len != 0) break;
+                char buffer[8192];
+                ssize_t n = ::read(fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    in_buf.append(buffer, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n == 0) { broken = true; break; }
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    co_await IoAwaitable{*this, fd, EPOLLIN};
+                    continue;
+                }
+                broken = true;
+                break;
+            }
+            if (broken) break;
+            std::string out;
+            if (req_len == REQUEST_TOO_LARGE) {
+                HttpResponse resp;
+                resp.status_code = 413;
+                resp.status_message = "Payload Too Large";
+                resp.body = json({{"error", "request too large"}}).dump();
+                keep_alive = false;
+                out = format_http_response(resp, false);
+            } else {
+                try {
+                    // Parsed in place as a view of in_buf and only
+                    // erased after routing, so the body is not copied.
+                    HttpRequest req = parse_http_request(
+                        std::string_view(in_buf.data(), req_len));
+                    keep_alive = req.keep_alive();
+                    HttpResponse resp;
+                    co_await RouteAwaitable{*this, req, resp};
+                    out = format_http_response(resp, keep_alive);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Error: " + std::string(e.what()));
+                    break;
+                }
+                in_buf.erase(0, req_len);
+            }
+            size_t off = 0;
+            while (off < out.size()) {
+                ssize_t n = ::write(fd, out.data() + off, out.size() - off);
+                if (n > 0) {
+                    off += static_cast<size_t>(n);
+                    continue;
+                }
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    co_await IoAwaitable{*this, fd, EPOLLOUT};
+                    continue;
+                }
+                broken = true;
+                break;
+            }
+        }
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        conns_.erase(fd);
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread thread_;
+    std::mutex pending_mutex_;
+    std::vector<int> pending_;
+    std::mutex resume_mutex_;
+    std::vector<std::coroutine_handle<>> resumes_;
+    // fd → coroutine parked on that fd's EPOLLONESHOT arming.  Loop
+    // thread only.
+    std::unordered_map<int, std::coroutine_handle<>> armed_;
+    // All open connection sockets, for teardown in stop().
+    std::unordered_set<int> conns_;
+};
+
 void run_server() {
     int server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket < 0) {
@@ -375,51 +1097,215 @@ void run_server() {
     #ifdef SO_REUSEPORT
     setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
     #endif
-    // Optional: disable Nagle for responsiveness on accepted sockets (apply per-connection as well)
-    // int one = 1; setsockopt(server_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-    // Set a short accept timeout to allow responsive shutdown
-    struct timeval tv;
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
 
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(g_config.port);
-    
+
     if (bind(server_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         LOG_ERROR("Failed to bind to port " + std::to_string(g_config.port));
         close(server_socket);
         return;
     }
-    
+
     if (listen(server_socket, g_config.max_connections) < 0) {
         LOG_ERROR("Failed to listen");
         close(server_socket);
         return;
     }
-    
-    LOG_INFO("Server listening on port " + std::to_string(g_config.port));
-    
+    if (!set_nonblocking(server_socket)) {
+        LOG_ERROR("Failed to set listen socket non-blocking");
+        close(server_socket);
+        return;
+    }
+
+    // Cluster mode: also listen on this worker's unix socket for
+    // change requests forwarded by peer workers.  Forwarded
+    // connections are served by the same event loop as TCP ones.
+    int cluster_socket = -1;
+    std::string cluster_sock_path;
+    if (g_cluster_size > 1) {
+        cluster_sock_path = cluster_socket_path(g_cluster_index);
+        cluster_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un uaddr{};
+        uaddr.sun_family = AF_UNIX;
+        if (cluster_socket < 0 ||
+            cluster_sock_path.size() >= sizeof(uaddr.sun_path)) {
+            LOG_ERROR("Failed to create cluster socket");
+            if (cluster_socket >= 0) close(cluster_socket);
+            close(server_socket);
+            return;
+        }
+        std::strncpy(uaddr.sun_path, cluster_sock_path.c_str(),
+                     sizeof(uaddr.sun_path) - 1);
+        unlink(cluster_sock_path.c_str());
+        if (bind(cluster_socket, (sockaddr*)&uaddr, sizeof(uaddr)) < 0 ||
+            listen(cluster_socket, g_config.max_connections) < 0 ||
+            !set_nonblocking(cluster_socket)) {
+            LOG_ERROR("Failed to bind cluster socket " + cluster_sock_path);
+            close(cluster_socket);
+            close(server_socket);
+            return;
+        }
+    }
+
+    // Spin up the compute pool (sized like the old worker pool) and
+    // the single event loop that multiplexes every connection.
+    int n_compute = g_config.worker_threads;
+    if (n_compute <= 0) {
+        n_compute = static_cast<int>(std::thread::hardware_concurrency());
+        if (n_compute <= 0) n_compute = 4;
+    }
+    g_compute_pool.start(n_compute);
+
+    EventLoop loop;
+    if (!loop.start()) {
+        LOG_ERROR("Failed to start event loop");
+        g_shutdown_requested = true;
+    }
+
+    int accept_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (accept_epoll >= 0) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = server_socket;
+        if (epoll_ctl(accept_epoll, EPOLL_CTL_ADD, server_socket, &ev) < 0) {
+            LOG_ERROR("Failed to register listen socket with epoll");
+            g_shutdown_requested = true;
+        }
+        if (cluster_socket >= 0) {
+            epoll_event cev{};
+            cev.events = EPOLLIN;
+            cev.data.fd = cluster_socket;
+            if (epoll_ctl(accept_epoll, EPOLL_CTL_ADD, cluster_socket, &cev) < 0) {
+                LOG_ERROR("Failed to register cluster socket with epoll");
+                g_shutdown_requested = true;
+            }
+        }
+    } else {
+        LOG_ERROR("Failed to create accept epoll instance");
+        g_shutdown_requested = true;
+    }
+
+    LOG_INFO("Server listening on port " + std::to_string(g_config.port) +
+             " with " + std::to_string(n_compute) + " compute threads");
+
     while (!g_shutdown_requested) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        
-        int client_socket = accept(server_socket, (sockaddr*)&client_addr, &client_len);
-        if (client_socket < 0) {
-            if (!g_shutdown_requested) {
-                LOG_ERROR("Failed to accept connection");
+        epoll_event ev{};
+        int n = epoll_wait(accept_epoll, &ev, 1, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("accept epoll_wait failed: " + std::string(std::strerror(errno)));
+            break;
+        }
+        if (n == 0) continue;
+        // Drain the accept queue of whichever listener became ready
+        int ready_fd = ev.data.fd;
+        for (;;) {
+            sockaddr_storage client_addr{};
+            socklen_t client_len = sizeof(client_addr);
+            int client_socket = accept(ready_fd, (sockaddr*)&client_addr, &client_len);
+            if (client_socket < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+                if (!g_shutdown_requested) {
+                    LOG_ERROR("Failed to accept connection");
+                }
+                break;
             }
-            continue;
+            loop.add_connection(client_socket);
         }
-        
-        std::thread(handle_client, client_socket).detach();
     }
-    
+
+    // Stop the compute pool first: once its queue is drained, every
+    // coroutine is suspended where loop.stop() can destroy it.
+    g_compute_pool.stop();
+    loop.stop();
+    if (accept_epoll >= 0) close(accept_epoll);
+    if (cluster_socket >= 0) {
+        close(cluster_socket);
+        unlink(cluster_sock_path.c_str());
+    }
     close(server_socket);
 }
 
+//===========================================================================
+// CLUSTER SUPERVISOR
+//===========================================================================
+
+// Fork and supervise the cluster worker processes.  Returns -1 in a
+// child (which then continues through normal server startup with its
+// cluster identity set), or the supervisor's exit code in the parent
+// once all workers have terminated.  Workers that die unexpectedly
+// are restarted; a shutdown signal is forwarded as SIGTERM.
+int run_cluster_supervisor(int n_workers) {
+    std::error_code ec;
+    std::filesystem::create_directories(g_config.cluster_dir, ec);
+    // Exported so change_audit switches the prev_hash chain into its
+    // cross-process (in-transaction) mode in every worker.
+    setenv("COCKPIT_CLUSTER_SIZE", std::to_string(n_workers).c_str(), 1);
+
+    std::vector<pid_t> pids(n_workers, -1);
+    auto spawn = [&](int index) -> bool {
+        setenv("COCKPIT_CLUSTER_INDEX", std::to_string(index).c_str(), 1);
+        pid_t pid = fork();
+        if (pid == 0) {
+            g_cluster_index = index;
+            g_cluster_size = n_workers;
+            return true;  // child continues in main()
+        }
+        if (pid < 0) {
+            std::cerr << "fork failed for cluster worker " << index
+                      << ": " << std::strerror(errno) << std::endl;
+        }
+        pids[index] = pid;
+        return false;
+    };
+
+    for (int i = 0; i < n_workers; ++i) {
+        if (spawn(i)) return -1;
+    }
+    std::cout << "Cluster supervisor running with " << n_workers
+              << " workers" << std::endl;
+
+    // Poll for dead workers rather than blocking in waitpid: the
+    // signal() handlers are installed with SA_RESTART semantics, so a
+    // blocking waitpid would be transparently restarted and never let
+    // this loop observe a shutdown request.
+    while (!g_shutdown_requested) {
+        int status = 0;
+        pid_t dead = waitpid(-1, &status, WNOHANG);
+        if (dead == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+        if (dead < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (g_shutdown_requested) break;
+        for (int i = 0; i < n_workers; ++i) {
+            if (pids[i] == dead) {
+                std::cout << "Cluster worker " << i
+                          << " exited; restarting" << std::endl;
+                if (spawn(i)) return -1;
+                break;
+            }
+        }
+    }
+
+    for (pid_t pid : pids) {
+        if (pid > 0) ::kill(pid, SIGTERM);
+    }
+    for (pid_t pid : pids) {
+        if (pid > 0) {
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        }
+    }
+    return 0;
+}
+
 } // namespace cockpit
 
 void signal_handler(int signal) {
@@ -444,7 +1330,23 @@ int main(int argc, char* argv[]) {
         config_file = argv[1];
     }
     load_config(config_file, g_config);
-    
+
+    // Install signal handlers before any fork so the cluster
+    // supervisor's waitpid loop sees shutdown requests; workers
+    // inherit the same handlers.
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // Cluster mode: fork the workers before any threads or FDQC
+    // state exist.  The supervisor only restarts and reaps workers;
+    // each child falls through to normal startup below with its own
+    // log file so the async loggers do not interleave in one file.
+    if (g_config.cluster_workers > 1) {
+        int rc = run_cluster_supervisor(g_config.cluster_workers);
+        if (rc >= 0) return rc;
+        g_config.log_file += "." + std::to_string(g_cluster_index);
+    }
+
     Logger::init(g_config.log_file);
     LOG_INFO("=== Cockpit Server Starting ===");
     LOG_INFO("Port: " + std::to_string(g_config.port));
@@ -452,17 +1354,16 @@ int main(int argc, char* argv[]) {
     
     if (g_config.enable_fdqc) {
         try {
-            g_fdqc_system = std::make_unique<fdqc_system::FDQCSystem>();
+            // Health-check instance only; evaluation runs on the pool
+            // in self_writer, whose slot 0 owns the persistent store
+            g_fdqc_system = std::make_unique<fdqc_system::FDQCSystem>(false);
             LOG_INFO("FDQC consciousness initialized");
         } catch (const std::exception& e) {
             LOG_ERROR("FDQC init failed: " + std::string(e.what()));
             return 1;
         }
     }
-    
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    
+
     std::cout << "\n✓ Server ready on http://localhost:" << g_config.port << std::endl;
     std::cout << "  POST /api/change  - Submit code change" << std::endl;
     std::cout << "  GET  /api/health  - Health check" << std::endl;
@@ -16,13 +16,38 @@ namespace meta_monitor {
 //===========================================================================
 
 void MetaMonitor::observe(const ProcessObservation& observation) {
-    observations_.push_back(observation);
-    
-    // Maintain history limit
-    if (observations_.size() > MAX_HISTORY) {
-        observations_.pop_front();
+    if (ring_.size() != MAX_HISTORY) {
+        ring_.resize(MAX_HISTORY);
     }
-    
+
+    // Evict the slot being overwritten from the rolling sums, then
+    // fold the new observation in: O(1) per observation and O(1) for
+    // every consumer of the windowed statistics.
+    if (count_ == MAX_HISTORY) {
+        double old = ring_[head_].entropy;
+        entropy_sum_ -= old;
+        entropy_sumsq_ -= old * old;
+    } else {
+        ++count_;
+    }
+    ring_[head_] = observation;
+    head_ = (head_ + 1) % MAX_HISTORY;
+    entropy_sum_ += observation.entropy;
+    entropy_sumsq_ += observation.entropy * observation.entropy;
+
+    // The windowed subtract slowly accumulates floating-point error;
+    // re-accumulate from the ring once per ~1M observations (O(100),
+    // amortized to nothing).
+    if ((++total_observed_ & 0xFFFFF) == 0) {
+        entropy_sum_ = 0.0;
+        entropy_sumsq_ = 0.0;
+        for (size_t i = 0; i < count_; ++i) {
+            double e = ring_[i].entropy;
+            entropy_sum_ += e;
+            entropy_sumsq_ += e * e;
+        }
+    }
+
     stats_.observations_recorded++;
 }
 
@@ -33,11 +58,11 @@ void MetaMonitor::observe(const ProcessObservation& observation) {
 PhenomenalState MetaMonitor::compute_phenomenal_state() const {
     PhenomenalState state;
     
-    if (observations_.empty()) {
+    if (count_ == 0) {
         return state;
     }
-    
-    const ProcessObservation& latest = observations_.back();
+
+    const ProcessObservation& latest = this->latest();
     
     // Intensity: compression level (1 - ||WM|| / ||Global||)
     state.intensity = compute_intensity();
@@ -77,9 +102,9 @@ PhenomenalState MetaMonitor::compute_phenomenal_state() const {
 //===========================================================================
 
 double MetaMonitor::compute_intensity() const {
-    if (observations_.empty()) return 0.5;
-    
-    const ProcessObservation& obs = observations_.back();
+    if (count_ == 0) return 0.5;
+
+    const ProcessObservation& obs = latest();
     
     // Intensity = 1 - (||H_WM|| / ||H_global||)
     if (obs.global_norm < fdqc_params::EPSILON) {
@@ -94,9 +119,9 @@ double MetaMonitor::compute_intensity() const {
 }
 
 double MetaMonitor::compute_clarity() const {
-    if (observations_.empty()) return 0.5;
-    
-    const ProcessObservation& obs = observations_.back();
+    if (count_ == 0) return 0.5;
+
+    const ProcessObservation& obs = latest();
     
     // Clarity = 1 - (S / S_max)
     // S_max = log₂(n)
@@ -113,9 +138,9 @@ double MetaMonitor::compute_clarity() const {
 }
 
 double MetaMonitor::compute_flow() const {
-    if (observations_.empty()) return 0.5;
-    
-    const ProcessObservation& obs = observations_.back();
+    if (count_ == 0) return 0.5;
+
+    const ProcessObservation& obs = latest();
     
     // Flow: high when collapse rate is low
     // Normalize collapse frequency around 10 Hz target
@@ -133,9 +158,9 @@ double MetaMonitor::compute_flow() const {
 }
 
 double MetaMonitor::compute_presence() const {
-    if (observations_.empty()) return 1.0;
-    
-    const ProcessObservation& obs = observations_.back();
+    if (count_ == 0) return 1.0;
+
+    const ProcessObservation& obs = latest();
     
     // Presence based on temporal mode
     if (obs.temporal_mode == fdqc_params::TemporalMode::PRESENT) {
@@ -154,21 +179,21 @@ double MetaMonitor::compute_presence() const {
 PhenomenalReport MetaMonitor::generate_report() const {
     PhenomenalReport report;
     
-    if (observations_.empty()) {
+    if (count_ == 0) {
         report.textual_report = "No observations recorded.";
         report.confidence = 0.0;
         return report;
     }
-    
+
     // Compute phenomenal state
     report.state = compute_phenomenal_state();
-    report.observation = observations_.back();
+    report.observation = latest();
     
     // Generate textual description
     report.textual_report = generate_textual_report(report.state);
     
     // Confidence based on observation count (use floating point division)
-    report.confidence = std::min(1.0, static_cast<double>(observations_.size()) / 10.0);
+    report.confidence = std::min(1.0, static_cast<double>(count_) / 10.0);
     
     // Update statistics
     const_cast<MetaMonitor*>(this)->update_stats(report.state);
@@ -245,9 +270,9 @@ std::string MetaMonitor::generate_textual_report(
     
     // Add metrics
     oss << "\n\nMetrics:";
-    oss << "\n  Working memory: n=" << observations_.back().working_memory_dimension;
-    oss << "\n  Entropy: " << observations_.back().entropy;
-    oss << "\n  Collapse frequency: " << observations_.back().collapse_frequency << " Hz";
+    oss << "\n  Working memory: n=" << latest().working_memory_dimension;
+    oss << "\n  Entropy: " << latest().entropy;
+    oss << "\n  Collapse frequency: " << latest().collapse_frequency << " Hz";
     
     return oss.str();
 }
@@ -257,32 +282,24 @@ std::string MetaMonitor::generate_textual_report(
 //===========================================================================
 
 double MetaMonitor::evaluate_self_awareness() const {
-    if (observations_.empty()) {
+    if (count_ == 0) {
         return 0.0;
     }
-    
+
     // Self-awareness components:
     // 1. Observation consistency (tracking over time)
-    double observation_score = std::min(1.0, observations_.size() / 20.0);
-    
+    double observation_score = std::min(1.0, count_ / 20.0);
+
     // 2. Phenomenal differentiation (simplified: use entropy variance)
     double differentiation_score = 0.5;  // Default moderate differentiation
-    
-    if (observations_.size() >= 5) {
-        // Compute entropy variance as proxy for state differentiation
-        double mean_entropy = 0.0;
-        for (const auto& obs : observations_) {
-            mean_entropy += obs.entropy;
-        }
-        mean_entropy /= observations_.size();
-        
-        double variance = 0.0;
-        for (const auto& obs : observations_) {
-            double diff = obs.entropy - mean_entropy;
-            variance += diff * diff;
-        }
-        variance /= observations_.size();
-        
+
+    if (count_ >= 5) {
+        // Entropy variance over the window as a proxy for state
+        // differentiation, read off the rolling sums in O(1).
+        double mean_entropy = entropy_sum_ / count_;
+        double variance = std::max(
+            0.0, entropy_sumsq_ / count_ - mean_entropy * mean_entropy);
+
         // Normalize variance to [0, 1]
         differentiation_score = std::min(1.0, std::sqrt(variance));
     }
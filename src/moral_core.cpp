@@ -1,19 +1,316 @@
 // moral_core.cpp
 //
-// Trivial moral core stub.  Real installations should replace this
-// implementation with calls into a policy engine that enforces
-// whatever ethical or business rules your organisation requires.
+// Policy engine for plan screening.  Rules are loaded once from the
+// JSON file named by MORAL_POLICY_PATH and compiled into matchers:
+//
+//   - deny_paths:    path globs compiled into a component trie
+//   - allow_authors: exact-match allowlist (empty = everyone)
+//   - deny_content / deny_symbols: literal patterns compiled into a
+//     single Aho-Corasick automaton, so screening the whole rule set
+//     costs one pass over the change content regardless of how many
+//     patterns are configured
+//
+// With no policy file configured the engine has no rules and every
+// plan is allowed, preserving the behaviour of the old stub.
 
 #include "moral_core.h"
 
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 namespace moral_core {
 
-Decision choose(const nlohmann::json & /*plan*/) {
-    // In the Python code the moral core may examine the plan and
-    // decide to block.  Here we simply allow all operations.  To
-    // integrate a real policy engine replace this with logic that
-    // inspects the plan and returns {true, "reason"} when blocking.
+namespace {
+
+//---------------------------------------------------------------------------
+// Path glob trie
+//---------------------------------------------------------------------------
+//
+// Patterns are split on '/'.  A literal component matches itself, "*"
+// matches exactly one component, and a trailing "*" (or "**") matches
+// any remaining suffix, so "secrets/*" denies everything under
+// secrets/.  Matching walks the trie once per path component instead
+// of testing every glob against the path.
+
+class PathTrie {
+public:
+    void add(const std::string &pattern) {
+        size_t node = ensure_root();
+        std::vector<std::string> parts = split(pattern);
+        for (size_t i = 0; i < parts.size(); ++i) {
+            const std::string &part = parts[i];
+            bool last = (i + 1 == parts.size());
+            if (last && (part == "*" || part == "**")) {
+                nodes_[node].prefix_pattern = pattern;
+                return;
+            }
+            size_t next;
+            if (part == "*") {
+                if (nodes_[node].star < 0) {
+                    nodes_[node].star = static_cast<int>(new_node());
+                }
+                next = static_cast<size_t>(nodes_[node].star);
+            } else {
+                auto it = nodes_[node].children.find(part);
+                if (it == nodes_[node].children.end()) {
+                    size_t created = new_node();
+                    nodes_[node].children.emplace(part, created);
+                    next = created;
+                } else {
+                    next = it->second;
+                }
+            }
+            node = next;
+        }
+        nodes_[node].terminal_pattern = pattern;
+    }
+
+    // Returns the matching pattern, or an empty string.
+    std::string match(const std::string &path) const {
+        if (nodes_.empty()) return std::string();
+        return walk(0, split(path), 0);
+    }
+
+    bool empty() const { return nodes_.empty(); }
+
+private:
+    struct Node {
+        std::unordered_map<std::string, size_t> children;
+        int star = -1;                 // "*" component child
+        std::string terminal_pattern;  // exact-length match ends here
+        std::string prefix_pattern;    // trailing-wildcard match ends here
+    };
+
+    std::vector<Node> nodes_;
+
+    size_t ensure_root() {
+        if (nodes_.empty()) nodes_.emplace_back();
+        return 0;
+    }
+
+    size_t new_node() {
+        nodes_.emplace_back();
+        return nodes_.size() - 1;
+    }
+
+    static std::vector<std::string> split(const std::string &s) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        // Tolerate a leading "./" so caller-supplied relative paths
+        // match the patterns as written.
+        if (s.rfind("./", 0) == 0) start = 2;
+        while (start <= s.size()) {
+            size_t slash = s.find('/', start);
+            if (slash == std::string::npos) {
+                if (start < s.size()) parts.push_back(s.substr(start));
+                break;
+            }
+            if (slash > start) parts.push_back(s.substr(start, slash - start));
+            start = slash + 1;
+        }
+        return parts;
+    }
+
+    std::string walk(size_t node, const std::vector<std::string> &parts,
+                     size_t depth) const {
+        const Node &n = nodes_[node];
+        if (!n.prefix_pattern.empty()) return n.prefix_pattern;
+        if (depth == parts.size()) return n.terminal_pattern;
+        auto it = n.children.find(parts[depth]);
+        if (it != n.children.end()) {
+            std::string hit = walk(it->second, parts, depth + 1);
+            if (!hit.empty()) return hit;
+        }
+        if (n.star >= 0) {
+            return walk(static_cast<size_t>(n.star), parts, depth + 1);
+        }
+        return std::string();
+    }
+};
+
+//---------------------------------------------------------------------------
+// Aho-Corasick content matcher
+//---------------------------------------------------------------------------
+//
+// All literal content patterns share one automaton: the goto trie is
+// built per pattern, failure links are computed breadth-first, and
+// suffix-reachable outputs are folded into each node at build time.
+// A scan then advances one state per input byte and reports the first
+// pattern end state it reaches — one pass over the content no matter
+// how many patterns are loaded.
+
+class ContentMatcher {
+public:
+    void add(const std::string &pattern, size_t rule_id) {
+        if (pattern.empty()) return;
+        ensure_root();
+        size_t node = 0;
+        for (unsigned char c : pattern) {
+            auto it = nodes_[node].next.find(c);
+            if (it == nodes_[node].next.end()) {
+                nodes_.emplace_back();
+                nodes_[node].next.emplace(c, nodes_.size() - 1);
+                node = nodes_.size() - 1;
+            } else {
+                node = it->second;
+            }
+        }
+        nodes_[node].out = static_cast<int>(rule_id);
+    }
+
+    // Compute failure links; must be called once after the last add().
+    void compile() {
+        if (nodes_.empty()) return;
+        std::queue<size_t> bfs;
+        for (auto &entry : nodes_[0].next) {
+            nodes_[entry.second].fail = 0;
+            bfs.push(entry.second);
+        }
+        while (!bfs.empty()) {
+            size_t node = bfs.front();
+            bfs.pop();
+            // Inherit the nearest suffix match so scanning never has
+            // to chase failure links to report a hit.
+            if (nodes_[node].out < 0) {
+                nodes_[node].out = nodes_[nodes_[node].fail].out;
+            }
+            for (auto &entry : nodes_[node].next) {
+                unsigned char c = entry.first;
+                size_t child = entry.second;
+                size_t f = nodes_[node].fail;
+                while (f != 0 && !nodes_[f].next.count(c)) {
+                    f = nodes_[f].fail;
+                }
+                auto it = nodes_[f].next.find(c);
+                nodes_[child].fail =
+                    (it != nodes_[f].next.end() && it->second != child)
+                        ? it->second : 0;
+                bfs.push(child);
+            }
+        }
+    }
+
+    // Scan `text` once; returns the first matching rule id, or -1.
+    int scan(const std::string &text) const {
+        if (nodes_.empty()) return -1;
+        size_t node = 0;
+        for (unsigned char c : text) {
+            while (node != 0 && !nodes_[node].next.count(c)) {
+                node = nodes_[node].fail;
+            }
+            auto it = nodes_[node].next.find(c);
+            node = (it != nodes_[node].next.end()) ? it->second : 0;
+            if (nodes_[node].out >= 0) return nodes_[node].out;
+        }
+        return -1;
+    }
+
+    bool empty() const { return nodes_.empty(); }
+
+private:
+    struct Node {
+        std::unordered_map<unsigned char, size_t> next;
+        size_t fail = 0;
+        int out = -1;  // rule id ending at (or suffix-reachable from) here
+    };
+
+    std::vector<Node> nodes_;
+
+    void ensure_root() {
+        if (nodes_.empty()) nodes_.emplace_back();
+    }
+};
+
+//---------------------------------------------------------------------------
+// Compiled policy
+//---------------------------------------------------------------------------
+
+struct Policy {
+    PathTrie deny_paths;
+    std::unordered_set<std::string> allow_authors;
+    ContentMatcher content;
+    std::vector<std::string> content_reasons;  // indexed by rule id
+};
+
+Policy load_policy() {
+    Policy policy;
+    const char *env = std::getenv("MORAL_POLICY_PATH");
+    if (!env || !*env) return policy;
+
+    std::ifstream in(env);
+    if (!in) return policy;
+    nlohmann::json doc = nlohmann::json::parse(in, nullptr, false);
+    if (doc.is_discarded() || !doc.is_object()) return policy;
+
+    if (doc.contains("deny_paths") && doc["deny_paths"].is_array()) {
+        for (const auto &p : doc["deny_paths"]) {
+            if (p.is_string()) policy.deny_paths.add(p.get<std::string>());
+        }
+    }
+    if (doc.contains("allow_authors") && doc["allow_authors"].is_array()) {
+        for (const auto &a : doc["allow_authors"]) {
+            if (a.is_string()) policy.allow_authors.insert(a.get<std::string>());
+        }
+    }
+    auto add_patterns = [&policy, &doc](const char *key, const char *kind) {
+        if (!doc.contains(key) || !doc[key].is_array()) return;
+        for (const auto &p : doc[key]) {
+            if (!p.is_string()) continue;
+            std::string pat = p.get<std::string>();
+            size_t rule_id = policy.content_reasons.size();
+            policy.content_reasons.push_back(
+                std::string(kind) + " pattern '" + pat + "'");
+            policy.content.add(pat, rule_id);
+        }
+    };
+    add_patterns("deny_content", "denied content");
+    add_patterns("deny_symbols", "denied symbol");
+    policy.content.compile();
+    return policy;
+}
+
+// Compiled once at first use; the rule set is fixed for the process
+// lifetime, matching how the other env-configured gates behave.
+const Policy &policy() {
+    static const Policy p = load_policy();
+    return p;
+}
+
+} // namespace
+
+Decision choose(const nlohmann::json &plan) {
+    const Policy &p = policy();
+
+    if (!p.allow_authors.empty() && plan.contains("author") &&
+        plan["author"].is_string()) {
+        const std::string &author = plan["author"].get_ref<const std::string &>();
+        if (!p.allow_authors.count(author)) {
+            return {true, "author '" + author + "' not in allowlist"};
+        }
+    }
+
+    if (!p.deny_paths.empty() && plan.contains("file") &&
+        plan["file"].is_string()) {
+        std::string hit = p.deny_paths.match(plan["file"].get<std::string>());
+        if (!hit.empty()) {
+            return {true, "path matches denied pattern '" + hit + "'"};
+        }
+    }
+
+    if (!p.content.empty() && plan.contains("content") &&
+        plan["content"].is_string()) {
+        int rule = p.content.scan(plan["content"].get_ref<const std::string &>());
+        if (rule >= 0) {
+            return {true, "content matches " +
+                              p.content_reasons[static_cast<size_t>(rule)]};
+        }
+    }
+
     return {false, std::string{}};
 }
 
-} // namespace moral_core
\ No newline at end of file
+} // namespace moral_core
@@ -3,65 +3,173 @@
 // FDQC v4.0: Preconscious Buffer Implementation
 //
 // Implements 2-second sensory memory buffer with similarity-based
-// deduplication and importance-gated consolidation.
+// deduplication and importance-gated consolidation, on a lock-free
+// fixed-capacity ring (see the concurrency notes in the header).
 
 #include "preconscious_buffer.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <functional>
+#include <thread>
 
 namespace preconscious_buffer {
 
+//===========================================================================
+// SLOT ACCESS
+//===========================================================================
+
+bool PreConsciousBuffer::try_read_slot(uint64_t pos, BufferEntry& out) const {
+    const Slot& slot = slots_[pos % CAPACITY];
+    const uint64_t want = 2 * pos + 2;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 != want) {
+            if (s1 == want - 1) continue;  // write in progress: retry
+            return false;                  // not yet written / overwritten
+        }
+        BufferEntry entry;
+        entry.embedding.assign(slot.embedding, slot.embedding + slot.embedding_len);
+        entry.content.assign(slot.content, slot.content_len);
+        entry.timestamp = std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(slot.timestamp_ns));
+        entry.salience = slot.salience;
+        entry.similarity_to_previous = slot.similarity_to_previous;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == want) {
+            out = std::move(entry);
+            return true;
+        }
+        // Torn read (writer wrapped mid-copy): retry
+    }
+    return false;
+}
+
+bool PreConsciousBuffer::try_read_embedding(uint64_t pos, fdqc::Scalar* out,
+                                            uint32_t& len,
+                                            int64_t& timestamp_ns) const {
+    const Slot& slot = slots_[pos % CAPACITY];
+    const uint64_t want = 2 * pos + 2;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 != want) {
+            if (s1 == want - 1) continue;  // write in progress: retry
+            return false;                  // not yet written / overwritten
+        }
+        uint32_t n = slot.embedding_len;
+        if (n > SLOT_EMBEDDING_MAX) {
+            continue;  // torn length read
+        }
+        std::memcpy(out, slot.embedding, n * sizeof(fdqc::Scalar));
+        int64_t ts = slot.timestamp_ns;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == want) {
+            len = n;
+            timestamp_ns = ts;
+            return true;
+        }
+        // Torn read (writer wrapped mid-copy): retry
+    }
+    return false;
+}
+
+std::vector<BufferEntry> PreConsciousBuffer::snapshot() const {
+    std::vector<BufferEntry> result;
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = ring_begin(head, tail_.load(std::memory_order_acquire));
+    // The tail can pass our head snapshot if another thread pushes
+    // and expires concurrently
+    if (begin >= head) return result;
+    result.reserve(static_cast<size_t>(head - begin));
+
+    BufferEntry entry;
+    for (uint64_t pos = begin; pos < head; ++pos) {
+        if (try_read_slot(pos, entry) && !is_expired(entry)) {
+            result.push_back(std::move(entry));
+        }
+    }
+    return result;
+}
+
 //===========================================================================
 // ENTRY ADDITION
 //===========================================================================
 
-void PreConsciousBuffer::push(const std::vector<double>& embedding,
+void PreConsciousBuffer::push(const fdqc::Vec& embedding,
                               const std::string& content,
                               double salience) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Check for similar recent entry (deduplication)
-    bool is_duplicate = false;
-    
-    if (!buffer_.empty()) {
-        const auto& last_entry = buffer_.back();
-        double similarity = cosine_similarity(embedding, last_entry.embedding);
-        
-        if (similarity >= fdqc_params::BUFFER_SIMILARITY_THRESHOLD) {
-            is_duplicate = true;
-            stats_.duplicates_filtered++;
+    push(embedding.data(), embedding.size(), content, salience);
+}
+
+void PreConsciousBuffer::push(const fdqc::Scalar* embedding, size_t embedding_len,
+                              const std::string& content,
+                              double salience) {
+    // Similarity to the most recent committed entry, computed before
+    // the slot claim so it never extends the publish window.  Under
+    // concurrent pushes "previous" is best-effort, which matches the
+    // advisory nature of the dedup statistic.
+    double similarity = 0.0;
+    uint64_t head_now = head_.load(std::memory_order_acquire);
+    if (head_now > 0) {
+        fdqc::Scalar prev[SLOT_EMBEDDING_MAX];
+        uint32_t prev_len = 0;
+        int64_t prev_ts = 0;
+        if (try_read_embedding(head_now - 1, prev, prev_len, prev_ts)) {
+            similarity = cosine_similarity(embedding, embedding_len,
+                                           prev, prev_len);
+        }
+    }
+
+    bool is_duplicate = similarity >= fdqc_params::BUFFER_SIMILARITY_THRESHOLD;
+    if (is_duplicate) {
+        duplicates_filtered_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Claim a logical position and take ownership of its slot.  A
+    // slot is reclaimable once its previous generation is committed;
+    // if the ring has lapped us while we waited, the entry is older
+    // than everything stored and is simply dropped.
+    uint64_t pos = head_.fetch_add(1, std::memory_order_acq_rel);
+    Slot& slot = slots_[pos % CAPACITY];
+    const uint64_t expected = (pos >= CAPACITY) ? 2 * (pos - CAPACITY) + 2 : 0;
+    for (;;) {
+        uint64_t cur = slot.seq.load(std::memory_order_acquire);
+        if (cur > expected) {
+            update_stats(salience, is_duplicate);
+            return;  // lapped: superseded before we could publish
+        }
+        if (cur == expected &&
+            slot.seq.compare_exchange_weak(cur, 2 * pos + 1,
+                                           std::memory_order_acq_rel)) {
+            break;
         }
+        std::this_thread::yield();
     }
-    
-    // Add entry even if duplicate (but mark it)
-    BufferEntry entry(embedding, content, salience);
-    
-    if (!buffer_.empty()) {
-        const auto& last_entry = buffer_.back();
-        entry.similarity_to_previous = cosine_similarity(embedding, last_entry.embedding);
-    }
-    
-    buffer_.push_back(entry);
-    
-    // Update statistics
+
+    size_t emb_len = std::min(embedding_len, SLOT_EMBEDDING_MAX);
+    std::memcpy(slot.embedding, embedding, emb_len * sizeof(fdqc::Scalar));
+    slot.embedding_len = static_cast<uint32_t>(emb_len);
+    size_t content_len = std::min(content.size(), SLOT_CONTENT_MAX);
+    std::memcpy(slot.content, content.data(), content_len);
+    slot.content_len = static_cast<uint32_t>(content_len);
+    slot.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    slot.salience = salience;
+    slot.similarity_to_previous = similarity;
+    slot.seq.store(2 * pos + 2, std::memory_order_release);
+
     update_stats(salience, is_duplicate);
-    
-    // Maintain buffer size limit
-    if (buffer_.size() > fdqc_params::BUFFER_SIZE) {
-        buffer_.pop_front();
-    }
-    
-    // Periodically clean up expired entries
-    if (stats_.total_entries_processed % 10 == 0) {
+
+    // Periodically advance the expiration epoch
+    if (total_entries_.load(std::memory_order_relaxed) % 10 == 0) {
         expire_old_entries();
     }
 }
 
 void PreConsciousBuffer::push(const std::string& entry) {
     // Convert string to embedding
-    std::vector<double> embedding = string_to_embedding(entry);
-    
+    fdqc::Vec embedding = string_to_embedding(entry);
+
     // Use default salience
     push(embedding, entry, 0.5);
 }
@@ -71,46 +179,60 @@ void PreConsciousBuffer::push(const std::string& entry) {
 //===========================================================================
 
 std::vector<size_t> PreConsciousBuffer::find_similar(
-    const std::vector<double>& query_embedding,
+    const fdqc::Vec& query_embedding,
     double threshold) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+
     std::vector<size_t> results;
-    
-    for (size_t i = 0; i < buffer_.size(); ++i) {
-        const auto& entry = buffer_[i];
-        
-        // Skip expired entries
-        if (is_expired(entry)) {
-            continue;
-        }
-        
-        double similarity = cosine_similarity(query_embedding, entry.embedding);
-        
+    std::vector<BufferEntry> entries = snapshot();
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        double similarity = cosine_similarity(query_embedding, entries[i].embedding);
+
         if (similarity >= threshold) {
             results.push_back(i);
         }
     }
-    
+
     return results;
 }
 
 bool PreConsciousBuffer::contains_similar(
-    const std::vector<double>& embedding,
+    const fdqc::Vec& embedding,
     double threshold) const {
-    
-    for (const auto& entry : buffer_) {
-        if (is_expired(entry)) {
+    return contains_similar(embedding.data(), embedding.size(), threshold);
+}
+
+bool PreConsciousBuffer::contains_similar(
+    const fdqc::Scalar* embedding, size_t embedding_len,
+    double threshold) const {
+
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = ring_begin(head, tail_.load(std::memory_order_acquire));
+    if (begin >= head) {
+        return false;
+    }
+
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t max_age_ns = static_cast<int64_t>(
+        fdqc_params::BUFFER_DURATION_SEC * 1e9);
+
+    fdqc::Scalar slot_emb[SLOT_EMBEDDING_MAX];
+    uint32_t slot_len = 0;
+    int64_t slot_ts = 0;
+    for (uint64_t pos = begin; pos < head; ++pos) {
+        if (!try_read_embedding(pos, slot_emb, slot_len, slot_ts)) {
             continue;
         }
-        
-        double similarity = cosine_similarity(embedding, entry.embedding);
-        
-        if (similarity >= threshold) {
+        if (now_ns - slot_ts > max_age_ns) {
+            continue;  // expired
+        }
+        if (cosine_similarity(embedding, embedding_len,
+                              slot_emb, slot_len) >= threshold) {
             return true;
         }
     }
-    
+
     return false;
 }
 
@@ -118,33 +240,32 @@ bool PreConsciousBuffer::contains_similar(
 // RETRIEVAL
 //===========================================================================
 
+std::vector<BufferEntry> PreConsciousBuffer::contents() const {
+    return snapshot();
+}
+
 std::vector<BufferEntry> PreConsciousBuffer::get_salient_entries(
     double threshold) const {
-    
+
     std::vector<BufferEntry> result;
-    
-    for (const auto& entry : buffer_) {
-        if (!is_expired(entry) && entry.salience >= threshold) {
-            result.push_back(entry);
+
+    for (auto& entry : snapshot()) {
+        if (entry.salience >= threshold) {
+            result.push_back(std::move(entry));
         }
     }
-    
+
     return result;
 }
 
 std::vector<BufferEntry> PreConsciousBuffer::get_recent(size_t n) const {
-    std::vector<BufferEntry> result;
-    
-    // Get last n non-expired entries
-    for (auto it = buffer_.rbegin(); it != buffer_.rend() && result.size() < n; ++it) {
-        if (!is_expired(*it)) {
-            result.push_back(*it);
-        }
+    std::vector<BufferEntry> result = snapshot();
+
+    // Keep only the last n (snapshot is already chronological)
+    if (result.size() > n) {
+        result.erase(result.begin(), result.end() - n);
     }
-    
-    // Reverse to get chronological order
-    std::reverse(result.begin(), result.end());
-    
+
     return result;
 }
 
@@ -153,59 +274,67 @@ std::vector<BufferEntry> PreConsciousBuffer::get_recent(size_t n) const {
 //===========================================================================
 
 void PreConsciousBuffer::expire_old_entries() {
-    // Remove entries older than 2 seconds
-    auto now = std::chrono::steady_clock::now();
-    
-    auto new_end = std::remove_if(
-        buffer_.begin(),
-        buffer_.end(),
-        [this](const BufferEntry& entry) {
-            return this->is_expired(entry);
-        }
-    );
-    
-    buffer_.erase(new_end, buffer_.end());
+    // Advance the tail epoch past expired entries instead of erasing:
+    // readers just stop seeing positions below the tail, so writers
+    // are never blocked by cleanup.
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    uint64_t pos = ring_begin(head, tail);
+
+    BufferEntry entry;
+    while (pos < head) {
+        // An unreadable slot is mid-write, i.e. brand new: stop here
+        // rather than expire past it.
+        if (!try_read_slot(pos, entry)) break;
+        if (!is_expired(entry)) break;
+        ++pos;
+    }
+
+    // Only ever move the tail forward
+    while (tail < pos &&
+           !tail_.compare_exchange_weak(tail, pos, std::memory_order_acq_rel)) {
+    }
 }
 
 //===========================================================================
 // EMBEDDING COMPUTATION (SIMPLIFIED)
 //===========================================================================
 
-std::vector<double> PreConsciousBuffer::string_to_embedding(
+fdqc::Vec PreConsciousBuffer::string_to_embedding(
     const std::string& str) const {
-    
+
     // Simplified embedding: hash-based feature vector
     // In a real system, use learned embeddings or pre-trained models
-    
+
     constexpr size_t EMBEDDING_DIM = 128;
-    std::vector<double> embedding(EMBEDDING_DIM, 0.0);
-    
+    fdqc::Vec embedding(EMBEDDING_DIM, 0.0);
+
     // Create deterministic features from string
     std::hash<std::string> hasher;
     size_t base_hash = hasher(str);
-    
+
     // Generate features
     for (size_t d = 0; d < EMBEDDING_DIM; ++d) {
         // Mix hash with dimension index
         size_t dim_hash = base_hash ^ (d * 0x9e3779b9);  // Golden ratio constant
-        
+
         // Map to [-1, 1] using sine
         embedding[d] = std::sin(dim_hash * 0.001);
     }
-    
+
     // Normalize
     double norm = 0.0;
-    for (double val : embedding) {
+    for (fdqc::Scalar val : embedding) {
         norm += val * val;
     }
-    
+
     if (norm > fdqc_params::EPSILON) {
         double inv_norm = 1.0 / std::sqrt(norm);
-        for (double& val : embedding) {
+        for (fdqc::Scalar& val : embedding) {
             val *= inv_norm;
         }
     }
-    
+
     return embedding;
 }
 
@@ -213,16 +342,20 @@ std::vector<double> PreConsciousBuffer::string_to_embedding(
 // STATISTICS UPDATE
 //===========================================================================
 
-void PreConsciousBuffer::update_stats(double salience, bool is_duplicate) {
-    stats_.total_entries_processed++;
-    
+void PreConsciousBuffer::update_stats(double salience, bool /*is_duplicate*/) {
+    size_t count = total_entries_.fetch_add(1, std::memory_order_relaxed) + 1;
+
     // Update average salience (exponential moving average)
     double alpha = 0.9;
-    if (stats_.total_entries_processed == 1) {
-        stats_.average_salience = salience;
+    if (count == 1) {
+        average_salience_.store(salience, std::memory_order_relaxed);
     } else {
-        stats_.average_salience = alpha * stats_.average_salience + 
-                                 (1.0 - alpha) * salience;
+        double prev = average_salience_.load(std::memory_order_relaxed);
+        double next;
+        do {
+            next = alpha * prev + (1.0 - alpha) * salience;
+        } while (!average_salience_.compare_exchange_weak(
+            prev, next, std::memory_order_relaxed));
     }
 }
 
@@ -19,15 +19,20 @@
 #include <cstring>
 
 #include "kill.h"
+#include "latency_metrics.h"
 #include "moral_core.h"
 #include "change_gate.h"
 #include "explainer.h"
 #include "fdqc_system.h"
+#include "uring_writer.h"
 
 // OpenSSL for encryption
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
+// zlib for snapshot compression
+#include <zlib.h>
+
 // For hex encoding/decoding and vectors
 #include <iomanip>
 #include <vector>
@@ -36,34 +41,181 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/file.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace self_writer {
 
-// In‑process mutex to serialize concurrent apply_change calls.  This
-// prevents race conditions when multiple threads within the same
-// process attempt to write and audit concurrently.
-static std::mutex apply_mutex;
+// Sharded lock table keyed on the canonicalised target path.  Changes
+// to distinct files hash to (almost always) distinct shards and flow
+// through the pipeline concurrently, while same-file changes map to
+// the same shard and stay serialised.  64 shards is comfortably more
+// than the worker pool size, so collisions are rare.
+static constexpr size_t LOCK_SHARDS = 64;
+static std::mutex shard_mutexes[LOCK_SHARDS];
+
+// Pool of FDQC consciousness instances.  The FDQC modules mutate
+// internal state on every evaluation and are not thread-safe, so a
+// single instance behind one mutex serialised all cognitive
+// evaluation.  Instead, each pool slot holds a complete system with
+// its own narrow mutex; an evaluation takes the first uncontended
+// slot, so concurrent apply_change calls evaluate in parallel up to
+// the pool size.  Slot state (affective trajectory, buffer, episodic
+// memory) evolves independently per slot — acceptable for advisory
+// assessments — and only slot 0 attaches the shared memory-mapped
+// episodic store, which tolerates a single writer.
+static constexpr size_t FDQC_POOL_MAX = 8;
+
+struct FdqcSlot {
+    fdqc_system::FDQCSystem system;
+    std::mutex mutex;
+
+    explicit FdqcSlot(bool attach_persistence) : system(attach_persistence) {}
+};
+
+static std::vector<std::unique_ptr<FdqcSlot>> &fdqc_pool() {
+    static std::vector<std::unique_ptr<FdqcSlot>> pool = [] {
+        size_t n = std::thread::hardware_concurrency();
+        if (n == 0) n = 1;
+        n = std::min(n, FDQC_POOL_MAX);
+        std::vector<std::unique_ptr<FdqcSlot>> slots;
+        slots.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            slots.push_back(std::make_unique<FdqcSlot>(i == 0));
+        }
+        return slots;
+    }();
+    return pool;
+}
+
+// Evaluate a change on the first free pool slot, blocking on one slot
+// only when every instance is busy.
+static fdqc_system::EvaluationResult fdqc_evaluate(
+    const fdqc_system::ChangeContext &ctx) {
+    auto &pool = fdqc_pool();
+    static std::atomic<size_t> cursor{0};
+    size_t start = cursor.fetch_add(1, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < pool.size(); ++i) {
+        FdqcSlot &slot = *pool[(start + i) % pool.size()];
+        std::unique_lock<std::mutex> lk(slot.mutex, std::try_to_lock);
+        if (lk.owns_lock()) {
+            return slot.system.evaluate_change(ctx);
+        }
+    }
+
+    FdqcSlot &slot = *pool[start % pool.size()];
+    std::lock_guard<std::mutex> lk(slot.mutex);
+    return slot.system.evaluate_change(ctx);
+}
+
+// Cross‑process advisory lock descriptors, one per shard.  Each lazily
+// opens <change_dir>/locks/shard_<n>.lock on first use and keeps the
+// descriptor for the lifetime of the process.  flock on the shard file
+// serialises same-path writes across processes without funnelling the
+// whole pipeline through a single lock file.
+static int shard_lock_fds[LOCK_SHARDS];
+static std::once_flag shard_lock_init_flag;
 
-// Global FDQC consciousness system instance.  This system evaluates
-// all proposed code changes through the lens of artificial sapience,
-// providing emotional, epistemic, and phenomenal assessments.
-static fdqc_system::FDQCSystem fdqc_consciousness;
+static size_t shard_for_path(const std::string &canonical_path) {
+    return std::hash<std::string>{}(canonical_path) % LOCK_SHARDS;
+}
 
-// Cross‑process lock file descriptor.  We lazily initialise this when
-// apply_change is first invoked.  The lock file lives in the
-// change log directory and ensures that multiple processes do not
-// write reports concurrently, which could otherwise produce
-// colliding file names or interleaved output.  The descriptor
-// remains open for the lifetime of the process.
-static int lock_fd = -1;
+// Open (or create) the advisory lock file for a shard.  Returns the
+// descriptor, or throws on failure.  Must be called with the shard
+// mutex held so that two threads do not race the open.
+static int shard_lock_fd(size_t shard, const std::string &change_dir) {
+    std::call_once(shard_lock_init_flag, [] {
+        for (size_t i = 0; i < LOCK_SHARDS; ++i) shard_lock_fds[i] = -1;
+    });
+    if (shard_lock_fds[shard] < 0) {
+        std::string lock_dir = change_dir + "/locks";
+        std::filesystem::create_directories(lock_dir);
+        std::string lock_path = lock_dir + "/shard_" + std::to_string(shard) + ".lock";
+        int fd = ::open(lock_path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0640);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open lock file: " + lock_path);
+        }
+        shard_lock_fds[shard] = fd;
+    }
+    return shard_lock_fds[shard];
+}
+
+//===========================================================================
+// PATH VALIDATION CACHE
+//===========================================================================
+//
+// validate_path() performs two weakly_canonical walks, a relative()
+// and a per-component symlink check on every change — 20+ syscalls on
+// deep trees, for paths that repeat constantly.  A small LRU keyed by
+// (raw path, allowed root) caches the canonical result together with
+// the identity (dev, inode) of every directory on the chain.  A hit
+// re-verifies the cached verdict with one lstat per component: each
+// directory must still be the same non-symlink inode, and the target
+// itself must not (have become) a symlink.  Any mismatch drops the
+// entry and falls through to full validation, so the check is exact
+// rather than a staleness heuristic — a swapped directory or injected
+// symlink changes an inode and misses.  The target's own inode is
+// deliberately not pinned: write_atomic() replaces it on every change.
+
+namespace {
+
+struct PathChainLink {
+    std::string component;  // absolute path of this chain element
+    dev_t dev;
+    ino_t ino;
+};
+
+struct PathCacheEntry {
+    std::string canonical;             // validated full path (the verdict)
+    std::vector<PathChainLink> dirs;   // allowed root down to target's parent
+    std::string target;                // the file itself: must not be a symlink
+    std::list<std::string>::iterator lru_it;
+};
+
+constexpr size_t PATH_CACHE_MAX = 256;
+
+std::mutex g_path_cache_mutex;
+std::unordered_map<std::string, PathCacheEntry> g_path_cache;
+std::list<std::string> g_path_cache_lru;  // front = most recent
+
+// Re-verify a cached entry against the filesystem.  Returns false if
+// any chain directory disappeared, changed identity or became a
+// symlink, or if the target is now a symlink.
+bool path_cache_entry_valid(const PathCacheEntry &entry) {
+    struct stat st;
+    for (const auto &link : entry.dirs) {
+        if (::lstat(link.component.c_str(), &st) != 0 ||
+            S_ISLNK(st.st_mode) ||
+            st.st_dev != link.dev || st.st_ino != link.ino) {
+            return false;
+        }
+    }
+    // The target may legitimately not exist yet (first write) and its
+    // inode changes on every atomic rename; only its symlink-ness is
+    // pinned.
+    if (::lstat(entry.target.c_str(), &st) == 0 && S_ISLNK(st.st_mode)) {
+        return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
 
 // Validate that the requested path resides within an allowed root and
 // does not escape via symlinks or "..".  The allowed root is
 // determined by the ALLOWED_ROOT environment variable or defaults to
-// the current working directory.  Throws std::runtime_error on
-// violation.
-static void validate_path(const std::string &path) {
+// the current working directory.  Returns the canonicalised full path
+// (used as the lock-shard key).  Throws std::runtime_error on
+// violation.  Repeat validations of the same path are served from the
+// cache above after a cheap per-component identity re-check.
+static std::string validate_path(const std::string &path) {
     if (path.empty()) {
         throw std::runtime_error("Path cannot be empty");
     }
@@ -79,8 +231,24 @@ static void validate_path(const std::string &path) {
     }
 
     const char *root_env = std::getenv("ALLOWED_ROOT");
-    std::filesystem::path root = (root_env && *root_env) ? std::filesystem::path(root_env)
-                                                         : std::filesystem::current_path();
+    std::string root_str = (root_env && *root_env) ? std::string(root_env) : std::string();
+    std::string cache_key = path + '\0' + root_str;
+    {
+        std::lock_guard<std::mutex> lock(g_path_cache_mutex);
+        auto it = g_path_cache.find(cache_key);
+        if (it != g_path_cache.end()) {
+            if (path_cache_entry_valid(it->second)) {
+                g_path_cache_lru.splice(g_path_cache_lru.begin(), g_path_cache_lru,
+                                        it->second.lru_it);
+                return it->second.canonical;
+            }
+            g_path_cache_lru.erase(it->second.lru_it);
+            g_path_cache.erase(it);
+        }
+    }
+
+    std::filesystem::path root = !root_str.empty() ? std::filesystem::path(root_str)
+                                                   : std::filesystem::current_path();
 
     std::error_code ec;
     std::filesystem::path canonical_root = std::filesystem::weakly_canonical(root, ec);
@@ -98,13 +266,26 @@ static void validate_path(const std::string &path) {
         throw std::runtime_error("Attempt to access path outside allowed root: " + path);
     }
 
-    // Disallow symlinks along the path components beneath the root
+    // Disallow symlinks along the path components beneath the root,
+    // recording each directory's identity for the cache as we walk.
+    std::vector<PathChainLink> chain;
+    {
+        struct stat st;
+        if (::lstat(canonical_root.c_str(), &st) == 0) {
+            chain.push_back({canonical_root.string(), st.st_dev, st.st_ino});
+        }
+    }
     std::filesystem::path cur = canonical_root;
     for (const auto &part : rel) {
         cur /= part;
-        std::error_code ec2;
-        if (std::filesystem::is_symlink(cur, ec2)) {
-            throw std::runtime_error("Symlinks are not permitted in target path: " + cur.string());
+        struct stat st;
+        if (::lstat(cur.c_str(), &st) == 0) {
+            if (S_ISLNK(st.st_mode)) {
+                throw std::runtime_error("Symlinks are not permitted in target path: " + cur.string());
+            }
+            if (cur != full) {
+                chain.push_back({cur.string(), st.st_dev, st.st_ino});
+            }
         }
     }
 
@@ -122,15 +303,41 @@ static void validate_path(const std::string &path) {
             throw std::runtime_error("Failed to open allowed root: " + canonical_root.string());
         }
         int fd = static_cast<int>(::syscall(SYS_openat2, dirfd, rel.string().c_str(), &how, sizeof(how)));
-        if (fd < 0) {
-            ::close(dirfd);
-            throw std::runtime_error("Path resolution via openat2 failed: " + path);
+        int saved_errno = errno;
+        if (fd >= 0) {
+            ::close(fd);
         }
-        ::close(fd);
         ::close(dirfd);
+        // This is defense-in-depth on top of the lexical containment
+        // and per-component symlink checks above.  ENOENT is expected
+        // when the change creates a new file (the target does not
+        // exist yet); ENOSYS/EPERM/EINVAL mean the kernel or a seccomp
+        // filter does not provide openat2, in which case the checks
+        // above remain the authority.  Anything else (notably EXDEV
+        // and ELOOP from RESOLVE_BENEATH/RESOLVE_NO_SYMLINKS) is a
+        // real escape attempt.
+        if (fd < 0 && saved_errno != ENOENT && saved_errno != ENOSYS &&
+            saved_errno != EPERM && saved_errno != EINVAL) {
+            throw std::runtime_error("Path resolution via openat2 failed: " + path);
+        }
     #endif
     }
 #endif
+    {
+        std::lock_guard<std::mutex> lock(g_path_cache_mutex);
+        auto it = g_path_cache.find(cache_key);
+        if (it == g_path_cache.end()) {
+            g_path_cache_lru.push_front(cache_key);
+            g_path_cache[cache_key] = PathCacheEntry{full.string(), std::move(chain),
+                                                     full.string(),
+                                                     g_path_cache_lru.begin()};
+            if (g_path_cache.size() > PATH_CACHE_MAX) {
+                g_path_cache.erase(g_path_cache_lru.back());
+                g_path_cache_lru.pop_back();
+            }
+        }
+    }
+    return full.string();
 }
 
 // Helper: decode hex string into bytes.  Returns false on invalid
@@ -258,87 +465,176 @@ static std::string read_file(const std::string &path) {
 // failure.
 static void write_atomic(const std::string &path, const std::string &content) {
     std::filesystem::path target{path};
-    std::filesystem::create_directories(target.parent_path());
-    std::filesystem::path tmp_path = target;
-    tmp_path += ".tmp_write";
-    // Open temporary file for writing
-    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+    std::filesystem::path dir = target.parent_path();
+    if (dir.empty()) {
+        dir = ".";
+    }
+    std::filesystem::create_directories(dir);
+
+    // Create a unique temp file in the same directory to avoid cross-device rename issues
+    std::string tmpl = (dir / (target.filename().string() + ".XXXXXX")).string();
+    std::vector<char> tmpl_buf(tmpl.begin(), tmpl.end());
+    tmpl_buf.push_back('\0');
+    int fd = ::mkstemp(tmpl_buf.data());
     if (fd < 0) {
-        throw std::runtime_error("Failed to open temporary file for write: " + tmp_path.string());
+        throw std::runtime_error("Failed to create temporary file in target directory: " + dir.string());
     }
-    const char *buf = content.data();
+    std::string tmp_path{tmpl_buf.data()};
+
+    // Set desired permissions explicitly (e.g., 0640) in case umask differs
+    if (::fchmod(fd, 0640) != 0) {
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error("Failed to set permissions on temporary file: " + tmp_path);
+    }
+
+    // Write loop with short-write handling
+    const char* buf = content.data();
     size_t remaining = content.size();
     while (remaining > 0) {
         ssize_t written = ::write(fd, buf, remaining);
         if (written < 0) {
+            if (errno == EINTR) continue;
             ::close(fd);
             ::unlink(tmp_path.c_str());
-            std::filesystem::path dir = target.parent_path();
-            std::filesystem::create_directories(dir);
-
-            // Create a unique temp file in the same directory to avoid cross-device rename issues
-            std::string tmpl = (dir / (target.filename().string() + ".XXXXXX")).string();
-            std::vector<char> tmpl_buf(tmpl.begin(), tmpl.end());
-            tmpl_buf.push_back('\0');
-            int fd = ::mkstemp(tmpl_buf.data());
-            if (fd < 0) {
-                throw std::runtime_error("Failed to create temporary file in target directory: " + dir.string());
-            }
-            std::string tmp_path{tmpl_buf.data()};
+            throw std::runtime_error("Write to temporary file failed: " + tmp_path);
+        }
+        buf += static_cast<size_t>(written);
+        remaining -= static_cast<size_t>(written);
+    }
 
-            // Set desired permissions explicitly (e.g., 0640) in case umask differs
-            if (::fchmod(fd, 0640) != 0) {
-                ::close(fd);
-                ::unlink(tmp_path.c_str());
-                throw std::runtime_error("Failed to set permissions on temporary file: " + tmp_path);
-            }
+    // Flush file contents to disk
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error("fsync on temporary file failed: " + tmp_path);
+    }
 
-            // Write loop with short-write handling
-            const char* buf = content.data();
-            size_t remaining = content.size();
-            while (remaining > 0) {
-                ssize_t written = ::write(fd, buf, remaining);
-                if (written < 0) {
-                    if (errno == EINTR) continue;
-                    ::close(fd);
-                    ::unlink(tmp_path.c_str());
-                    throw std::runtime_error("Write to temporary file failed: " + tmp_path);
-                }
-                buf += static_cast<size_t>(written);
-                remaining -= static_cast<size_t>(written);
-            }
+    // Atomically replace the original file
+    if (::rename(tmp_path.c_str(), target.c_str()) != 0) {
+        int err = errno;
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error("Failed to rename temporary file into place: " + std::string(::strerror(err)));
+    }
 
-            // Flush file contents to disk
-            if (::fsync(fd) != 0) {
-                ::close(fd);
-                ::unlink(tmp_path.c_str());
-                throw std::runtime_error("fsync on temporary file failed: " + tmp_path);
-            }
+    // Close after rename to ensure no descriptor leaks
+    ::close(fd);
 
-            // Atomically replace the original file
-            if (::rename(tmp_path.c_str(), target.c_str()) != 0) {
-                int err = errno;
-                ::close(fd);
-                ::unlink(tmp_path.c_str());
-                throw std::runtime_error("Failed to rename temporary file into place: " + std::string(::strerror(err)));
-            }
+    // Flush the directory to ensure the rename is durable
+    int dfd = ::open(dir.c_str(), O_DIRECTORY | O_RDONLY);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+}
 
-            // Close after rename to ensure no descriptor leaks
-            ::close(fd);
+//===========================================================================
+// CONTENT-ADDRESSED SNAPSHOT STORE
+//===========================================================================
+//
+// Snapshots used to be full per-pid copies of the previous file
+// contents, so a file changed N times cost N near-identical copies
+// and N full writes.  The store keys each snapshot by the old
+// content's SHA-256 (already computed by build_report) under
+// <snap_dir>/store/<aa>/<sha256>.z, with the content deflate-
+// compressed behind an 8-byte original-size header.  Re-snapshotting
+// content already in the store is a single existence check — no read,
+// no write.  Entries are self-contained (no delta chains), so a
+// rollback is one read that never depends on older store entries.
+// Encrypted snapshots (SNAPSHOT_KEY_HEX) keep the per-pid scheme:
+// their random nonce makes identical content non-addressable.
+
+// Build the store payload for the given content: 8-byte little-endian
+// original size, then the deflate stream (uncompress needs the
+// destination size up front).  Pure computation — apply_change runs it
+// concurrently with the report build and FDQC evaluation.  Returns an
+// empty string on compression failure.
+static std::string snapshot_store_payload(const std::string &content) {
+    uLongf bound = compressBound(static_cast<uLong>(content.size()));
+    std::string payload(8 + bound, '\0');
+    uint64_t orig_size = content.size();
+    for (int i = 0; i < 8; ++i) {
+        payload[i] = static_cast<char>((orig_size >> (8 * i)) & 0xff);
+    }
+    uLongf comp_len = bound;
+    if (compress2(reinterpret_cast<Bytef *>(&payload[8]), &comp_len,
+                  reinterpret_cast<const Bytef *>(content.data()),
+                  static_cast<uLong>(content.size()),
+                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return std::string();
+    }
+    payload.resize(8 + comp_len);
+    return payload;
+}
 
-            // Flush the directory to ensure the rename is durable
-            int dfd = ::open(dir.c_str(), O_DIRECTORY | O_RDONLY);
-            if (dfd >= 0) {
-    }
-    std::filesystem::create_directories(snap_dir);
-    // Build snapshot name: <filename>.<pid>.bak
-    std::string base = src.filename().string();
-    pid_t pid = getpid();
-    std::stringstream ss;
-    ss << base << "." << pid << ".bak";
-    std::filesystem::path dst = std::filesystem::path(snap_dir) / ss.str();
-    std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing);
-    return dst.string();
+// Path of the store entry for a given content hash, or empty when
+// the hash is unusable.  Shared by snapshot_store_put() and the
+// fused io_uring write path in apply_change().
+static std::string snapshot_store_entry(const std::string &sha256,
+                                        const std::string &snap_dir) {
+    if (sha256.size() < 2) {
+        return std::string();
+    }
+    return (std::filesystem::path(snap_dir) / "store" / sha256.substr(0, 2) /
+            (sha256 + ".z"))
+        .string();
+}
+
+// Store the given content under its hash and return the store path
+// (the handle placed in ApplyResult::snapshot).  `payload` may carry
+// the precomputed result of snapshot_store_payload(); when empty it
+// is computed here.  Returns an empty string if the snapshot could
+// not be persisted.
+static std::string snapshot_store_put(const std::string &content,
+                                      const std::string &sha256,
+                                      const std::string &snap_dir,
+                                      std::string payload = std::string()) {
+    std::filesystem::path entry = snapshot_store_entry(sha256, snap_dir);
+    if (entry.empty()) {
+        return std::string();
+    }
+    std::error_code ec;
+    if (std::filesystem::exists(entry, ec) && !ec) {
+        // Deduplicated: this exact content is already stored.
+        return entry.string();
+    }
+    if (payload.empty()) {
+        payload = snapshot_store_payload(content);
+        if (payload.empty()) {
+            return std::string();
+        }
+    }
+    try {
+        write_atomic(entry.string(), payload);
+    } catch (...) {
+        return std::string();
+    }
+    return entry.string();
+}
+
+std::string read_snapshot(const std::string &handle) {
+    std::string raw = read_file(handle);
+    // Plain-text snapshots (and pre-store .bak files) pass through.
+    if (handle.size() < 2 || handle.compare(handle.size() - 2, 2, ".z") != 0) {
+        return raw;
+    }
+    if (raw.size() < 8) {
+        return std::string();
+    }
+    uint64_t orig_size = 0;
+    for (int i = 0; i < 8; ++i) {
+        orig_size |= static_cast<uint64_t>(static_cast<unsigned char>(raw[i])) << (8 * i);
+    }
+    std::string out(orig_size, '\0');
+    uLongf dest_len = static_cast<uLongf>(orig_size);
+    if (orig_size > 0 &&
+        uncompress(reinterpret_cast<Bytef *>(&out[0]), &dest_len,
+                   reinterpret_cast<const Bytef *>(raw.data() + 8),
+                   static_cast<uLong>(raw.size() - 8)) != Z_OK) {
+        return std::string();
+    }
+    return out;
 }
 
 ApplyResult apply_change(const std::string &path,
@@ -346,30 +642,75 @@ ApplyResult apply_change(const std::string &path,
                          const std::string &author,
                          const std::string &intent,
                          const nlohmann::json *explanation) {
-    // Acquire in‑process mutex early to serialise concurrent calls
-    std::lock_guard<std::mutex> lg(apply_mutex);
+    // Resolve audit directories.  The change log directory can be
+    // overridden via CHANGE_LOG_DIR; snapshots live alongside it.
+    const char *change_env = std::getenv("CHANGE_LOG_DIR");
+    std::string change_dir = (change_env && *change_env) ? std::string(change_env)
+                                                         : std::string("logs/changes");
+    std::string snapshot_dir = change_dir + "/snapshots";
     // Step 1: kill switch guard
     kill::require_alive();
-    // Validate path before any I/O
-    validate_path(path);
+    // Validate path before any I/O; the canonical form keys the lock shard
+    std::string canonical;
+    {
+        latency_metrics::ScopedTimer timer(
+            latency_metrics::Stage::VALIDATE_PATH);
+        canonical = validate_path(path);
+    }
+    // Acquire the in‑process shard lock for this path.  Changes to
+    // unrelated files hash to different shards and proceed in parallel;
+    // same-file changes contend here and stay serialised.
+    size_t shard = shard_for_path(canonical);
+    std::lock_guard<std::mutex> lg(shard_mutexes[shard]);
     // Step 2: read old contents
     std::string old_content = read_file(path);
-    // Step 3: build report
-    change_audit::Report report = change_audit::build_report(path, old_content, new_content, author, intent);
-    
-    // Step 3.5: FDQC consciousness evaluation
-    // Build FDQC change context
-    fdqc_system::ChangeContext fdqc_ctx;
-    fdqc_ctx.file_path = path;
-    fdqc_ctx.current_content = old_content;
-    fdqc_ctx.proposed_content = new_content;
-    fdqc_ctx.author = author;
-    fdqc_ctx.intent = intent;
-    fdqc_ctx.explanation = (explanation ? explanation->dump() : "");
-    
-    // Evaluate the change through artificial sapience
-    fdqc_system::EvaluationResult fdqc_result = fdqc_consciousness.evaluate_change(fdqc_ctx);
-    
+
+    // Steps 3 and 3.5 fan out in parallel: the FDQC evaluation, the
+    // diff/hash report build and the snapshot compression all depend
+    // only on the old and new content, so they run as concurrent
+    // tasks and join here — before any gate decision or write — which
+    // preserves the all-checks-pass-before-write invariant while
+    // overlapping the two dominant stage costs.
+
+    // Step 3.5 (async): FDQC consciousness evaluation on whichever
+    // pool instance is free; see fdqc_evaluate above.
+    auto fdqc_future = std::async(std::launch::async, [&]() {
+        fdqc_system::ChangeContext fdqc_ctx;
+        fdqc_ctx.file_path = path;
+        fdqc_ctx.current_content = old_content;
+        fdqc_ctx.proposed_content = new_content;
+        fdqc_ctx.author = author;
+        fdqc_ctx.intent = intent;
+        fdqc_ctx.explanation = (explanation ? explanation->dump() : "");
+        latency_metrics::ScopedTimer timer(
+            latency_metrics::Stage::FDQC_EVALUATE);
+        return fdqc_evaluate(fdqc_ctx);
+    });
+
+    // Snapshot compression (async): precompute the store payload for
+    // the old content so the post-gate snapshot step only has to
+    // write it out.  Skipped when there is nothing to snapshot or
+    // when snapshot encryption is configured (that path derives a
+    // fresh nonce at write time).
+    const char *snap_key_env = std::getenv("SNAPSHOT_KEY_HEX");
+    std::future<std::string> snap_payload_future;
+    if (!old_content.empty() && !(snap_key_env && *snap_key_env)) {
+        snap_payload_future = std::async(std::launch::async, [&]() {
+            return snapshot_store_payload(old_content);
+        });
+    }
+
+    // Step 3 (this thread): build report
+    change_audit::Report report;
+    {
+        latency_metrics::ScopedTimer timer(
+            latency_metrics::Stage::BUILD_REPORT);
+        report = change_audit::build_report(path, old_content, new_content, author, intent);
+    }
+
+    // Join the FDQC evaluation before the first gate decision.
+    fdqc_system::EvaluationResult fdqc_result = fdqc_future.get();
+
     // Populate FDQC fields in the report
     report.fdqc_emotional_valence = fdqc_result.emotional_valence;
     report.fdqc_emotional_arousal = fdqc_result.emotional_arousal;
@@ -389,9 +730,13 @@ ApplyResult apply_change(const std::string &path,
     
     // Step 4: moral core pre‑gate
     {
+        latency_metrics::ScopedTimer timer(
+            latency_metrics::Stage::MORAL_CORE);
         nlohmann::json plan;
         plan["intent"] = intent;
         plan["file"] = path;
+        plan["author"] = author;
+        plan["content"] = new_content;
         plan["delta_hash"] = report.diff_sha256;
         auto decision = moral_core::choose(plan);
         if (decision.block) {
@@ -433,48 +778,27 @@ ApplyResult apply_change(const std::string &path,
             }
             throw std::runtime_error(std::string("ChangeGate strict reject: ") + oss.str());
         }
-        report.explanation = expl;
-        // Initialise cross‑process lock if necessary (race-safe)
-        if (lock_fd < 0) {
-            std::filesystem::create_directories(change_dir);
-            std::string lock_path = change_dir + "/apply.lock";
-            int fd_tmp = ::open(lock_path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0640);
-            if (fd_tmp < 0) {
-                throw std::runtime_error("Failed to open lock file: " + lock_path);
-            }
-            // Publish the fd once ready
-            lock_fd = fd_tmp;
-        }
-
-        // RAII guard to ensure lock release on all exits
-        struct FlockGuard {
-            int fd;
-            bool locked{false};
-            explicit FlockGuard(int f) : fd(f) {
-                if (::flock(fd, LOCK_EX) != 0) {
-                    throw std::runtime_error("Failed to acquire cross‑process lock");
-                }
-                locked = true;
-            }
-            ~FlockGuard() {
-                if (locked) {
-                    ::flock(fd, LOCK_UN);
-                }
-            }
-        } flock_guard(lock_fd);
-        }
     }
-    // Acquire exclusive file lock across processes before snapshot and write
-    if (lock_fd >= 0) {
-        if (::flock(lock_fd, LOCK_EX) != 0) {
-            throw std::runtime_error("Failed to acquire cross‑process lock");
+    report.explanation = expl;
+    // Acquire the cross‑process advisory lock for this shard before
+    // snapshot and write.  The RAII guard releases on every exit path.
+    struct FlockGuard {
+        int fd;
+        explicit FlockGuard(int f) : fd(f) {
+            if (::flock(fd, LOCK_EX) != 0) {
+                throw std::runtime_error("Failed to acquire cross‑process lock");
+            }
         }
-    }
+        ~FlockGuard() { ::flock(fd, LOCK_UN); }
+    } flock_guard(shard_lock_fd(shard, change_dir));
     // Step 7: snapshot original file.  If snapshot encryption is enabled
     // via SNAPSHOT_KEY_HEX then we encrypt the old content using
     // AES‑256‑GCM and record the metadata (key_id, nonce, tag) in the
     // report.  Otherwise we copy the file as plain text.
     std::string snap;
+    // The snapshot spans the encrypted path and the store fallback
+    // below, so it is timed explicitly rather than with a scoped block.
+    uint64_t snapshot_start = latency_metrics::read_cycles();
     do {
         const char *key_hex_env = std::getenv("SNAPSHOT_KEY_HEX");
         if (key_hex_env && *key_hex_env && !old_content.empty()) {
@@ -517,16 +841,79 @@ ApplyResult apply_change(const std::string &path,
             break;
         }
     } while (0);
+    std::string snap_payload;
+    bool snap_deferred = false;
     if (snap.empty()) {
-        snap = snapshot_file(path, snapshot_dir);
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec) && !ec) {
+            std::string payload = snap_payload_future.valid()
+                                      ? snap_payload_future.get()
+                                      : std::string();
+            std::string entry =
+                snapshot_store_entry(report.old_sha256, snapshot_dir);
+            std::error_code store_ec;
+            if (!entry.empty() && std::filesystem::exists(entry, store_ec) &&
+                !store_ec) {
+                // Deduplicated: this exact content is already stored.
+                snap = entry;
+            } else if (!entry.empty() && uring_writer::available()) {
+                // Defer the store write: it is fused with the target
+                // write into one io_uring submission below so the two
+                // writes and their fsyncs overlap on the device.
+                if (payload.empty()) {
+                    payload = snapshot_store_payload(old_content);
+                }
+                if (!payload.empty()) {
+                    snap_payload = std::move(payload);
+                    snap = entry;
+                    snap_deferred = true;
+                }
+            } else {
+                snap = snapshot_store_put(old_content, report.old_sha256,
+                                          snapshot_dir, std::move(payload));
+            }
+        }
+    }
+    if (!snap_deferred) {
+        latency_metrics::record(latency_metrics::Stage::SNAPSHOT_WRITE,
+                                latency_metrics::read_cycles() - snapshot_start);
     }
-    // Step 8: atomic write
-    write_atomic(path, new_content);
+    // Step 8: atomic write.  When the snapshot was deferred above,
+    // write_batch() submits the snapshot payload and the new target
+    // content as one io_uring batch; its renames run in job order, so
+    // the snapshot is durable before the target file is replaced, the
+    // same ordering the serial path provides.  On any failure both
+    // writes re-run through the classic write+fsync path, which is
+    // idempotent.
+    {
+        std::vector<uring_writer::Job> batch;
+        if (snap_deferred) {
+            batch.push_back({snap, &snap_payload});
+        }
+        batch.push_back({path, &new_content});
+        if (!uring_writer::write_batch(batch)) {
+            if (snap_deferred) {
+                snap = snapshot_store_put(old_content, report.old_sha256,
+                                          snapshot_dir,
+                                          std::move(snap_payload));
+            }
+            write_atomic(path, new_content);
+        }
+    }
+    if (snap_deferred) {
+        // The fused submission makes the snapshot and target I/O
+        // inseparable, so in this mode the stage covers both.
+        latency_metrics::record(latency_metrics::Stage::SNAPSHOT_WRITE,
+                                latency_metrics::read_cycles() - snapshot_start);
+    }
+    // Prime the old-content hash cache: the next change to this file
+    // can reuse new_sha256 instead of re-hashing what we just wrote.
+    change_audit::note_file_written(path, report.new_sha256);
     // Step 9: persist report
-    std::string rid = change_audit::save_report(report, change_dir);
-    // Release cross‑process lock
-    if (lock_fd >= 0) {
-        ::flock(lock_fd, LOCK_UN);
+    std::string rid;
+    {
+        latency_metrics::ScopedTimer timer(latency_metrics::Stage::DB_INSERT);
+        rid = change_audit::save_report(report, change_dir);
     }
     // Return result
     ApplyResult result;
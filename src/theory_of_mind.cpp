@@ -17,20 +17,22 @@ namespace theory_of_mind {
 
 AgentProfile& TheoryOfMind::get_agent(const std::string& agent_id) {
     // Create agent if doesn't exist
-    if (agents_.find(agent_id) == agents_.end()) {
-        agents_[agent_id] = AgentProfile(agent_id);
+    auto it = agent_index_.find(agent_id);
+    if (it == agent_index_.end()) {
+        agents_.emplace_back(agent_id);
+        it = agent_index_.emplace(agent_id, agents_.size() - 1).first;
     }
-    return agents_[agent_id];
+    return agents_[it->second];
 }
 
 const AgentProfile& TheoryOfMind::get_agent(const std::string& agent_id) const {
     static AgentProfile default_agent;
-    
-    auto it = agents_.find(agent_id);
-    if (it == agents_.end()) {
+
+    auto it = agent_index_.find(agent_id);
+    if (it == agent_index_.end()) {
         return default_agent;
     }
-    return it->second;
+    return agents_[it->second];
 }
 
 //===========================================================================
@@ -38,25 +40,36 @@ const AgentProfile& TheoryOfMind::get_agent(const std::string& agent_id) const {
 //===========================================================================
 
 void TheoryOfMind::observe(const std::string& agent_id,
-                           const std::vector<double>& observed_state,
-                           const std::vector<double>& observed_action) {
+                           const fdqc::Vec& observed_state,
+                           const fdqc::Vec& observed_action) {
     // Get or create agent profile
     AgentProfile& agent = get_agent(agent_id);
-    
-    // Record observation
-    agent.observation_history.emplace_back(observed_state, observed_action);
-    
-    // Limit history size
-    if (agent.observation_history.size() > 100) {
-        agent.observation_history.erase(agent.observation_history.begin());
+
+    // Record observation into the fixed ring (overwrites the oldest
+    // entry once full; no allocation, no shifting)
+    Observation& obs = agent.observation_ring[
+        agent.ring_head % OBSERVATION_HISTORY_CAPACITY];
+    obs.state_len = static_cast<uint8_t>(
+        std::min(observed_state.size(), obs.state.size()));
+    std::copy_n(observed_state.begin(), obs.state_len, obs.state.begin());
+    obs.action_len = static_cast<uint8_t>(
+        std::min(observed_action.size(), obs.action.size()));
+    std::copy_n(observed_action.begin(), obs.action_len, obs.action.begin());
+    agent.ring_head++;
+
+    // Welford update of per-dimension state statistics; replaces
+    // replaying the history whenever aggregate behavior is needed
+    agent.observation_count++;
+    for (size_t i = 0; i < agent.state_mean.size(); ++i) {
+        double x = (i < observed_state.size()) ? observed_state[i] : 0.0;
+        double delta = x - agent.state_mean[i];
+        agent.state_mean[i] += delta / static_cast<double>(agent.observation_count);
+        agent.state_m2[i] += delta * (x - agent.state_mean[i]);
     }
-    
-    // Update belief using inverse model
-    std::vector<double> inferred_belief = inverse_model(observed_state, 
-                                                        observed_action);
-    
-    // Update agent's belief state
-    agent.current_belief.state_estimate = inferred_belief;
+
+    // Update belief using inverse model (written in place)
+    inverse_model(observed_state, observed_action,
+                  agent.current_belief.state_estimate);
     agent.current_belief.update_count++;
     
     // Increase confidence with more observations
@@ -72,7 +85,7 @@ void TheoryOfMind::observe(const std::string& agent_id,
 void TheoryOfMind::observe(const std::vector<float>& state,
                            const std::vector<float>& action) {
     // Use "self" as default agent ID
-    observe("self", float_to_double(state), float_to_double(action));
+    observe("self", to_scalar(state), to_scalar(action));
 }
 
 //===========================================================================
@@ -80,11 +93,15 @@ void TheoryOfMind::observe(const std::vector<float>& state,
 //===========================================================================
 
 void TheoryOfMind::update_agent_belief(const std::string& agent_id,
-                                       const std::vector<double>& new_belief,
+                                       const fdqc::Vec& new_belief,
                                        double confidence) {
     AgentProfile& agent = get_agent(agent_id);
-    
-    agent.current_belief.state_estimate = new_belief;
+
+    agent.current_belief.state_estimate.fill(0.0);
+    size_t n = std::min(new_belief.size(),
+                        agent.current_belief.state_estimate.size());
+    std::copy_n(new_belief.begin(), n,
+                agent.current_belief.state_estimate.begin());
     agent.current_belief.confidence = confidence;
     agent.current_belief.update_count++;
 }
@@ -93,41 +110,34 @@ void TheoryOfMind::update_agent_belief(const std::string& agent_id,
 // BELIEF INFERENCE (INVERSE MODEL)
 //===========================================================================
 
-std::vector<double> TheoryOfMind::inverse_model(
-    const std::vector<double>& observed_state,
-    const std::vector<double>& observed_action) const {
-    
+void TheoryOfMind::inverse_model(
+    const fdqc::Vec& observed_state,
+    const fdqc::Vec& observed_action,
+    std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM>& out) const {
+
     // Simplified inverse model: infer belief from state-action pair
     // Real implementation would use learned neural network
-    
+
     if (observed_state.empty()) {
-        return {};
+        out.fill(0.0);
+        return;
     }
-    
-    // Create belief state (same dimensionality as state)
-    std::vector<double> inferred_belief(
-        fdqc_params::BELIEF_STATE_DIM,
-        0.0
-    );
-    
+
     // Simple heuristic: belief is influenced by both state and action
-    size_t belief_dim = inferred_belief.size();
     size_t state_dim = observed_state.size();
     size_t action_dim = observed_action.size();
-    
-    for (size_t i = 0; i < belief_dim; ++i) {
+
+    for (size_t i = 0; i < out.size(); ++i) {
         double state_contrib = (i < state_dim) ? observed_state[i] : 0.0;
         double action_contrib = (i < action_dim) ? observed_action[i] : 0.0;
-        
+
         // Weighted combination
-        inferred_belief[i] = 0.7 * state_contrib + 0.3 * action_contrib;
+        out[i] = 0.7 * state_contrib + 0.3 * action_contrib;
     }
-    
-    return inferred_belief;
 }
 
 BeliefState TheoryOfMind::infer_belief(const std::string& agent_id,
-                                       const std::vector<double>& world_state) const {
+                                       const fdqc::Vec& world_state) const {
     if (!has_agent(agent_id)) {
         // No information about this agent
         return BeliefState(world_state, 0.0);
@@ -141,36 +151,32 @@ BeliefState TheoryOfMind::infer_belief(const std::string& agent_id,
 // ACTION PREDICTION (FORWARD MODEL)
 //===========================================================================
 
-std::vector<double> TheoryOfMind::forward_model(
-    const std::vector<double>& belief_state) const {
-    
+fdqc::Vec TheoryOfMind::forward_model(
+    const std::array<fdqc::Scalar, fdqc_params::BELIEF_STATE_DIM>& belief_state) const {
+
     // Simplified forward model: predict action from belief
     // Real implementation would use learned policy network
-    
-    if (belief_state.empty()) {
-        return {};
-    }
-    
+
     // Create action vector (smaller than belief state)
-    std::vector<double> predicted_action(4, 0.0);  // 4D action space
-    
+    fdqc::Vec predicted_action(4, 0.0);  // 4D action space
+
     // Simple transformation: weighted sum + nonlinearity
     for (size_t i = 0; i < predicted_action.size() && i < belief_state.size(); ++i) {
         predicted_action[i] = std::tanh(belief_state[i]);
     }
-    
+
     return predicted_action;
 }
 
-std::vector<double> TheoryOfMind::predict_action(
+fdqc::Vec TheoryOfMind::predict_action(
     const std::string& agent_id,
-    const std::vector<double>& world_state) const {
+    const fdqc::Vec& world_state) const {
     
     // Get agent's belief state
     BeliefState belief = infer_belief(agent_id, world_state);
     
     // Predict action using forward model
-    std::vector<double> predicted_action = forward_model(belief.state_estimate);
+    fdqc::Vec predicted_action = forward_model(belief.state_estimate);
     
     const_cast<ToMStats&>(stats_).predictions_made++;
     
@@ -180,10 +186,10 @@ std::vector<double> TheoryOfMind::predict_action(
 std::vector<float> TheoryOfMind::predict_action(
     const std::vector<float>& state) const {
     
-    std::vector<double> double_state = float_to_double(state);
-    std::vector<double> predicted = predict_action("self", double_state);
+    fdqc::Vec scalar_state = to_scalar(state);
+    fdqc::Vec predicted = predict_action("self", scalar_state);
     
-    return double_to_float(predicted);
+    return to_float(predicted);
 }
 
 //===========================================================================
@@ -229,7 +235,7 @@ bool TheoryOfMind::evaluate_false_belief(
     );
     
     // Predict Sally's action based on her belief
-    std::vector<double> predicted_action = predict_action(
+    fdqc::Vec predicted_action = predict_action(
         scenario.protagonist,
         scenario.true_state
     );
@@ -0,0 +1,375 @@
+// uring_writer.cpp
+//
+// Implementation of the batched io_uring durable-write path declared
+// in uring_writer.h.  The kernel interface is used directly via
+// syscall(): io_uring_setup creates the ring, the submission and
+// completion queues are mmap'd into the process, and io_uring_enter
+// both submits and waits.  Each worker thread owns its own ring
+// (thread_local), so submission needs no locking and rings live as
+// long as the long-lived pool threads that use them.
+//
+// Per batch, every job becomes a two-SQE chain — data write linked to
+// an fsync via IOSQE_IO_LINK — and all chains go out in one
+// submission so the kernel can run them concurrently.  Content
+// buffers are registered (IORING_REGISTER_BUFFERS) for the batch so
+// writes issue from pinned pages; if registration fails (e.g.
+// RLIMIT_MEMLOCK) the batch degrades to plain IORING_OP_WRITE rather
+// than falling back entirely.  Renames and directory fsyncs stay
+// synchronous and run in job order after all data is durable.
+
+#include "uring_writer.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define COCKPIT_HAVE_IO_URING 1
+#endif
+
+namespace uring_writer {
+
+#ifdef COCKPIT_HAVE_IO_URING
+
+namespace {
+
+// Ring depth.  apply_change batches at most a snapshot and a target
+// write (four SQEs); 16 leaves headroom for larger future batches.
+constexpr unsigned RING_ENTRIES = 16;
+
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg,
+                          unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg,
+                                    nr_args));
+}
+
+// One mmap'd ring pair plus its SQE array.  Owned by a single thread;
+// the only cross-thread traffic is with the kernel, handled by the
+// acquire/release pairs on the queue tails below.
+struct Ring {
+    int fd = -1;
+    void* sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    void* cq_ring = nullptr;
+    size_t cq_ring_size = 0;
+    struct io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    struct io_uring_cqe* cqes = nullptr;
+
+    bool ok = false;
+
+    Ring() {
+        struct io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd = sys_io_uring_setup(RING_ENTRIES, &p);
+        if (fd < 0) {
+            return;
+        }
+        sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size =
+            p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            // Modern kernels map both queues through one region.
+            size_t size = std::max(sq_ring_size, cq_ring_size);
+            sq_ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED) {
+                sq_ring = nullptr;
+                return;
+            }
+            sq_ring_size = size;
+            cq_ring = sq_ring;
+            cq_ring_size = 0;  // unmapped via sq_ring
+        } else {
+            sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED) {
+                sq_ring = nullptr;
+                return;
+            }
+            cq_ring = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ring == MAP_FAILED) {
+                cq_ring = nullptr;
+                return;
+            }
+        }
+        sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = static_cast<struct io_uring_sqe*>(
+            ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            sqes = nullptr;
+            return;
+        }
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+        ok = true;
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    ~Ring() {
+        if (sqes) {
+            ::munmap(sqes, sqes_size);
+        }
+        if (cq_ring && cq_ring != sq_ring) {
+            ::munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring) {
+            ::munmap(sq_ring, sq_ring_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+// A temp file created alongside its target, mirroring write_atomic():
+// same directory, so the rename cannot cross filesystems.
+struct TempFile {
+    int fd = -1;
+    std::string tmp_path;
+    std::filesystem::path dir;
+};
+
+void discard_temps(std::vector<TempFile>& temps) {
+    for (TempFile& t : temps) {
+        if (t.fd >= 0) {
+            ::close(t.fd);
+            t.fd = -1;
+        }
+        if (!t.tmp_path.empty()) {
+            ::unlink(t.tmp_path.c_str());
+            t.tmp_path.clear();
+        }
+    }
+}
+
+} // namespace
+
+bool available() {
+    static const bool probed = [] {
+        const char* env = std::getenv("COCKPIT_URING");
+        if (env && std::strcmp(env, "off") == 0) {
+            return false;
+        }
+        struct io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        int fd = sys_io_uring_setup(1, &p);
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return probed;
+}
+
+bool write_batch(const std::vector<Job>& jobs) {
+    if (jobs.empty()) {
+        return true;
+    }
+    if (!available() || jobs.size() * 2 > RING_ENTRIES) {
+        return false;
+    }
+    thread_local Ring ring;
+    if (!ring.ok) {
+        return false;
+    }
+
+    // Stage every temp file before touching the ring so a failure
+    // here leaves nothing in flight.
+    std::vector<TempFile> temps;
+    temps.reserve(jobs.size());
+    for (const Job& job : jobs) {
+        std::filesystem::path target{job.path};
+        std::filesystem::path dir = target.parent_path();
+        if (dir.empty()) {
+            dir = ".";
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::string tmpl = (dir / (target.filename().string() + ".XXXXXX")).string();
+        std::vector<char> tmpl_buf(tmpl.begin(), tmpl.end());
+        tmpl_buf.push_back('\0');
+        TempFile t;
+        t.fd = ::mkstemp(tmpl_buf.data());
+        if (t.fd < 0) {
+            discard_temps(temps);
+            return false;
+        }
+        t.tmp_path = tmpl_buf.data();
+        t.dir = dir;
+        temps.push_back(std::move(t));
+        if (::fchmod(temps.back().fd, 0640) != 0) {
+            discard_temps(temps);
+            return false;
+        }
+    }
+
+    // Register the content buffers so the kernel writes from pinned
+    // pages.  Registration can fail (RLIMIT_MEMLOCK); the batch still
+    // overlaps with plain writes, so degrade instead of bailing out.
+    std::vector<struct iovec> iov(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        iov[i].iov_base = const_cast<char*>(jobs[i].content->data());
+        iov[i].iov_len = jobs[i].content->size();
+    }
+    bool fixed = sys_io_uring_register(ring.fd, IORING_REGISTER_BUFFERS,
+                                       iov.data(),
+                                       static_cast<unsigned>(iov.size())) == 0;
+
+    // Queue one write→fsync chain per job.  user_data encodes the job
+    // index and which half of the chain completed.
+    unsigned tail = *ring.sq_tail;
+    unsigned n_sqes = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        struct io_uring_sqe* sqe = &ring.sqes[(tail + n_sqes) & *ring.sq_mask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = temps[i].fd;
+        sqe->addr = reinterpret_cast<uint64_t>(jobs[i].content->data());
+        sqe->len = static_cast<unsigned>(jobs[i].content->size());
+        sqe->off = 0;
+        if (fixed) {
+            sqe->buf_index = static_cast<uint16_t>(i);
+        }
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = static_cast<uint64_t>(i) * 2;
+        n_sqes++;
+
+        sqe = &ring.sqes[(tail + n_sqes) & *ring.sq_mask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = temps[i].fd;
+        sqe->user_data = static_cast<uint64_t>(i) * 2 + 1;
+        n_sqes++;
+    }
+    for (unsigned k = 0; k < n_sqes; ++k) {
+        ring.sq_array[(tail + k) & *ring.sq_mask] = (tail + k) & *ring.sq_mask;
+    }
+    __atomic_store_n(ring.sq_tail, tail + n_sqes, __ATOMIC_RELEASE);
+
+    // Submit everything in one syscall and wait for all completions.
+    bool io_ok = true;
+    unsigned submitted = 0;
+    while (submitted < n_sqes) {
+        int ret = sys_io_uring_enter(ring.fd, n_sqes - submitted, n_sqes,
+                                     IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            io_ok = false;
+            break;
+        }
+        submitted += static_cast<unsigned>(ret);
+    }
+
+    // Reap every CQE even on failure so the ring stays consistent for
+    // the next batch.  A short write counts as failure: the fallback
+    // path rewrites the whole file, so there is no point resuming.
+    unsigned head = *ring.cq_head;
+    for (unsigned reaped = 0; io_ok && reaped < n_sqes; ++reaped) {
+        while (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            if (sys_io_uring_enter(ring.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR) {
+                io_ok = false;
+                break;
+            }
+        }
+        if (!io_ok) {
+            break;
+        }
+        const struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cq_mask];
+        size_t job_i = static_cast<size_t>(cqe->user_data / 2);
+        bool is_write = (cqe->user_data % 2) == 0;
+        if (is_write) {
+            if (cqe->res != static_cast<int>(jobs[job_i].content->size())) {
+                io_ok = false;
+            }
+        } else if (cqe->res != 0) {
+            io_ok = false;
+        }
+        head++;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+    if (fixed) {
+        sys_io_uring_register(ring.fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+    if (!io_ok) {
+        discard_temps(temps);
+        return false;
+    }
+
+    // All data is durable; rename into place in job order so callers
+    // can rely on earlier jobs (the snapshot) landing before later
+    // ones (the target), then flush each directory as write_atomic()
+    // does.
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (::rename(temps[i].tmp_path.c_str(), jobs[i].path.c_str()) != 0) {
+            discard_temps(temps);
+            return false;
+        }
+        temps[i].tmp_path.clear();
+        ::close(temps[i].fd);
+        temps[i].fd = -1;
+        int dfd = ::open(temps[i].dir.c_str(), O_DIRECTORY | O_RDONLY);
+        if (dfd >= 0) {
+            ::fsync(dfd);
+            ::close(dfd);
+        }
+    }
+    return true;
+}
+
+#else // !COCKPIT_HAVE_IO_URING
+
+bool available() {
+    return false;
+}
+
+bool write_batch(const std::vector<Job>&) {
+    return false;
+}
+
+#endif // COCKPIT_HAVE_IO_URING
+
+} // namespace uring_writer
@@ -10,9 +10,159 @@
 #include <random>
 #include <numeric>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace vcca_controller {
 
+//===========================================================================
+// MEMORY-MAPPED PERSISTENCE
+//===========================================================================
+//
+// The learned policy is tiny (5×10 Q-values plus per-level visit
+// counts), so the whole state maps as one fixed-size struct.  Policy
+// updates are copied through to the mapping, and a restarted process
+// restores it on attach instead of re-exploring from the optimistic
+// initial table with ε-greedy.
+
+namespace {
+
+constexpr char QTABLE_MAGIC[8] = {'F','D','Q','C','V','C','C','1'};
+
+struct QTableStore {
+    char magic[8];
+    uint32_t levels;
+    uint32_t bins;
+    uint64_t episode_count;
+    double values[fdqc_params::N_VCCA_LEVELS * QTable::N_CONTEXT_BINS];
+    uint64_t visit_counts[fdqc_params::N_VCCA_LEVELS];
+};
+
+} // namespace
+
+VCCAController::~VCCAController() {
+    close_store();
+}
+
+VCCAController::VCCAController(VCCAController&& other) noexcept
+    : VCCAController() {
+    *this = std::move(other);
+}
+
+VCCAController& VCCAController::operator=(VCCAController&& other) noexcept {
+    if (this != &other) {
+        close_store();
+        current_n_ = other.current_n_;
+        episode_count_ = other.episode_count_;
+        q_table_ = other.q_table_;
+        dimension_history_ = std::move(other.dimension_history_);
+        persist_path_ = std::move(other.persist_path_);
+        persist_fd_ = other.persist_fd_;
+        persist_base_ = other.persist_base_;
+        persist_size_ = other.persist_size_;
+        other.persist_path_.clear();
+        other.persist_fd_ = -1;
+        other.persist_base_ = nullptr;
+        other.persist_size_ = 0;
+    }
+    return *this;
+}
+
+bool VCCAController::set_persistence(const std::string& path) {
+    close_store();
+    persist_path_ = path;
+
+    std::error_code ec;
+    bool existed = std::filesystem::exists(path, ec) && !ec;
+
+    std::filesystem::path p{path};
+    if (p.has_parent_path()) {
+        std::filesystem::create_directories(p.parent_path(), ec);
+    }
+    int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        persist_path_.clear();
+        return false;
+    }
+    if (::ftruncate(fd, sizeof(QTableStore)) != 0) {
+        ::close(fd);
+        persist_path_.clear();
+        return false;
+    }
+    void* base = ::mmap(nullptr, sizeof(QTableStore),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        persist_path_.clear();
+        return false;
+    }
+
+    auto* store = static_cast<QTableStore*>(base);
+    if (existed) {
+        if (std::memcmp(store->magic, QTABLE_MAGIC, sizeof(QTABLE_MAGIC)) != 0 ||
+            store->levels != fdqc_params::N_VCCA_LEVELS ||
+            store->bins != QTable::N_CONTEXT_BINS) {
+            ::munmap(base, sizeof(QTableStore));
+            ::close(fd);
+            persist_path_.clear();
+            return false;
+        }
+        // Restore the learned policy
+        for (size_t i = 0; i < q_table_.values.size(); ++i) {
+            q_table_.values[i] = store->values[i];
+        }
+        for (size_t i = 0; i < fdqc_params::N_VCCA_LEVELS; ++i) {
+            q_table_.visit_counts[i] = static_cast<size_t>(store->visit_counts[i]);
+        }
+        episode_count_ = static_cast<size_t>(store->episode_count);
+    } else {
+        std::memcpy(store->magic, QTABLE_MAGIC, sizeof(QTABLE_MAGIC));
+        store->levels = fdqc_params::N_VCCA_LEVELS;
+        store->bins = QTable::N_CONTEXT_BINS;
+    }
+
+    persist_fd_ = fd;
+    persist_base_ = base;
+    persist_size_ = sizeof(QTableStore);
+    if (!existed) {
+        sync_store();
+    }
+    return true;
+}
+
+void VCCAController::sync_store() {
+    if (!persist_base_) return;
+
+    auto* store = static_cast<QTableStore*>(persist_base_);
+    for (size_t i = 0; i < q_table_.values.size(); ++i) {
+        store->values[i] = q_table_.values[i];
+    }
+    for (size_t i = 0; i < fdqc_params::N_VCCA_LEVELS; ++i) {
+        store->visit_counts[i] = q_table_.visit_counts[i];
+    }
+    store->episode_count = episode_count_;
+}
+
+void VCCAController::close_store() {
+    if (persist_base_) {
+        ::msync(persist_base_, persist_size_, MS_ASYNC);
+        ::munmap(persist_base_, persist_size_);
+        persist_base_ = nullptr;
+        persist_size_ = 0;
+    }
+    if (persist_fd_ >= 0) {
+        ::close(persist_fd_);
+        persist_fd_ = -1;
+    }
+}
+
 //===========================================================================
 // EPSILON-GREEDY ACTION SELECTION
 //===========================================================================
@@ -74,7 +224,8 @@ int VCCAController::select_dimension(const Context& context, double epsilon) {
     }
     
     episode_count_++;
-    
+    sync_store();
+
     return current_n_;
 }
 
@@ -94,6 +245,7 @@ void VCCAController::update_policy(const Context& context,
     
     // Q-learning update
     update_q_value(level_idx, context_bin, reward, learning_rate);
+    sync_store();
 }
 
 //===========================================================================
@@ -208,6 +208,67 @@ void test_gumbel_softmax_quality() {
     std::cout << "═══════════════════════════════════════════════════════════════\n\n";
 }
 
+void test_batch_collapse_consistency() {
+    std::cout << "\n╔════════════════════════════════════════════════════════════════╗\n";
+    std::cout << "║  TEST 5: Batch Collapse Consistency                           ║\n";
+    std::cout << "╚════════════════════════════════════════════════════════════════╝\n\n";
+
+    std::cout << "process_cycle_batch() must produce the same states as calling\n";
+    std::cout << "process_cycle() row by row (collapse is deterministic).\n\n";
+
+    const size_t row_dim = 9;
+    const size_t n_rows = 2000;
+
+    // Mix of focused and spread rows so both branches are exercised
+    std::vector<double> rows;
+    rows.reserve(n_rows * row_dim);
+    for (size_t r = 0; r < n_rows; ++r) {
+        std::vector<double> row(row_dim, 0.0);
+        if (r % 2 == 0) {
+            row.assign(row_dim, 0.01);
+            row[r % row_dim] = 1.0 - 0.01 * (row_dim - 1);
+        } else {
+            row.assign(row_dim, 1.0 / row_dim);
+        }
+        rows.insert(rows.end(), row.begin(), row.end());
+    }
+
+    CollapseLoop batch_loop(static_cast<int>(row_dim));
+    CollapseLoop serial_loop(static_cast<int>(row_dim));
+
+    auto batch_states = batch_loop.process_cycle_batch(rows, row_dim);
+
+    bool all_match = (batch_states.size() == n_rows);
+    for (size_t r = 0; all_match && r < n_rows; ++r) {
+        std::vector<double> row(rows.begin() + r * row_dim,
+                                rows.begin() + (r + 1) * row_dim);
+        auto expected = serial_loop.process_cycle(row);
+        const auto& got = batch_states[r];
+        all_match = got.selected_index == expected.selected_index &&
+                    std::fabs(got.entropy - expected.entropy) < 1e-12 &&
+                    std::fabs(got.confidence - expected.confidence) < 1e-12 &&
+                    got.weights == expected.weights;
+    }
+
+    bool stats_ok =
+        batch_loop.stats().total_updates == n_rows &&
+        batch_loop.stats().total_collapses == serial_loop.stats().total_collapses;
+
+    std::cout << "  Rows processed:     " << batch_states.size() << "\n";
+    std::cout << "  States match:       " << (all_match ? "YES ✓" : "NO ✗") << "\n";
+    std::cout << "  Aggregate stats ok: " << (stats_ok ? "YES ✓" : "NO ✗") << "\n\n";
+
+    std::cout << "═══════════════════════════════════════════════════════════════\n";
+    if (all_match && stats_ok) {
+        std::cout << "✅ BATCH COLLAPSE TEST: PASSED\n";
+        std::cout << "   Batch results identical to per-row processing\n";
+    } else {
+        std::cout << "❌ BATCH COLLAPSE TEST: FAILED\n";
+        std::exit(1);
+    }
+    std::cout << "═══════════════════════════════════════════════════════════════\n\n";
+}
+
 int main() {
     std::cout << "\n";
     std::cout << "╔════════════════════════════════════════════════════════════════╗\n";
@@ -223,7 +284,8 @@ int main() {
     test_entropy_driven_collapse_logic();
     test_biological_correspondence();
     test_gumbel_softmax_quality();
-    
+    test_batch_collapse_consistency();
+
     std::cout << "\n";
     std::cout << "╔════════════════════════════════════════════════════════════════╗\n";
     std::cout << "║                    TEST SUITE COMPLETE                         ║\n";